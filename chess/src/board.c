@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "./include/board.h"
+
+// ----------------------------------------
+// GLOBAL VARIABLES
+
+const Board DEFAULT_BOARD = {
+    {B_ROOK, B_KNIGHT, B_BISHOP, B_QUEEN, B_KING, B_BISHOP, B_KNIGHT, B_ROOK},
+    {B_PAWN, B_PAWN, B_PAWN, B_PAWN, B_PAWN, B_PAWN, B_PAWN, B_PAWN},
+
+    {EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY},
+    {EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY},
+    {EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY},
+    {EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY},
+
+    {W_PAWN, W_PAWN, W_PAWN, W_PAWN, W_PAWN, W_PAWN, W_PAWN, W_PAWN},
+    {W_ROOK, W_KNIGHT, W_BISHOP, W_QUEEN, W_KING, W_BISHOP, W_KNIGHT, W_ROOK},
+};
+
+// NOTE: changing this seed changes every key, and therefore
+// invalidates the start keys stored in the existing game logs.
+#define ZOBRIST_SEED 0x43484553535A4F42ULL
+
+// ----------------------------------------
+// FUNCTIONS
+
+// splitmix64, used to derive the zobrist keys without having to keep
+// (and initialize) a random table around.
+static uint64_t mix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+uint64_t zobrist_piece_key(PieceType t, int square) {
+  return mix64(ZOBRIST_SEED ^ (uint64_t) (t * BOARD_SQUARES + square));
+}
+
+uint64_t zobrist_side_key(void) {
+  return mix64(ZOBRIST_SEED ^ (uint64_t) (EMPTY * BOARD_SQUARES));
+}
+
+// `squares` is a board laid out row by row, see POS_TO_SQUARE().
+uint64_t board_zobrist_key(const PieceType *squares, int white_to_move) {
+  uint64_t key = white_to_move ? zobrist_side_key() : 0;
+
+  for (int s = 0; s < BOARD_SQUARES; s++) {
+    if (squares[s] != EMPTY) {
+      key ^= zobrist_piece_key(squares[s], s);
+    }
+  }
+
+  return key;
+}
+
+char piece_to_char(PieceType t) {
+  switch(t) {
+  case B_KING:   return 'k';
+  case B_QUEEN:  return 'q';
+  case B_ROOK:   return 'r';
+  case B_BISHOP: return 'b';
+  case B_KNIGHT: return 'n';
+  case B_PAWN:   return 'p';
+  // ----------------
+  case W_KING:   return 'K';
+  case W_QUEEN:  return 'Q';
+  case W_ROOK:   return 'R';
+  case W_BISHOP: return 'B';
+  case W_KNIGHT: return 'N';
+  case W_PAWN:   return 'P';
+
+  case EMPTY:    return '.';
+
+  default:
+    fprintf(stderr, "[ERROR] - default case in piece_to_char\n");
+    return '?';
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#include <stdint.h>
+
+// Plain board description, shared by the SDL game and by the headless
+// tools (such as chess_replay) that must not depend on SDL.
+
+#define BOARD_WIDTH 8
+#define BOARD_HEIGHT 8
+
+#define BOARD_SQUARES ((BOARD_WIDTH) * (BOARD_HEIGHT))
+
+// ----------------------------------------
+// DATA STRUCTURES
+
+typedef enum {
+  B_KING = 0,
+  B_QUEEN,
+  B_ROOK,
+  B_BISHOP,
+  B_KNIGHT,
+  B_PAWN,
+
+  W_KING,
+  W_QUEEN,
+  W_ROOK,
+  W_BISHOP,
+  W_KNIGHT,
+  W_PAWN,
+
+  EMPTY,
+
+} PieceType;
+
+typedef struct {
+  int x;
+  int y;
+} Pos;
+
+// NOTE: indexed as [y][x], like DEFAULT_BOARD
+typedef PieceType Board[BOARD_HEIGHT][BOARD_WIDTH];
+
+extern const Board DEFAULT_BOARD;
+
+// ----------------------------------------
+// DECLARATIONS
+
+uint64_t zobrist_piece_key(PieceType t, int square);
+uint64_t zobrist_side_key(void);
+uint64_t board_zobrist_key(const PieceType *squares, int white_to_move);
+char piece_to_char(PieceType t);
+
+// ----------------------------------------
+// UTILS MACRO
+
+#define IS_PIECE_BLACK(x) (x >= 0 && x <= 5)
+#define IS_PIECE_WHITE(x) (x >= 6 && x <= 11)
+
+#define POS_TO_SQUARE(p) ((p).y * BOARD_WIDTH + (p).x)
+#define SQUARE_TO_POS(s) ((Pos){ (s) % BOARD_WIDTH, (s) / BOARD_WIDTH })
+
+#endif // BOARD_H_
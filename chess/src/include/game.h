@@ -4,12 +4,11 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#include "./board.h"
+
 #define SCREEN_WIDTH  600
 #define SCREEN_HEIGHT 600
 
-#define BOARD_WIDTH 8
-#define BOARD_HEIGHT 8
-
 #define CELL_WIDTH ((SCREEN_WIDTH / BOARD_WIDTH))
 #define CELL_HEIGHT ((SCREEN_HEIGHT / BOARD_HEIGHT))
 
@@ -23,25 +22,6 @@
 // ----------------------------------------
 // DATA STRUCTURES
 
-typedef enum {
-  B_KING = 0,
-  B_QUEEN,
-  B_ROOK,
-  B_BISHOP,
-  B_KNIGHT,
-  B_PAWN,
-
-  W_KING,
-  W_QUEEN,
-  W_ROOK,
-  W_BISHOP,
-  W_KNIGHT,
-  W_PAWN,
-
-  EMPTY,
-
-} PieceType;
-
 typedef enum {
   UP = 0,
   DOWN,
@@ -56,11 +36,6 @@ typedef enum {
   STILL,
 } Dir;
 
-typedef struct {
-  int x;
-  int y;
-} Pos;
-
 typedef struct {
   PieceType type;
   Pos pos;
@@ -118,9 +93,6 @@ void add_valid_move(Game *game, Pos new_pos);
 // ----------------------------------------
 // UTILS MACRO
 
-#define IS_PIECE_BLACK(x) (x >= 0 && x <= 5)
-#define IS_PIECE_WHITE(x) (x >= 6 && x <= 11)
-
 #define IS_PLAYER_BLACK(g) (g->selected_player == &g->b_player)
 #define IS_PLAYER_WHITE(g) (g->selected_player == &g->w_player)
 
@@ -0,0 +1,104 @@
+#ifndef RECORD_H_
+#define RECORD_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "./board.h"
+
+// Binary game log.
+//
+// Every finished game is appended to the log as a single record:
+//
+//   RecordHeader | Move16 moves[plies] | uint16_t clocks[plies] | pad
+//
+// records are padded to 8 bytes so that headers can be read in place
+// from an mmap()-ed log. Next to the log we keep an index file
+// (<log>.idx) with the offset of each record, so that the i-th game
+// can be reached without walking the previous ones.
+
+#define RECORD_LOG_PATH "./games.bin"
+#define RECORD_INDEX_SUFFIX ".idx"
+
+#define RECORD_MAGIC   0x31474843 // "CHG1"
+#define RECORD_VERSION 1
+
+#define RECORD_MAX_PLIES UINT16_MAX
+#define RECORD_WRITE_BUFFER (1 << 16)
+
+// 16-bit moves: from square (6 bits), to square (6 bits), flags (4
+// bits). Flags are reserved for promotions, which the game does not
+// implement yet.
+typedef uint16_t Move16;
+
+#define MOVE_ENCODE(from, to, flags) ((Move16) (((from) & 0x3F) | (((to) & 0x3F) << 6) | (((flags) & 0xF) << 12)))
+#define MOVE_FROM(m)  ((m) & 0x3F)
+#define MOVE_TO(m)    (((m) >> 6) & 0x3F)
+#define MOVE_FLAGS(m) (((m) >> 12) & 0xF)
+
+typedef enum {
+  RESULT_NONE = 0,
+  RESULT_BLACK_WON,
+  RESULT_WHITE_WON,
+  RESULT_ABORTED,
+} GameResult;
+
+typedef struct {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t result;        // GameResult
+  uint8_t white_starts;
+  uint8_t reserved;
+  uint32_t plies;
+  uint32_t duration_ds;  // whole game, in deciseconds
+  uint64_t start_key;    // zobrist key of the starting position
+  uint64_t timestamp;    // unix time of the start of the game
+} RecordHeader;
+
+// Time spent on each ply, in deciseconds (saturated at UINT16_MAX).
+typedef uint16_t Clock16;
+
+typedef struct {
+  FILE *log;
+  FILE *index;
+  char *buffer;
+  uint64_t offset;
+
+  RecordHeader header;
+  Move16 *moves;
+  Clock16 *clocks;
+  size_t capacity;
+  uint32_t last_ms;
+  uint32_t start_ms;
+} Recorder;
+
+typedef struct {
+  const uint8_t *data;
+  size_t size;
+
+  const uint64_t *index;
+  size_t count;
+  size_t index_size;   // != 0 if index is mmap()-ed
+} RecordLog;
+
+// ----------------------------------------
+// DECLARATIONS
+
+size_t record_size(uint32_t plies);
+
+int recorder_open(Recorder *r, const char *path);
+void recorder_close(Recorder *r);
+void recorder_begin(Recorder *r, uint64_t start_key, int white_starts, uint64_t timestamp, uint32_t now_ms);
+void recorder_add_move(Recorder *r, Pos from, Pos to, uint32_t now_ms);
+void recorder_end(Recorder *r, GameResult result, uint32_t now_ms);
+
+int record_log_open(RecordLog *log, const char *path);
+void record_log_close(RecordLog *log);
+const RecordHeader *record_log_game(const RecordLog *log, size_t i);
+const Move16 *record_moves(const RecordHeader *h);
+const Clock16 *record_clocks(const RecordHeader *h);
+
+void record_replay(const RecordHeader *h, uint32_t ply, Board board);
+
+#endif // RECORD_H_
@@ -16,17 +16,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <time.h>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
 #include "./include/game.h"
 #include "./include/render.h"
+#include "./include/record.h"
 
 // ----------------------------------------
 // GLOBALS
 
 Game GAME = {0};
+Recorder RECORDER = {0};
+
+// ----------------------------------------
+
+void start_recording(void) {
+  // NOTE: we assume black starts
+  recorder_begin(&RECORDER, board_zobrist_key(&DEFAULT_BOARD[0][0], 0), 0, time(NULL), SDL_GetTicks());
+}
 
 // ----------------------------------------
 
@@ -43,6 +53,10 @@ int main(void) {
   IMG_Init(IMG_INIT_PNG);
   init_game(&GAME);
 
+  // games are still playable if the log can't be opened
+  recorder_open(&RECORDER, RECORD_LOG_PATH);
+  start_recording();
+
   while(!GAME.quit) {
     SDL_Event event;
 
@@ -71,13 +85,21 @@ int main(void) {
 
 	} else {
 	  // player has moved a piece
-	  int finished = move_piece(&GAME, GAME.selected_piece, new_pos);
+	  Piece *moved = GAME.selected_piece;
+	  Pos old_pos = moved->pos;
+	  int finished = move_piece(&GAME, moved, new_pos);
+
+	  if (moved->pos.x == new_pos.x && moved->pos.y == new_pos.y) {
+	    recorder_add_move(&RECORDER, old_pos, new_pos, SDL_GetTicks());
+	  }
 
 	  if (finished) {
 	    printf("Game is over: Player %s won!\n", GAME.selected_player->player_name);
 	    printf("Resetting ...\n\n");
+	    recorder_end(&RECORDER, GAME.selected_player == &GAME.b_player ? RESULT_BLACK_WON : RESULT_WHITE_WON, SDL_GetTicks());
 	    destroy_game(&GAME);
 	    init_game(&GAME);
+	    start_recording();
 	  }
 	}
       }
@@ -87,6 +109,8 @@ int main(void) {
     render_game(renderer, &GAME);
   }
 
+  recorder_end(&RECORDER, RESULT_ABORTED, SDL_GetTicks());
+  recorder_close(&RECORDER);
   destroy_game(&GAME);
   
   SDL_DestroyRenderer(renderer);
@@ -0,0 +1,331 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "./include/record.h"
+
+// ----------------------------------------
+// UTILS
+
+static char *index_path(const char *path) {
+  size_t len = strlen(path);
+  char *p = malloc(len + sizeof(RECORD_INDEX_SUFFIX));
+  if (!p) {
+    fprintf(stderr, "[ERROR] - could not allocate index path\n");
+    exit(1);
+  }
+  memcpy(p, path, len);
+  memcpy(p + len, RECORD_INDEX_SUFFIX, sizeof(RECORD_INDEX_SUFFIX));
+  return p;
+}
+
+static const void *map_file(const char *path, size_t *size) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+
+  *size = st.st_size;
+  return data;
+}
+
+size_t record_size(uint32_t plies) {
+  size_t size = sizeof(RecordHeader) + plies * (sizeof(Move16) + sizeof(Clock16));
+  return (size + 7) & ~(size_t) 7;
+}
+
+static uint16_t ms_to_ds(uint32_t ms) {
+  uint32_t ds = ms / 100;
+  return ds > UINT16_MAX ? UINT16_MAX : ds;
+}
+
+// ----------------------------------------
+// READER
+
+// Returns 1 if the record at `offset` is well formed and fits in the
+// log, 0 otherwise.
+static int record_valid_at(const RecordLog *log, uint64_t offset) {
+  if (offset % 8 || offset + sizeof(RecordHeader) > log->size) {
+    return 0;
+  }
+
+  const RecordHeader *h = (const RecordHeader *) (log->data + offset);
+  return h->magic == RECORD_MAGIC && offset + record_size(h->plies) <= log->size;
+}
+
+// Returns 1 if the index holds the offset of every record of the log,
+// one after the other, each one in bounds, 0 otherwise.
+static int record_index_valid(const RecordLog *log, const uint64_t *index, size_t isize) {
+  size_t count = isize / sizeof(uint64_t);
+  uint64_t offset = 0;
+
+  if (isize % sizeof(uint64_t)) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (index[i] != offset || !record_valid_at(log, offset)) {
+      return 0;
+    }
+    offset += record_size(((const RecordHeader *) (log->data + offset))->plies);
+  }
+
+  return offset == log->size;
+}
+
+// Walks the whole log to rebuild the offsets of its records. Only
+// needed when the index file is missing or out of date.
+static int record_log_rebuild_index(RecordLog *log) {
+  size_t capacity = 1024;
+  uint64_t *index = malloc(capacity * sizeof(uint64_t));
+  size_t count = 0;
+  uint64_t offset = 0;
+
+  while (offset < log->size) {
+    if (!record_valid_at(log, offset)) {
+      fprintf(stderr, "[ERROR] - corrupted game record at offset %lu\n", (unsigned long) offset);
+      free(index);
+      return -1;
+    }
+
+    if (count == capacity) {
+      capacity *= 2;
+      index = realloc(index, capacity * sizeof(uint64_t));
+    }
+    index[count++] = offset;
+    offset += record_size(((const RecordHeader *) (log->data + offset))->plies);
+  }
+
+  log->index = index;
+  log->count = count;
+  log->index_size = 0;
+  return 0;
+}
+
+int record_log_open(RecordLog *log, const char *path) {
+  memset(log, 0, sizeof(*log));
+
+  log->data = map_file(path, &log->size);
+  if (!log->data) {
+    return -1;
+  }
+
+  // use the index file only if it agrees with the log
+  char *ipath = index_path(path);
+  size_t isize = 0;
+  const uint64_t *index = map_file(ipath, &isize);
+  free(ipath);
+
+  if (index) {
+    if (record_index_valid(log, index, isize)) {
+      log->index = index;
+      log->count = isize / sizeof(uint64_t);
+      log->index_size = isize;
+      return 0;
+    }
+
+    munmap((void *) index, isize);
+  }
+
+  if (record_log_rebuild_index(log) < 0) {
+    record_log_close(log);
+    return -1;
+  }
+
+  return 0;
+}
+
+void record_log_close(RecordLog *log) {
+  if (log->index_size) {
+    munmap((void *) log->index, log->index_size);
+  } else {
+    free((void *) log->index);
+  }
+
+  if (log->data) {
+    munmap((void *) log->data, log->size);
+  }
+
+  memset(log, 0, sizeof(*log));
+}
+
+const RecordHeader *record_log_game(const RecordLog *log, size_t i) {
+  assert(i < log->count && "game index out of range");
+  return (const RecordHeader *) (log->data + log->index[i]);
+}
+
+const Move16 *record_moves(const RecordHeader *h) {
+  return (const Move16 *) (h + 1);
+}
+
+const Clock16 *record_clocks(const RecordHeader *h) {
+  return (const Clock16 *) (record_moves(h) + h->plies);
+}
+
+// Brings `board` to the position reached after `ply` plies of the
+// recorded game. Moves were validated when they were played, so here
+// they are simply applied.
+void record_replay(const RecordHeader *h, uint32_t ply, Board board) {
+  const Move16 *moves = record_moves(h);
+
+  memcpy(board, DEFAULT_BOARD, sizeof(Board));
+
+  if (ply > h->plies) {
+    ply = h->plies;
+  }
+
+  for (uint32_t i = 0; i < ply; i++) {
+    Pos from = SQUARE_TO_POS(MOVE_FROM(moves[i]));
+    Pos to = SQUARE_TO_POS(MOVE_TO(moves[i]));
+
+    board[to.y][to.x] = board[from.y][from.x];
+    board[from.y][from.x] = EMPTY;
+  }
+}
+
+// ----------------------------------------
+// WRITER
+
+int recorder_open(Recorder *r, const char *path) {
+  memset(r, 0, sizeof(*r));
+
+  // make sure the index is in sync before appending to it. Without
+  // a log to read, what is in the index is stale and goes away.
+  RecordLog existing;
+  int rewrite_index = 1;
+  if (record_log_open(&existing, path) == 0) {
+    rewrite_index = existing.index_size == 0;
+  }
+
+  char *ipath = index_path(path);
+  r->log = fopen(path, "ab");
+  r->index = fopen(ipath, rewrite_index ? "wb" : "ab");
+  free(ipath);
+
+  if (!r->log || !r->index) {
+    fprintf(stderr, "[ERROR] - could not open game log %s: %s\n", path, strerror(errno));
+    if (existing.data) {
+      record_log_close(&existing);
+    }
+    recorder_close(r);
+    return -1;
+  }
+
+  if (rewrite_index) {
+    fwrite(existing.index, sizeof(uint64_t), existing.count, r->index);
+  }
+  if (existing.data) {
+    record_log_close(&existing);
+  }
+
+  r->buffer = malloc(RECORD_WRITE_BUFFER);
+  setvbuf(r->log, r->buffer, _IOFBF, RECORD_WRITE_BUFFER);
+
+  fseek(r->log, 0, SEEK_END);
+  r->offset = ftell(r->log);
+
+  r->capacity = 256;
+  r->moves = malloc(r->capacity * sizeof(Move16));
+  r->clocks = malloc(r->capacity * sizeof(Clock16));
+
+  return 0;
+}
+
+void recorder_close(Recorder *r) {
+  if (r->log) {
+    fclose(r->log);
+  }
+  if (r->index) {
+    fclose(r->index);
+  }
+
+  free(r->buffer);
+  free(r->moves);
+  free(r->clocks);
+  memset(r, 0, sizeof(*r));
+}
+
+void recorder_begin(Recorder *r, uint64_t start_key, int white_starts, uint64_t timestamp, uint32_t now_ms) {
+  r->header = (RecordHeader) {
+    .magic = RECORD_MAGIC,
+    .version = RECORD_VERSION,
+    .result = RESULT_NONE,
+    .white_starts = white_starts,
+    .start_key = start_key,
+    .timestamp = timestamp,
+  };
+
+  r->start_ms = now_ms;
+  r->last_ms = now_ms;
+}
+
+void recorder_add_move(Recorder *r, Pos from, Pos to, uint32_t now_ms) {
+  if (!r->log || r->header.plies == RECORD_MAX_PLIES) {
+    return;
+  }
+
+  if (r->header.plies == r->capacity) {
+    r->capacity *= 2;
+    r->moves = realloc(r->moves, r->capacity * sizeof(Move16));
+    r->clocks = realloc(r->clocks, r->capacity * sizeof(Clock16));
+  }
+
+  uint32_t ply = r->header.plies++;
+  r->moves[ply] = MOVE_ENCODE(POS_TO_SQUARE(from), POS_TO_SQUARE(to), 0);
+  r->clocks[ply] = ms_to_ds(now_ms - r->last_ms);
+  r->last_ms = now_ms;
+}
+
+// Appends the current game to the log. Games without moves are not
+// recorded.
+void recorder_end(Recorder *r, GameResult result, uint32_t now_ms) {
+  if (!r->log || r->header.plies == 0) {
+    return;
+  }
+
+  static const uint8_t padding[8] = { 0 };
+  size_t size = record_size(r->header.plies);
+  size_t used = sizeof(RecordHeader) + r->header.plies * (sizeof(Move16) + sizeof(Clock16));
+  uint32_t duration = (now_ms - r->start_ms) / 100;
+
+  r->header.result = result;
+  r->header.duration_ds = duration;
+
+  fwrite(&r->header, sizeof(RecordHeader), 1, r->log);
+  fwrite(r->moves, sizeof(Move16), r->header.plies, r->log);
+  fwrite(r->clocks, sizeof(Clock16), r->header.plies, r->log);
+  fwrite(padding, 1, size - used, r->log);
+
+  // the index entry goes out only once the record itself is on disk
+  if (fflush(r->log) == 0) {
+    fwrite(&r->offset, sizeof(uint64_t), 1, r->index);
+    fflush(r->index);
+    r->offset += size;
+  } else {
+    fprintf(stderr, "[ERROR] - could not write game record: %s\n", strerror(errno));
+  }
+
+  r->header.plies = 0;
+}
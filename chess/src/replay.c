@@ -0,0 +1,151 @@
+/*
+  Headless replay of the games stored in the binary game log.
+
+  Usage:
+
+    ./chess_replay [log]                 summary of all the games
+    ./chess_replay <log> <game>          moves and clocks of a game
+    ./chess_replay <log> <game> <ply>    board after <ply> plies
+
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "./include/board.h"
+#include "./include/record.h"
+
+// ----------------------------------------
+
+static const char *result_name(uint8_t result) {
+  switch(result) {
+  case RESULT_BLACK_WON: return "black won";
+  case RESULT_WHITE_WON: return "white won";
+  case RESULT_ABORTED:   return "aborted";
+  default:               return "unknown";
+  }
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_square(int square) {
+  Pos p = SQUARE_TO_POS(square);
+  // NOTE: black starts on the top rows, which are rank 8 and 7
+  printf("%c%d", 'a' + p.x, BOARD_HEIGHT - p.y);
+}
+
+static void print_board(const PieceType *squares) {
+  for (int y = 0; y < BOARD_HEIGHT; y++) {
+    printf("%d ", BOARD_HEIGHT - y);
+    for (int x = 0; x < BOARD_WIDTH; x++) {
+      printf("%c", piece_to_char(squares[y * BOARD_WIDTH + x]));
+    }
+    printf("\n");
+  }
+  printf("  abcdefgh\n");
+}
+
+// ----------------------------------------
+
+static void summary(const RecordLog *log) {
+  size_t results[RESULT_ABORTED + 1] = { 0 };
+  uint64_t plies = 0;
+
+  double start = now_seconds();
+  for (size_t i = 0; i < log->count; i++) {
+    const RecordHeader *h = record_log_game(log, i);
+    plies += h->plies;
+    results[h->result <= RESULT_ABORTED ? h->result : RESULT_NONE] += 1;
+  }
+  double elapsed = now_seconds() - start;
+
+  printf("games:     %zu\n", log->count);
+  printf("plies:     %lu\n", (unsigned long) plies);
+  printf("black won: %zu\n", results[RESULT_BLACK_WON]);
+  printf("white won: %zu\n", results[RESULT_WHITE_WON]);
+  printf("aborted:   %zu\n", results[RESULT_ABORTED]);
+  printf("unknown:   %zu\n", results[RESULT_NONE]);
+  printf("log size:  %zu bytes (%.2f bytes/ply)\n", log->size, plies ? (double) log->size / plies : 0.0);
+  printf("scanned in %.3f ms\n", elapsed * 1e3);
+}
+
+static void show_game(const RecordHeader *h) {
+  const Move16 *moves = record_moves(h);
+  const Clock16 *clocks = record_clocks(h);
+
+  time_t t = (time_t) h->timestamp;
+  printf("started:   %s", ctime(&t));
+  printf("result:    %s\n", result_name(h->result));
+  printf("plies:     %u\n", h->plies);
+  printf("duration:  %.1f s\n", h->duration_ds / 10.0);
+  printf("start key: %016lx\n\n", (unsigned long) h->start_key);
+
+  for (uint32_t i = 0; i < h->plies; i++) {
+    printf("%4u. ", i + 1);
+    print_square(MOVE_FROM(moves[i]));
+    printf("-");
+    print_square(MOVE_TO(moves[i]));
+    printf("  %6.1f s\n", clocks[i] / 10.0);
+  }
+}
+
+static void show_position(const RecordHeader *h, uint32_t ply) {
+  Board board;
+
+  if (ply > h->plies) {
+    ply = h->plies;
+  }
+
+  if (h->start_key != board_zobrist_key(&DEFAULT_BOARD[0][0], h->white_starts)) {
+    fprintf(stderr, "[ERROR] - game does not start from the default position\n");
+    exit(1);
+  }
+
+  record_replay(h, ply, board);
+
+  // the side to move flips at every ply
+  int white_to_move = (h->white_starts + ply) % 2;
+  printf("ply %u of %u, %s to move, key %016lx\n\n",
+	 ply, h->plies,
+	 white_to_move ? "white" : "black",
+	 (unsigned long) board_zobrist_key(&board[0][0], white_to_move));
+  print_board(&board[0][0]);
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : RECORD_LOG_PATH;
+  RecordLog log;
+
+  if (record_log_open(&log, path) < 0) {
+    fprintf(stderr, "[ERROR] - could not open game log %s\n", path);
+    return 1;
+  }
+
+  if (argc <= 2) {
+    summary(&log);
+  } else {
+    size_t game = strtoul(argv[2], NULL, 10);
+    if (game >= log.count) {
+      fprintf(stderr, "[ERROR] - game %zu out of range (log has %zu games)\n", game, log.count);
+      record_log_close(&log);
+      return 1;
+    }
+
+    const RecordHeader *h = record_log_game(&log, game);
+    if (argc > 3) {
+      show_position(h, strtoul(argv[3], NULL, 10));
+    } else {
+      show_game(h);
+    }
+  }
+
+  record_log_close(&log);
+  return 0;
+}
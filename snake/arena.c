@@ -0,0 +1,295 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/arena.h"
+
+// random cells to try when looking for an empty one
+#define SPAWN_TRIES 16
+// food placed at most per step, when there is less than food_target
+#define FOOD_PER_STEP 64
+
+// -------------------
+// UTILS
+
+static int random_cell(Arena *arena) {
+  return (int) (((splitmix64(&arena->rng) >> 32) * (uint64_t) arena->cells) >> 32);
+}
+
+static int random_empty_cell(Arena *arena) {
+  for (int i = 0; i < SPAWN_TRIES; i++) {
+    int c = random_cell(arena);
+    if (arena->grid[c] == ARENA_EMPTY) {
+      return c;
+    }
+  }
+  return -1;
+}
+
+static int cell_of(const Arena *arena, Pos p) {
+  return p.y * arena->width + p.x;
+}
+
+static Pos pos_of(const Arena *arena, int cell) {
+  return (Pos) {cell % arena->width, cell / arena->width};
+}
+
+int arena_neighbor(const Arena *arena, int cell, Dir dir) {
+  int x = cell % arena->width;
+  int y = cell / arena->width;
+
+  switch (dir) {
+  case DIR_RIGHT: x = x + 1 == arena->width ? 0 : x + 1; break;
+  case DIR_LEFT:  x = x == 0 ? arena->width - 1 : x - 1; break;
+  case DIR_UP:    y = y == 0 ? arena->height - 1 : y - 1; break;
+  case DIR_DOWN:  y = y + 1 == arena->height ? 0 : y + 1; break;
+  }
+
+  return y * arena->width + x;
+}
+
+int arena_head(const Arena *arena, int snake) {
+  const Snake *s = &arena->snakes[snake].snake;
+  return cell_of(arena, SNAKE_AT(s, s->length - 1));
+}
+
+/*
+  Every change to the grid goes through here, so that the hash, the
+  food count and the list of changed cells are always up to date.
+*/
+static void arena_set(Arena *arena, int cell, uint32_t value) {
+  uint32_t old = arena->grid[cell];
+  if (old == value) {
+    return;
+  }
+
+  arena->hash ^= arena_cell_hash(cell, old) ^ arena_cell_hash(cell, value);
+  arena->food += (value == ARENA_FOOD) - (old == ARENA_FOOD);
+  arena->grid[cell] = value;
+
+  if (arena->changed_tick[cell] != arena->tick) {
+    arena->changed_tick[cell] = arena->tick;
+    arena->changed[arena->changed_count++] = cell;
+  }
+}
+
+// -------------------
+// SNAKES
+
+// Starts snake i again on an empty cell, if it finds one.
+static int spawn_snake(Arena *arena, int i) {
+  ArenaSnake *as = &arena->snakes[i];
+  int c = random_empty_cell(arena);
+
+  if (c < 0) {
+    as->respawn = 1;
+    return 0;
+  }
+
+  as->snake.tail = 0;
+  as->snake.length = 1;
+  as->snake.grow = ARENA_START_LENGTH - 1;
+  as->snake.body[0] = pos_of(arena, c);
+  as->snake.last_tail = as->snake.body[0];
+  as->snake.dir = (Dir) (splitmix64(&arena->rng) % 4);
+  as->alive = 1;
+  as->respawn = 0;
+  as->score = 0;
+
+  arena_set(arena, c, ARENA_SNAKE(i));
+  return 1;
+}
+
+// Removes a snake from the grid, leaving food on every other piece.
+static void kill_snake(Arena *arena, int i) {
+  ArenaSnake *as = &arena->snakes[i];
+
+  for (int k = 0; k < as->snake.length; k++) {
+    arena_set(arena, cell_of(arena, SNAKE_AT(&as->snake, k)), k % 2 ? ARENA_FOOD : ARENA_EMPTY);
+  }
+
+  as->alive = 0;
+  as->respawn = ARENA_RESPAWN_TICKS;
+  arena->deaths += 1;
+}
+
+void arena_turn(Arena *arena, int snake, Dir dir) {
+  ArenaSnake *as = &arena->snakes[snake];
+  Snake *s = &as->snake;
+
+  if (as->alive && s->length > 1 &&
+      arena_neighbor(arena, arena_head(arena, snake), dir) == cell_of(arena, SNAKE_AT(s, s->length - 2))) {
+    return;
+  }
+  s->dir = dir;
+}
+
+// -------------------
+// ARENA
+
+int arena_init(Arena *arena, int width, int height, int snakes, int food_every, uint64_t seed) {
+  memset(arena, 0, sizeof(*arena));
+
+  if (width < 1 || height < 1 || width > ARENA_MAX_SIDE || height > ARENA_MAX_SIDE ||
+      snakes < 0 || snakes > ARENA_MAX_SNAKES || food_every < 1) {
+    return 0;
+  }
+
+  arena->width = width;
+  arena->height = height;
+  arena->cells = width * height;
+  arena->count = snakes;
+  arena->food_target = arena->cells / food_every;
+  arena->rng = seed;
+
+  arena->grid = calloc(arena->cells, sizeof(uint32_t));
+  arena->claim_tick = calloc(arena->cells, sizeof(uint32_t));
+  arena->claim_by = calloc(arena->cells, sizeof(int32_t));
+  arena->changed = calloc(arena->cells, sizeof(int));
+  arena->changed_tick = calloc(arena->cells, sizeof(uint32_t));
+  arena->snakes = calloc(snakes > 0 ? snakes : 1, sizeof(ArenaSnake));
+
+  if (!arena->grid || !arena->claim_tick || !arena->claim_by ||
+      !arena->changed || !arena->changed_tick || !arena->snakes) {
+    arena_free(arena);
+    return 0;
+  }
+
+  for (int i = 0; i < snakes; i++) {
+    Snake *s = &arena->snakes[i].snake;
+    s->capacity = INITIAL_SNAKE_CAPACITY;
+    s->body = malloc(INITIAL_SNAKE_CAPACITY * sizeof(Pos));
+    if (!s->body) {
+      arena_free(arena);
+      return 0;
+    }
+    spawn_snake(arena, i);
+  }
+
+  while (arena->food < arena->food_target) {
+    int c = random_empty_cell(arena);
+    if (c < 0) {
+      break;
+    }
+    arena_set(arena, c, ARENA_FOOD);
+  }
+
+  return 1;
+}
+
+void arena_free(Arena *arena) {
+  if (arena->snakes) {
+    for (int i = 0; i < arena->count; i++) {
+      free(arena->snakes[i].snake.body);
+    }
+  }
+  free(arena->snakes);
+  free(arena->grid);
+  free(arena->claim_tick);
+  free(arena->claim_by);
+  free(arena->changed);
+  free(arena->changed_tick);
+  memset(arena, 0, sizeof(*arena));
+}
+
+/*
+  All snakes move at once: first every tail that is not growing
+  leaves its cell, then the heads claim the cells they move into (two
+  claims on one cell kill both snakes), then heads that moved into a
+  body die, and only then the survivors take their cells.
+*/
+void arena_step(Arena *arena) {
+  arena->tick += 1;
+  arena->changed_count = 0;
+  arena->deaths = 0;
+  arena->eaten = 0;
+
+  for (int i = 0; i < arena->count; i++) {
+    ArenaSnake *as = &arena->snakes[i];
+    Snake *s = &as->snake;
+    if (!as->alive) {
+      continue;
+    }
+
+    as->target = arena_neighbor(arena, arena_head(arena, i), s->dir);
+
+    if (s->grow > 0) {
+      s->grow -= 1;
+    } else {
+      s->last_tail = s->body[s->tail];
+      arena_set(arena, cell_of(arena, s->last_tail), ARENA_EMPTY);
+      s->tail = (s->tail + 1) & (s->capacity - 1);
+      s->length -= 1;
+    }
+  }
+
+  // heads into the same cell, -1 marks the snakes that die
+  for (int i = 0; i < arena->count; i++) {
+    ArenaSnake *as = &arena->snakes[i];
+    if (!as->alive) {
+      continue;
+    }
+
+    int c = as->target;
+    if (arena->claim_tick[c] == arena->tick) {
+      arena->snakes[arena->claim_by[c]].target = -1;
+      as->target = -1;
+    } else {
+      arena->claim_tick[c] = arena->tick;
+      arena->claim_by[c] = i;
+    }
+  }
+
+  // heads into a body
+  for (int i = 0; i < arena->count; i++) {
+    ArenaSnake *as = &arena->snakes[i];
+    if (as->alive && as->target >= 0 && ARENA_IS_SNAKE(arena->grid[as->target])) {
+      as->target = -1;
+    }
+  }
+
+  // the cells of the snakes that died cannot be the target of one
+  // that did not, so they can be cleared before the others move
+  for (int i = 0; i < arena->count; i++) {
+    ArenaSnake *as = &arena->snakes[i];
+    if (as->alive && as->target < 0) {
+      kill_snake(arena, i);
+    }
+  }
+
+  for (int i = 0; i < arena->count; i++) {
+    ArenaSnake *as = &arena->snakes[i];
+    Snake *s = &as->snake;
+    if (!as->alive) {
+      continue;
+    }
+
+    if (arena->grid[as->target] == ARENA_FOOD) {
+      s->grow += 1;
+      as->score += 1;
+      arena->eaten += 1;
+    }
+
+    if (!grow_body(s)) {
+      kill_snake(arena, i);
+      continue;
+    }
+    s->body[(s->tail + s->length) & (s->capacity - 1)] = pos_of(arena, as->target);
+    s->length += 1;
+    arena_set(arena, as->target, ARENA_SNAKE(i));
+  }
+
+  // after the others moved, so that they do not start on a target
+  for (int i = 0; i < arena->count; i++) {
+    ArenaSnake *as = &arena->snakes[i];
+    if (!as->alive && --as->respawn <= 0) {
+      spawn_snake(arena, i);
+    }
+  }
+
+  for (int i = 0; i < FOOD_PER_STEP && arena->food < arena->food_target; i++) {
+    int c = random_empty_cell(arena);
+    if (c >= 0) {
+      arena_set(arena, c, ARENA_FOOD);
+    }
+  }
+}
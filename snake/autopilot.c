@@ -0,0 +1,694 @@
+/*
+  Snake that plays on its own, see include/autopilot.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/autopilot.h"
+
+// -------------------
+// STRUTTURE DATI
+
+struct AutopilotNode {
+  int f;     // dist + estimate of what is left
+  int dist;
+  int cell;
+};
+
+typedef enum {
+  SEARCH_FOOD,   // the shortest path to the food
+  SEARCH_TAIL,   // any path to a cell the tail will have left
+} SearchKind;
+
+// what a search finds in a cell at some distance from the start
+typedef enum {
+  CELL_BLOCKED = 0,
+  CELL_OPEN,
+  CELL_GOAL,
+} Reach;
+
+typedef struct {
+  SearchKind kind;
+  int target;   // where the estimate points to
+  // SEARCH_TAIL only: the index, in the body followed by the path,
+  // of the tail at the end of the path, how many moves it will stay
+  // there, and how many free cells are enough for the head to wait
+  // until the tail has moved on
+  int cut;
+  int grow;
+  int room;
+} Search;
+
+// -------------------
+// BOARD
+
+static int cell_step(const Autopilot *ap, int c, Dir dir) {
+  int x = c % ap->width;
+  int y = c / ap->width;
+
+  switch (dir) {
+  case DIR_RIGHT: x = x + 1 == ap->width ? 0 : x + 1; break;
+  case DIR_LEFT:  x = x == 0 ? ap->width - 1 : x - 1; break;
+  case DIR_UP:    y = y == 0 ? ap->height - 1 : y - 1; break;
+  case DIR_DOWN:  y = y + 1 == ap->height ? 0 : y + 1; break;
+  }
+
+  return y * ap->width + x;
+}
+
+static int is_neighbor(const Autopilot *ap, int a, int b) {
+  for (int d = 0; d < 4; d++) {
+    if (cell_step(ap, a, (Dir) d) == b) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static Action toward(const Autopilot *ap, int from, int to) {
+  for (int d = 0; d < 4; d++) {
+    if (cell_step(ap, from, (Dir) d) == to) {
+      return (Action) (ACTION_RIGHT + d);
+    }
+  }
+  return ACTION_NONE;
+}
+
+// moves between two cells, the board wraps around
+static int board_distance(const Autopilot *ap, int a, int b) {
+  int dx = abs(a % ap->width - b % ap->width);
+  int dy = abs(a / ap->width - b / ap->width);
+  if (dx > ap->width - dx) dx = ap->width - dx;
+  if (dy > ap->height - dy) dy = ap->height - dy;
+  return dx + dy;
+}
+
+static int cell_of(const Autopilot *ap, Pos p) {
+  return p.y * ap->width + p.x;
+}
+
+static CellKind kind_of(const Autopilot *ap, const Game *game, int c) {
+  return board_at(game, c % ap->width, c / ap->width);
+}
+
+// -------------------
+// HAMILTONIAN CYCLE
+
+// steps along the cycle from position a to position b
+static int ahead(const Autopilot *ap, int a, int b) {
+  int d = b - a;
+  return d < 0 ? d + ap->cycle_len : d;
+}
+
+/*
+  Blocks of 2x2 cells go around counterclockwise (top left, bottom
+  left, bottom right, top right). Two blocks next to each other become
+  a single loop by swapping the two edges on the sides they share.
+*/
+static void join_blocks(Autopilot *ap, int a, int b, Dir dir) {
+  int a_tr = a + 1, a_bl = a + ap->width, a_br = a_bl + 1;
+  int b_tl = b, b_tr = b + 1, b_bl = b + ap->width;
+
+  switch (dir) {
+  case DIR_RIGHT:  // b is right of a
+    ap->next[a_br] = b_bl;
+    ap->next[b_tl] = a_tr;
+    break;
+  case DIR_DOWN:   // b is below a
+    ap->next[a_bl] = b_tl;
+    ap->next[b_tr] = a_br;
+    break;
+  case DIR_LEFT:
+    join_blocks(ap, b, a, DIR_RIGHT);
+    break;
+  case DIR_UP:
+    join_blocks(ap, b, a, DIR_DOWN);
+    break;
+  }
+}
+
+/*
+  Builds the cycle from a spanning tree of the blocks without
+  obstacles, visiting the tree breadth first. Blocks only wrap around
+  the board when its sides are even, and an odd last row or column is
+  left out.
+*/
+static int build_cycle(Autopilot *ap, const Game *game) {
+  int bw = ap->width / 2;
+  int bh = ap->height / 2;
+  int blocks = bw * bh;
+
+  for (int c = 0; c < ap->cells; c++) {
+    ap->order[c] = -1;
+    ap->next[c] = -1;
+  }
+  ap->cycle_len = 0;
+
+  if (blocks == 0) {
+    return 1;
+  }
+
+  uint8_t *usable = malloc(blocks);
+  int *queue = malloc(blocks * sizeof(int));
+  if (!usable || !queue) {
+    free(usable);
+    free(queue);
+    return 0;
+  }
+
+  int start = -1;
+  for (int b = 0; b < blocks; b++) {
+    int tl = (b / bw) * 2 * ap->width + (b % bw) * 2;
+    int cells[4] = {tl, tl + ap->width, tl + ap->width + 1, tl + 1};
+
+    usable[b] = 1;
+    for (int i = 0; i < 4; i++) {
+      if (kind_of(ap, game, cells[i]) == CELL_OBSTACLE) {
+	usable[b] = 0;
+      }
+    }
+    if (!usable[b]) {
+      continue;
+    }
+
+    for (int i = 0; i < 4; i++) {
+      ap->next[cells[i]] = cells[(i + 1) % 4];
+    }
+    if (start < 0) {
+      start = b;
+    }
+  }
+
+  if (start >= 0) {
+    int head = 0, len = 0;
+    queue[len++] = start;
+    usable[start] = 2;  // in the tree
+
+    while (head < len) {
+      int b = queue[head++];
+      int bx = b % bw, by = b / bw;
+
+      for (int d = 0; d < 4; d++) {
+	int nx = bx, ny = by;
+	switch ((Dir) d) {
+	case DIR_RIGHT: nx += 1; break;
+	case DIR_LEFT:  nx -= 1; break;
+	case DIR_UP:    ny -= 1; break;
+	case DIR_DOWN:  ny += 1; break;
+	}
+
+	if (ap->width % 2 == 0) nx = (nx + bw) % bw;
+	if (ap->height % 2 == 0) ny = (ny + bh) % bh;
+	if (nx < 0 || nx >= bw || ny < 0 || ny >= bh) {
+	  continue;
+	}
+
+	int n = ny * bw + nx;
+	if (usable[n] != 1) {
+	  continue;
+	}
+	usable[n] = 2;
+	queue[len++] = n;
+
+	join_blocks(ap,
+		    by * 2 * ap->width + bx * 2,
+		    ny * 2 * ap->width + nx * 2,
+		    (Dir) d);
+      }
+    }
+
+    // blocks that the tree could not reach are left out
+    int first = (start / bw) * 2 * ap->width + (start % bw) * 2;
+    int c = first;
+    do {
+      ap->order[c] = ap->cycle_len++;
+      c = ap->next[c];
+    } while (c != first);
+
+    for (int c = 0; c < ap->cells; c++) {
+      if (ap->order[c] < 0) {
+	ap->next[c] = -1;
+      }
+    }
+  }
+
+  free(usable);
+  free(queue);
+  return 1;
+}
+
+// -------------------
+// FOLLOWING THE SNAKE
+
+// Adds (sign = 1) or removes (sign = -1) a pair of consecutive pieces
+// of the body from the ordering counts.
+static void count_pair(Autopilot *ap, int a, int b, int sign) {
+  if (ap->order[a] < 0 || ap->order[b] < 0) {
+    ap->unordered += sign;
+  } else {
+    ap->span += sign * ahead(ap, ap->order[a], ap->order[b]);
+  }
+}
+
+/*
+  Catches up with the snake. After a single move only its two ends
+  changed, otherwise (a new game, or moves that were not seen) the
+  body is read again.
+*/
+static void follow_snake(Autopilot *ap, const Game *game) {
+  const Snake *snake = &game->snake;
+  int head = cell_of(ap, SNAKE_AT(snake, snake->length - 1));
+  int tail = cell_of(ap, SNAKE_AT(snake, 0));
+
+  if (ap->valid && head == ap->head &&
+      tail == ap->tail_cell && snake->length == ap->length) {
+    return;
+  }
+
+  // one move: the old head is now the neck, and the tail either
+  // stayed or moved to the next piece
+  int grew = snake->length == ap->length + 1 && tail == ap->tail_cell;
+  int moved = snake->length == ap->length && (snake->length == 1 || tail == ap->tail_next);
+  int neck = snake->length == 1 || cell_of(ap, SNAKE_AT(snake, snake->length - 2)) == ap->head;
+
+  if (ap->valid && (grew || moved) && neck && is_neighbor(ap, ap->head, head)) {
+    ap->entered[head] = ++ap->clock;
+    count_pair(ap, ap->head, head, 1);
+    if (moved) {
+      count_pair(ap, ap->tail_cell, tail, -1);
+    }
+  } else {
+    ap->unordered = 0;
+    ap->span = 0;
+    ap->path_len = 0;
+    ap->clock += snake->length;
+
+    int prev = -1;
+    for (int i = 0; i < snake->length; i++) {
+      int c = cell_of(ap, SNAKE_AT(snake, i));
+      ap->entered[c] = ap->clock - (snake->length - 1 - i);
+      if (prev >= 0) {
+	count_pair(ap, prev, c, 1);
+      }
+      prev = c;
+    }
+  }
+
+  ap->valid = 1;
+  ap->head = head;
+  ap->tail_cell = tail;
+  ap->tail_next = snake->length > 1 ? cell_of(ap, SNAKE_AT(snake, 1)) : head;
+  ap->length = snake->length;
+}
+
+// index of a cell of the snake from its tail
+static int body_index(const Autopilot *ap, int c) {
+  return (int) (ap->entered[c] - ap->entered[ap->tail_cell]);
+}
+
+// Whether the head can be on cell c after `moves` moves, as far as
+// the snake as it is now can tell.
+static int cell_free_after(const Autopilot *ap, const Game *game, int c, int moves) {
+  switch (kind_of(ap, game, c)) {
+  case CELL_OBSTACLE:
+    return 0;
+  case CELL_SNAKE:
+    // the head cannot turn back onto the neck, even if it is the tail
+    if (moves == 1 && body_index(ap, c) == ap->length - 2) {
+      return 0;
+    }
+    return moves >= body_index(ap, c) + 1 + game->snake.grow;
+  default:
+    return 1;
+  }
+}
+
+// -------------------
+// A*
+
+static int heap_less(const struct AutopilotNode *a, const struct AutopilotNode *b) {
+  // among equal estimates, prefer the cells furthest from the start
+  return a->f < b->f || (a->f == b->f && a->dist > b->dist);
+}
+
+static int heap_push(Autopilot *ap, struct AutopilotNode node) {
+  if (ap->heap_len == ap->heap_cap) {
+    int cap = ap->heap_cap * 2;
+    struct AutopilotNode *heap = realloc(ap->heap, cap * sizeof(*heap));
+    if (!heap) {
+      return 0;
+    }
+    ap->heap = heap;
+    ap->heap_cap = cap;
+  }
+
+  int i = ap->heap_len++;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!heap_less(&node, &ap->heap[parent])) {
+      break;
+    }
+    ap->heap[i] = ap->heap[parent];
+    i = parent;
+  }
+  ap->heap[i] = node;
+  return 1;
+}
+
+static struct AutopilotNode heap_pop(Autopilot *ap) {
+  struct AutopilotNode top = ap->heap[0];
+  struct AutopilotNode last = ap->heap[--ap->heap_len];
+
+  int i = 0;
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= ap->heap_len) {
+      break;
+    }
+    if (child + 1 < ap->heap_len && heap_less(&ap->heap[child + 1], &ap->heap[child])) {
+      child += 1;
+    }
+    if (!heap_less(&ap->heap[child], &last)) {
+      break;
+    }
+    ap->heap[i] = ap->heap[child];
+    i = child;
+  }
+  ap->heap[i] = last;
+  return top;
+}
+
+static Reach reach(const Autopilot *ap, const Game *game, const Search *s, int c, int dist) {
+  if (s->kind == SEARCH_FOOD) {
+    // past the first move, keep one move to spare in case the snake
+    // eats food that shows up on the way
+    if (!cell_free_after(ap, game, c, dist > 1 ? dist - 1 : dist)) {
+      return CELL_BLOCKED;
+    }
+    return c == s->target ? CELL_GOAL : CELL_OPEN;
+  }
+
+  // the body, followed by the path being checked, ends with the
+  // snake as it will be at the end of the path
+  int index;
+  if (ap->planned[c] == ap->check) {
+    index = ap->length - 1 + ap->planned_at[c];
+  } else if (kind_of(ap, game, c) == CELL_SNAKE) {
+    index = body_index(ap, c);
+  } else {
+    return kind_of(ap, game, c) == CELL_OBSTACLE ? CELL_BLOCKED : CELL_OPEN;
+  }
+
+  if (index < s->cut) {
+    return CELL_OPEN;
+  }
+  // a cell the tail will have left, from there on the head can follow
+  // it (again with one move to spare)
+  return dist > index - s->cut + 1 + s->grow ? CELL_GOAL : CELL_BLOCKED;
+}
+
+/*
+  Returns the goal that was found, or -1. Distances from the start,
+  and where each cell was reached from, are left in dist[] and
+  parent[].
+*/
+static int search(Autopilot *ap, const Game *game, int start, const Search *s) {
+  if (++ap->epoch == 0) {
+    memset(ap->seen, 0, ap->cells * sizeof(*ap->seen));
+    ap->epoch = 1;
+  }
+  ap->searches += 1;
+
+  int settled = 0;
+  ap->heap_len = 0;
+  ap->seen[start] = ap->epoch;
+  ap->dist[start] = 0;
+  ap->parent[start] = -1;
+  heap_push(ap, (struct AutopilotNode) {board_distance(ap, start, s->target), 0, start});
+
+  while (ap->heap_len > 0) {
+    struct AutopilotNode node = heap_pop(ap);
+    if (node.dist != ap->dist[node.cell]) {
+      continue;  // reached again from closer since
+    }
+    if (s->kind == SEARCH_FOOD && node.cell == s->target) {
+      return node.cell;
+    }
+    if (s->kind == SEARCH_TAIL && ++settled > s->room) {
+      return node.cell;
+    }
+
+    for (int d = 0; d < 4; d++) {
+      int c = cell_step(ap, node.cell, (Dir) d);
+      int dist = node.dist + 1;
+
+      Reach r = reach(ap, game, s, c, dist);
+      if (r == CELL_GOAL && s->kind == SEARCH_TAIL) {
+	return c;
+      }
+      if (r == CELL_BLOCKED || (ap->seen[c] == ap->epoch && ap->dist[c] <= dist)) {
+	continue;
+      }
+
+      ap->seen[c] = ap->epoch;
+      ap->dist[c] = dist;
+      ap->parent[c] = node.cell;
+      if (!heap_push(ap, (struct AutopilotNode) {dist + board_distance(ap, c, s->target), dist, c})) {
+	return -1;
+      }
+    }
+  }
+
+  return -1;
+}
+
+/*
+  Whether, after following the path, the head can still get to the
+  cells that the tail is leaving, so that the snake can always keep
+  moving behind it.
+*/
+static int path_is_safe(Autopilot *ap, const Game *game, const int *path, int len, int food) {
+  const Snake *snake = &game->snake;
+
+  if (++ap->check == 0) {
+    memset(ap->planned, 0, ap->cells * sizeof(*ap->planned));
+    ap->check = 1;
+  }
+  for (int k = 0; k < len; k++) {
+    ap->planned[path[k]] = ap->check;
+    ap->planned_at[path[k]] = k + 1;
+  }
+
+  int grown = snake->grow < len ? snake->grow : len;
+  int length = snake->length + grown;
+
+  Search s = {0};
+  s.kind = SEARCH_TAIL;
+  s.cut = snake->length + len - length;
+  s.grow = snake->grow - grown + (path[len - 1] == food);
+  s.room = 4 * (length + s.grow);
+  s.target = s.cut < snake->length
+    ? cell_of(ap, SNAKE_AT(snake, s.cut))
+    : path[s.cut - snake->length];
+
+  return search(ap, game, path[len - 1], &s) >= 0;
+}
+
+// Finds a safe path to the food, and makes it the one to follow.
+static int plan_path(Autopilot *ap, const Game *game, int food) {
+  Search s = {0};
+  s.kind = SEARCH_FOOD;
+  s.target = food;
+
+  if (search(ap, game, ap->head, &s) < 0) {
+    return 0;
+  }
+
+  int len = ap->dist[food];
+  for (int c = food, i = len - 1; i >= 0; c = ap->parent[c], i--) {
+    ap->spare[i] = c;
+  }
+
+  if (!path_is_safe(ap, game, ap->spare, len, food)) {
+    return 0;
+  }
+
+  int *path = ap->path;
+  ap->path = ap->spare;
+  ap->spare = path;
+  ap->path_len = len;
+  ap->path_pos = 0;
+  ap->path_food = food;
+  return 1;
+}
+
+static Action path_step(Autopilot *ap) {
+  return toward(ap, ap->head, ap->path[ap->path_pos++]);
+}
+
+// -------------------
+// MOVES
+
+/*
+  Next cell along the cycle, or a shortcut further along it towards
+  the food. A shortcut must leave, before the tail, more free cells
+  than the snake can still grow, so that the head never catches up
+  with it. Only valid while the body lies along the cycle in order.
+*/
+static int cycle_move(Autopilot *ap, const Game *game, int food) {
+  const Snake *snake = &game->snake;
+  int head = ap->order[ap->head];
+  int room = snake->length == 1 ? ap->cycle_len : ahead(ap, head, ap->order[ap->tail_cell]);
+  int goal = food >= 0 ? ap->order[food] : -1;
+  int best = -1, best_left = 0;
+
+  for (int d = 0; d < 4; d++) {
+    int c = cell_step(ap, ap->head, (Dir) d);
+    if (ap->order[c] < 0) {
+      continue;
+    }
+
+    int step = ahead(ap, head, ap->order[c]);
+    if (c == ap->next[ap->head]) {
+      if (!cell_free_after(ap, game, c, 1)) {
+	continue;
+      }
+    } else if (step >= room || room - step <= snake->grow + 2) {
+      continue;
+    }
+
+    int left = goal >= 0 ? ahead(ap, ap->order[c], goal) : -step;
+    if (best < 0 || left < best_left) {
+      best = c;
+      best_left = left;
+    }
+  }
+
+  if (best >= 0) {
+    ap->cycle_moves += 1;
+  }
+  return best;
+}
+
+/*
+  Without a safe path or an ordered body: a move after which the tail
+  can still be reached, along the cycle if possible, so that the body
+  gets back in order.
+*/
+static int survival_move(Autopilot *ap, const Game *game, int food) {
+  int best = -1, best_rank = 0;
+
+  for (int d = 0; d < 4; d++) {
+    int c = cell_step(ap, ap->head, (Dir) d);
+    if (!cell_free_after(ap, game, c, 1)) {
+      continue;
+    }
+
+    int rank = 1;
+    if (path_is_safe(ap, game, &c, 1, food)) {
+      rank = c == ap->next[ap->head] ? 4 : ap->order[c] >= 0 ? 3 : 2;
+    }
+    if (rank > best_rank) {
+      best = c;
+      best_rank = rank;
+    }
+  }
+
+  return best;
+}
+
+// -------------------
+
+int autopilot_init(Autopilot *ap, const Game *game) {
+  memset(ap, 0, sizeof(*ap));
+
+  if ((long) game->board.width * game->board.height > AUTOPILOT_MAX_CELLS) {
+    return 0;
+  }
+  ap->width = game->board.width;
+  ap->height = game->board.height;
+  ap->cells = ap->width * ap->height;
+
+  ap->order = malloc(ap->cells * sizeof(int));
+  ap->next = malloc(ap->cells * sizeof(int));
+  ap->entered = calloc(ap->cells, sizeof(uint32_t));
+  ap->path = malloc(ap->cells * sizeof(int));
+  ap->spare = malloc(ap->cells * sizeof(int));
+  ap->seen = calloc(ap->cells, sizeof(uint32_t));
+  ap->dist = malloc(ap->cells * sizeof(int));
+  ap->parent = malloc(ap->cells * sizeof(int));
+  ap->planned = calloc(ap->cells, sizeof(uint32_t));
+  ap->planned_at = malloc(ap->cells * sizeof(int));
+  ap->heap_cap = 1024;
+  ap->heap = malloc(ap->heap_cap * sizeof(*ap->heap));
+
+  if (!ap->order || !ap->next || !ap->entered || !ap->path || !ap->spare || !ap->seen ||
+      !ap->dist || !ap->parent || !ap->planned || !ap->planned_at || !ap->heap ||
+      !build_cycle(ap, game)) {
+    autopilot_free(ap);
+    return 0;
+  }
+
+  return 1;
+}
+
+void autopilot_free(Autopilot *ap) {
+  free(ap->order);
+  free(ap->next);
+  free(ap->entered);
+  free(ap->path);
+  free(ap->spare);
+  free(ap->seen);
+  free(ap->dist);
+  free(ap->parent);
+  free(ap->planned);
+  free(ap->planned_at);
+  free(ap->heap);
+  memset(ap, 0, sizeof(*ap));
+}
+
+Action autopilot_decide(Autopilot *ap, const Game *game) {
+  follow_snake(ap, game);
+
+  int food = -1;
+  for (int i = 0; i < FOODS_COUNT; i++) {
+    if (game->food[i].score > 0) {
+      food = cell_of(ap, game->food[i].pos);
+      break;
+    }
+  }
+
+  // a path that was found safe stays safe up to its end, even if the
+  // food moved away from it in the meantime
+  int on_path = ap->path_pos > 0 && ap->path_pos < ap->path_len &&
+    ap->path[ap->path_pos - 1] == ap->head &&
+    cell_free_after(ap, game, ap->path[ap->path_pos], 1);
+
+  if (on_path && ap->path_food == food) {
+    return path_step(ap);
+  }
+
+  int ordered = ap->unordered == 0 && ap->order[ap->head] >= 0 && ap->span < ap->cycle_len;
+  int long_snake = 2 * (game->snake.length + game->snake.grow) >= ap->cycle_len;
+
+  // long snakes stay on the cycle, so they only eat food on it
+  if (food >= 0 && !long_snake && plan_path(ap, game, food)) {
+    return path_step(ap);
+  }
+
+  if (on_path) {
+    return path_step(ap);
+  }
+  ap->path_len = 0;
+
+  if (ordered) {
+    int c = cycle_move(ap, game, food);
+    if (c >= 0) {
+      return toward(ap, ap->head, c);
+    }
+  }
+
+  int c = survival_move(ap, game, food);
+  return c >= 0 ? toward(ap, ap->head, c) : ACTION_NONE;
+}
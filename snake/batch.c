@@ -0,0 +1,381 @@
+/*
+  Batch of snake games, see include/batch.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/batch.h"
+
+// games are stepped in chunks: first the moves of the whole chunk are
+// worked out as plain loops over small arrays, then applied
+#define CHUNK 64
+
+#define BIT_GET(bits, c) (((bits)[(c) >> 6] >> ((c) & 63)) & 1)
+#define BIT_SET(bits, c) ((bits)[(c) >> 6] |= 1ULL << ((c) & 63))
+
+_Static_assert(BATCH_WIDTH <= BATCH_STRIDE, "rows wider than BATCH_STRIDE");
+
+// -------------------
+
+// Cell next to `cell` towards dir, wrapping around the board like
+// peak_next_pos(). It is cell +- 1 or +- BATCH_STRIDE, and a mask
+// takes a whole row or column off where that crosses an edge, with no
+// branch and no table, so that it vectorizes over many games.
+static inline int next_cell(int cell, int dir) {
+  int x = cell & (BATCH_STRIDE - 1);
+  int y = cell >> BATCH_ROW_BITS;
+  int right = dir == DIR_RIGHT, up = dir == DIR_UP;
+  int left = dir == DIR_LEFT, down = dir == DIR_DOWN;
+
+  return cell + right - left + (down - up) * BATCH_STRIDE
+    - (BATCH_WIDTH & -(right & (x == BATCH_WIDTH - 1)))
+    + (BATCH_WIDTH & -(left & (x == 0)))
+    + (BATCH_GRID & -(up & (y == 0)))
+    - (BATCH_GRID & -(down & (y == BATCH_HEIGHT - 1)));
+}
+
+// Ticks per move at a given score, as update_game_speed().
+static int move_period(int score) {
+  double step_update = score * STEP_SNAKE_MOVEMENT;
+
+  if (MAX_SNAKE_MOVEMENT - step_update < MIN_SNAKE_MOVEMENT) {
+    return SECONDS_TO_TICKS(MIN_SNAKE_MOVEMENT);
+  } else {
+    return SECONDS_TO_TICKS(MAX_SNAKE_MOVEMENT - step_update);
+  }
+}
+
+static int random_range(Batch *b, size_t i, int n) {
+  return (int) (((splitmix64(&b->rng[i]) >> 32) * (uint64_t) n) >> 32);
+}
+
+// Picks a random cell of game i with neither snake nor walls, or
+// returns -1 if there is none.
+static int random_free_cell(Batch *b, size_t i) {
+  const uint64_t *taken = b->taken + i * BATCH_WORDS;
+  // the snake is never on a wall
+  int free = b->open_cells - b->length[i];
+
+  if (free <= 0) {
+    return -1;
+  }
+
+  int k = random_range(b, i, free);
+  for (int w = 0; w < BATCH_WORDS; w++) {
+    uint64_t empty = ~taken[w];
+    int n = __builtin_popcountll(empty);
+
+    if (k < n) {
+      // drop the k lowest empty cells of the word
+      while (k--) {
+	empty &= empty - 1;
+      }
+      return w * 64 + __builtin_ctzll(empty);
+    }
+    k -= n;
+  }
+
+  return -1;
+}
+
+static void place_food(Batch *b, size_t i) {
+  int cell = random_free_cell(b, i);
+  b->food_alive[i] = cell >= 0;
+  b->food[i] = cell >= 0 ? cell : 0;
+}
+
+// The observation as floats, four at a time: entry m holds bit k of m
+// at index k.
+static const float NIBBLE_FLOATS[16][4] = {
+  {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0}, {1, 1, 0, 0},
+  {0, 0, 1, 0}, {1, 0, 1, 0}, {0, 1, 1, 0}, {1, 1, 1, 0},
+  {0, 0, 0, 1}, {1, 0, 0, 1}, {0, 1, 0, 1}, {1, 1, 0, 1},
+  {0, 0, 1, 1}, {1, 0, 1, 1}, {0, 1, 1, 1}, {1, 1, 1, 1},
+};
+
+// Writes the observations of games [start, start + n), n <= CHUNK.
+// First what only needs the arrays of the games, as one bit per Dir,
+// with no branch so that it vectorizes, then the cells around each
+// head, which take a lookup in its bitboard. Each mask is written as
+// four floats with one copy.
+static void observe(Batch *b, size_t start, size_t n) {
+  const uint16_t *restrict head = b->head;
+  const uint16_t *restrict food = b->food;
+  const uint8_t *restrict food_alive = b->food_alive;
+  const uint8_t *restrict dirs = b->dir;
+
+  uint16_t around[4][CHUNK];
+  uint8_t towards[CHUNK];
+
+  for (size_t k = 0; k < n; k++) {
+    size_t i = start + k;
+    int h = head[i];
+    int hx = h & (BATCH_STRIDE - 1), hy = h >> BATCH_ROW_BITS;
+    int fx = food[i] & (BATCH_STRIDE - 1), fy = food[i] >> BATCH_ROW_BITS;
+
+    // the sign bit of a difference is a comparison
+    int mask = ((unsigned) (hx - fx) >> 31) << DIR_RIGHT | ((unsigned) (fy - hy) >> 31) << DIR_UP |
+      ((unsigned) (fx - hx) >> 31) << DIR_LEFT | ((unsigned) (hy - fy) >> 31) << DIR_DOWN;
+    towards[k] = mask & -food_alive[i];
+
+    // as in next_cell()
+    around[DIR_RIGHT][k] = h + 1 - (BATCH_WIDTH & -(hx == BATCH_WIDTH - 1));
+    around[DIR_UP][k]    = h - BATCH_STRIDE + (BATCH_GRID & -(hy == 0));
+    around[DIR_LEFT][k]  = h - 1 + (BATCH_WIDTH & -(hx == 0));
+    around[DIR_DOWN][k]  = h + BATCH_STRIDE - (BATCH_GRID & -(hy == BATCH_HEIGHT - 1));
+  }
+
+  for (size_t k = 0; k < n; k++) {
+    size_t i = start + k;
+    const uint64_t *taken = b->taken + i * BATCH_WORDS;
+    float *o = b->obs + i * BATCH_OBS_SIZE;
+    int blocked = 0;
+
+    for (int d = 0; d < 4; d++) {
+      blocked |= (int) BIT_GET(taken, around[d][k]) << d;
+    }
+
+    memcpy(o, NIBBLE_FLOATS[blocked], sizeof(NIBBLE_FLOATS[0]));
+    memcpy(o + 4, NIBBLE_FLOATS[towards[k]], sizeof(NIBBLE_FLOATS[0]));
+    memcpy(o + 8, NIBBLE_FLOATS[1 << dirs[i]], sizeof(NIBBLE_FLOATS[0]));
+  }
+}
+
+// -------------------
+
+Batch *batch_create(size_t count, uint64_t seed, float *obs) {
+  Batch *b = calloc(1, sizeof(Batch));
+  b->count = count;
+
+  b->head = calloc(count, sizeof(uint16_t));
+  b->tail = calloc(count, sizeof(uint16_t));
+  b->length = calloc(count, sizeof(uint16_t));
+  b->grow = calloc(count, sizeof(uint16_t));
+  b->dir = calloc(count, sizeof(uint8_t));
+  b->food = calloc(count, sizeof(uint16_t));
+  b->food_alive = calloc(count, sizeof(uint8_t));
+  b->food_ticks = calloc(count, sizeof(uint16_t));
+  b->period = calloc(count, sizeof(uint8_t));
+  b->score = calloc(count, sizeof(int32_t));
+  b->rng = calloc(count, sizeof(uint64_t));
+  b->body = calloc(count * BATCH_MAX_LENGTH, sizeof(uint16_t));
+  b->taken = calloc(count * BATCH_WORDS, sizeof(uint64_t));
+  b->reward = calloc(count, sizeof(float));
+  b->done = calloc(count, sizeof(uint8_t));
+
+  b->owns_obs = obs == NULL;
+  b->obs = obs ? obs : calloc(count * BATCH_OBS_SIZE, sizeof(float));
+
+  // the obstacles are the ones of init_game()
+  Game g;
+  if (new_game(&g, BATCH_WIDTH, BATCH_HEIGHT, seed)) {
+    for (int i = 0; i < OBSTACLES_COUNT; i++) {
+      if (g.obs[i].init) {
+	BIT_SET(b->walls, g.obs[i].pos.y * BATCH_STRIDE + g.obs[i].pos.x);
+      }
+    }
+    free_game(&g);
+  }
+
+  b->open_cells = BATCH_CELLS;
+  for (int w = 0; w < BATCH_WORDS; w++) {
+    b->open_cells -= __builtin_popcountll(b->walls[w]);
+  }
+
+  for (int c = 0; c < BATCH_WORDS * 64; c++) {
+    if ((c & (BATCH_STRIDE - 1)) >= BATCH_WIDTH || c >= BATCH_GRID) {
+      BIT_SET(b->walls, c);
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    b->rng[i] = seed + i;
+    batch_reset(b, i);
+  }
+
+  return b;
+}
+
+void batch_destroy(Batch *b) {
+  free(b->head);
+  free(b->tail);
+  free(b->length);
+  free(b->grow);
+  free(b->dir);
+  free(b->food);
+  free(b->food_alive);
+  free(b->food_ticks);
+  free(b->period);
+  free(b->score);
+  free(b->rng);
+  free(b->body);
+  free(b->taken);
+  free(b->reward);
+  free(b->done);
+  if (b->owns_obs) {
+    free(b->obs);
+  }
+  free(b);
+}
+
+// Starts a new game in slot i, keeping its random generator going, and
+// writes its observation.
+void batch_reset(Batch *b, size_t i) {
+  uint64_t *taken = b->taken + i * BATCH_WORDS;
+  memcpy(taken, b->walls, sizeof(b->walls));
+  b->length[i] = 0;
+
+  int cell = random_free_cell(b, i);
+  b->head[i] = cell;
+  b->tail[i] = 0;
+  b->length[i] = 1;
+  b->grow[i] = 0;
+  b->body[i * BATCH_MAX_LENGTH] = cell;
+  BIT_SET(taken, cell);
+
+  b->dir[i] = random_range(b, i, 4);
+  b->score[i] = 0;
+  b->period[i] = move_period(0);
+  b->food_ticks[i] = 0;
+  place_food(b, i);
+  observe(b, i, 1);
+}
+
+/*
+  Games are stepped CHUNK at a time, in passes over the chunk:
+
+  - the move of every game, from its arrays only and with no branch,
+    so that the compiler vectorizes it
+  - what each head runs into, with a lookup in the game's bitboard
+  - the new state of every game, also with no branch. Games that died
+    are updated as if they had not, which is harmless as batch_reset()
+    sets all of their state again
+  - the writes to the bitboards and bodies, and the rare cases
+    (eating, food moving, dying) that still branch
+  - the observations, see observe()
+
+  Games that ended are reset once the chunk is done, so that none of
+  the passes goes through batch_reset() in the middle.
+*/
+void batch_step(Batch *b, const Action *actions, size_t begin, size_t end) {
+  // the arrays never overlap, and saying so spares reloading every
+  // pointer of b after each store to a byte array
+  uint16_t *restrict head = b->head;
+  uint16_t *restrict tail = b->tail;
+  uint16_t *restrict length = b->length;
+  uint16_t *restrict grow = b->grow;
+  uint8_t *restrict dirs = b->dir;
+  uint16_t *restrict food = b->food;
+  uint8_t *restrict food_alive = b->food_alive;
+  uint16_t *restrict food_ticks = b->food_ticks;
+  uint8_t *restrict period = b->period;
+  int32_t *restrict score = b->score;
+  uint16_t *restrict bodies = b->body;
+  uint64_t *restrict boards = b->taken;
+  float *restrict reward = b->reward;
+  uint8_t *restrict done = b->done;
+
+  uint16_t next[CHUNK];
+  uint16_t leaves[CHUNK];  // cell of the tail before the move
+  uint16_t slots[CHUNK];   // slot of the new head in the body
+  uint8_t grows[CHUNK];
+  uint8_t hit[CHUNK];
+  uint8_t ate[CHUNK];
+  size_t ended[CHUNK];
+
+  for (size_t start = begin; start < end; start += CHUNK) {
+    size_t n = end - start < CHUNK ? end - start : CHUNK;
+    size_t ends = 0;
+
+    // where every head goes. Turning back into the neck is ignored.
+    for (size_t k = 0; k < n; k++) {
+      size_t i = start + k;
+      int dir = dirs[i];
+      int want = (int) actions[i] - ACTION_RIGHT;
+      int turn = (actions[i] != ACTION_NONE) & ((length[i] < 2) | (want != ((dir + 2) & 3)));
+
+      dir = turn ? want : dir;
+      dirs[i] = dir;
+      next[k] = next_cell(head[i], dir);
+      grows[k] = (grow[i] > 0) & (length[i] < BATCH_MAX_LENGTH);
+    }
+
+    // what the heads find there. The tail leaves its cell first unless
+    // the snake is growing, so running into it is fine.
+    for (size_t k = 0; k < n; k++) {
+      size_t i = start + k;
+      const uint64_t *taken = boards + i * BATCH_WORDS;
+      int to = next[k];
+
+      leaves[k] = bodies[i * BATCH_MAX_LENGTH + tail[i]];
+      // the tail is never on a wall
+      hit[k] = BIT_GET(taken, to) & (grows[k] | (to != leaves[k]));
+      ate[k] = food_alive[i] & (to == food[i]);
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      size_t i = start + k;
+      int t = tail[i] + !grows[k];
+
+      tail[i] = t == BATCH_MAX_LENGTH ? 0 : t;
+      length[i] += grows[k];
+      grow[i] += ate[k] - grows[k];
+
+      int slot = tail[i] + length[i] - 1;
+      slots[k] = slot >= BATCH_MAX_LENGTH ? slot - BATCH_MAX_LENGTH : slot;
+      head[i] = next[k];
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      size_t i = start + k;
+
+      // food moves after the ticks of a move at the speed before eating
+      food_ticks[i] += period[i];
+      score[i] += ate[k];
+      food_alive[i] &= !ate[k];
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      size_t i = start + k;
+      done[i] = hit[k];
+      reward[i] = (float) ate[k] - hit[k];
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      size_t i = start + k;
+      uint64_t *taken = boards + i * BATCH_WORDS;
+      uint64_t moves = !grows[k];
+
+      taken[leaves[k] >> 6] &= ~(moves << (leaves[k] & 63));
+      BIT_SET(taken, next[k]);
+      bodies[i * BATCH_MAX_LENGTH + slots[k]] = next[k];
+
+      if (hit[k]) {
+	ended[ends++] = i;
+	continue;
+      }
+      if (ate[k]) {
+	period[i] = move_period(score[i]);
+      }
+      if (food_ticks[i] >= FOOD_SPAWN_TICKS) {
+	food_ticks[i] = 0;
+	place_food(b, i);
+      }
+    }
+
+    observe(b, start, n);
+    for (size_t e = 0; e < ends; e++) {
+      batch_reset(b, ended[e]);
+    }
+  }
+}
+
+void batch_partition(const Batch *b, size_t parts, size_t part, size_t *begin, size_t *end) {
+  size_t blocks = (b->count + 63) / 64;
+  size_t first = blocks * part / parts * 64;
+  size_t last = blocks * (part + 1) / parts * 64;
+
+  *begin = first < b->count ? first : b->count;
+  *end = last < b->count ? last : b->count;
+}
@@ -0,0 +1,229 @@
+/*
+  Throughput of the headless simulator (see include/snake.h).
+
+  Usage:
+
+    ./snake_bench [-n steps] [-s seed] [-b games [-j threads]]
+
+  Plays games with a random agent that avoids dying when it can, and
+  counts the steps per second. Then it replays the first game from its
+  recorded actions and checks that it ends in exactly the same state.
+
+  With -b it steps a batch of games instead (see include/batch.h),
+  split across threads, with the agent reading the observations in
+  place.
+
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "./include/snake.h"
+#include "./include/batch.h"
+#include "./include/timing.h"
+
+#define DEFAULT_STEPS 10000000
+// games that last longer than this are cut short
+#define MAX_GAME_STEPS 100000
+
+// -------------------
+
+// Picks a random direction, preferring the ones that do not run into
+// anything on the next move.
+Action agent_act(Game *game, uint64_t *state) {
+  int first = xorshift64(state) % 4;
+
+  for (int i = 0; i < 4; i++) {
+    Dir d = (Dir) ((first + i) % 4);
+    CellKind next = board_get(game, peak_next_pos(game, d));
+
+    if (next == CELL_EMPTY || next == CELL_FOOD) {
+      return (Action) (ACTION_RIGHT + d);
+    }
+  }
+
+  return ACTION_NONE;
+}
+
+// Plays a game until the snake dies, recording the actions if asked.
+size_t play(Game *game, uint64_t seed, uint64_t *agent, Action *actions) {
+  size_t steps = 0;
+
+  init_game(game, seed);
+  while (!game->quit && steps < MAX_GAME_STEPS) {
+    Action a = agent_act(game, agent);
+    if (actions) {
+      actions[steps] = a;
+    }
+    snake_step(game, a);
+    steps += 1;
+  }
+
+  return steps;
+}
+
+// -------------------
+
+typedef struct {
+  Batch *batch;
+  Action *actions;
+  size_t begin;
+  size_t end;
+  size_t moves;     // moves of each game
+  uint64_t agent;
+  long eaten;
+  long died;
+} Worker;
+
+// Same agent as agent_act(), on the observations of the batch.
+void *batch_worker(void *arg) {
+  Worker *w = arg;
+  Batch *b = w->batch;
+
+  for (size_t m = 0; m < w->moves; m++) {
+    for (size_t i = w->begin; i < w->end; i++) {
+      const float *o = b->obs + i * BATCH_OBS_SIZE;
+      int first = xorshift64(&w->agent) % 4;
+
+      w->actions[i] = ACTION_NONE;
+      for (int k = 0; k < 4; k++) {
+	int d = (first + k) % 4;
+	if (!o[d]) {
+	  w->actions[i] = (Action) (ACTION_RIGHT + d);
+	  break;
+	}
+      }
+    }
+
+    batch_step(b, w->actions, w->begin, w->end);
+
+    for (size_t i = w->begin; i < w->end; i++) {
+      w->eaten += b->reward[i] > 0;
+      w->died += b->done[i];
+    }
+  }
+
+  return NULL;
+}
+
+int bench_batch(size_t target, uint64_t seed, size_t games, size_t threads) {
+  Batch *b = batch_create(games, seed, NULL);
+  Action *actions = calloc(games, sizeof(Action));
+  Worker *workers = calloc(threads, sizeof(Worker));
+  pthread_t *ids = calloc(threads, sizeof(pthread_t));
+  size_t moves = (target + games - 1) / games;
+
+  double start = now_seconds();
+
+  for (size_t t = 0; t < threads; t++) {
+    workers[t] = (Worker){ .batch = b, .actions = actions, .moves = moves, .agent = (seed + t) | 1 };
+    batch_partition(b, threads, t, &workers[t].begin, &workers[t].end);
+    pthread_create(&ids[t], NULL, batch_worker, &workers[t]);
+  }
+
+  long eaten = 0;
+  long died = 0;
+  for (size_t t = 0; t < threads; t++) {
+    pthread_join(ids[t], NULL);
+    eaten += workers[t].eaten;
+    died += workers[t].died;
+  }
+
+  double elapsed = now_seconds() - start;
+  size_t steps = moves * games;
+
+  fprintf(stderr, "steps:     %zu (%zu games, %zu moves each)\n", steps, games, moves);
+  fprintf(stderr, "threads:   %zu\n", threads);
+  fprintf(stderr, "games:     %ld ended, %ld food eaten\n", died, eaten);
+  fprintf(stderr, "elapsed:   %.3f s\n", elapsed);
+  fprintf(stderr, "rate:      %.2f M steps/s\n", steps / elapsed / 1e6);
+
+  free(ids);
+  free(workers);
+  free(actions);
+  batch_destroy(b);
+  return 0;
+}
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-n steps] [-s seed] [-b games [-j threads]]\n", program);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  size_t target = DEFAULT_STEPS;
+  uint64_t seed = 1;
+  size_t batch = 0;
+  size_t threads = 1;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:s:b:j:")) != -1) {
+    switch (opt) {
+    case 'n': target = strtoull(optarg, NULL, 10); break;
+    case 's': seed = strtoull(optarg, NULL, 10); break;
+    case 'b': batch = strtoull(optarg, NULL, 10); break;
+    case 'j': threads = strtoull(optarg, NULL, 10); break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (batch) {
+    return bench_batch(target, seed, batch, threads ? threads : 1);
+  }
+
+  Game game;
+  Action *actions = malloc(MAX_GAME_STEPS * sizeof(Action));
+  uint64_t agent = seed | 1;
+
+  if (!new_game(&game, DEFAULT_BOARD_WIDTH, DEFAULT_BOARD_HEIGHT, seed) || !actions) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  size_t steps = 0;
+  size_t games = 0;
+  size_t first_steps = 0;
+  uint64_t first = 0;
+  long score = 0;
+  double start = now_seconds();
+
+  while (steps < target) {
+    size_t n = play(&game, seed + games, &agent, games == 0 ? actions : NULL);
+    if (games == 0) {
+      first_steps = n;
+      first = game_checksum(&game);
+    }
+
+    steps += n;
+    score += game.global_score;
+    games += 1;
+  }
+
+  double elapsed = now_seconds() - start;
+
+  // same seed, same actions, same game
+  init_game(&game, seed);
+  for (size_t i = 0; i < first_steps; i++) {
+    snake_step(&game, actions[i]);
+  }
+  int identical = game_checksum(&game) == first;
+
+  fprintf(stderr, "steps:     %zu\n", steps);
+  fprintf(stderr, "games:     %zu (%.1f score, %.0f steps per game)\n", games,
+	  (double) score / games, (double) steps / games);
+  fprintf(stderr, "elapsed:   %.3f s\n", elapsed);
+  fprintf(stderr, "rate:      %.2f M steps/s\n", steps / elapsed / 1e6);
+  fprintf(stderr, "replay:    %s after %zu steps\n", identical ? "identical" : "DIFFERENT", first_steps);
+
+  free(actions);
+  free_game(&game);
+
+  return identical ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+/*
+  Headless client of the snake server (see server.c).
+
+  Usage:
+
+    ./snake_client [-p port | -u path] [-t ticks]
+
+  Connects to a server on 127.0.0.1:port or on a Unix socket, keeps a
+  copy of the board from what the server sends, and checks it against
+  the hash sent with every message. It steers its snake towards food
+  next to the head, or anywhere free. After `ticks` ticks (100 unless
+  given) it prints how many bytes each tick took.
+
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "./include/arena.h"
+#include "./include/wire.h"
+
+#define DEFAULT_PORT 7777
+#define DEFAULT_TICKS 100
+
+// -------------------
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-p port | -u path] [-t ticks]\n", program);
+  exit(1);
+}
+
+int connect_to(int port, const char *path) {
+  int fd;
+
+  if (path) {
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+      fprintf(stderr, "socket path too long: %s\n", path);
+      return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+      perror(path);
+      return -1;
+    }
+  } else {
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+      perror("connect");
+      return -1;
+    }
+  }
+
+  return fd;
+}
+
+// Cell next to `cell` towards dir, as arena_neighbor().
+int neighbor(const WireGrid *wg, int cell, Dir dir) {
+  int x = cell % wg->width;
+  int y = cell / wg->width;
+
+  switch (dir) {
+  case DIR_RIGHT: x = x + 1 == wg->width ? 0 : x + 1; break;
+  case DIR_LEFT:  x = x == 0 ? wg->width - 1 : x - 1; break;
+  case DIR_UP:    y = y == 0 ? wg->height - 1 : y - 1; break;
+  case DIR_DOWN:  y = y + 1 == wg->height ? 0 : y + 1; break;
+  }
+
+  return y * wg->width + x;
+}
+
+// Where the head of our snake goes next: food if it is next to it,
+// otherwise the first free cell.
+int choose_dir(const WireGrid *wg, int head) {
+  int best = -1;
+  int best_score = 0;
+
+  for (int d = 0; d < 4; d++) {
+    uint32_t v = wg->grid[neighbor(wg, head, (Dir) d)];
+    int score = v == ARENA_FOOD ? 2 : v == ARENA_EMPTY ? 1 : 0;
+    if (score > best_score) {
+      best = d;
+      best_score = score;
+    }
+  }
+
+  return best;
+}
+
+// Cell that our snake moved into on the last delta, -1 if none.
+int find_head(const WireGrid *wg, const uint8_t *msg, size_t len) {
+  Reader r = {msg + WIRE_HEADER + 1, msg + len, 0};
+  reader_varint(&r);
+  reader_u64(&r);
+  uint64_t count = reader_varint(&r);
+
+  uint64_t c = 0;
+  int head = -1;
+  for (uint64_t i = 0; i < count && !r.error; i++) {
+    c += reader_varint(&r);
+    if (reader_varint(&r) == ARENA_SNAKE(wg->snake)) {
+      head = (int) c;
+    }
+  }
+  return head;
+}
+
+int main(int argc, char **argv) {
+  int port = DEFAULT_PORT;
+  const char *path = NULL;
+  long ticks = DEFAULT_TICKS;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:u:t:")) != -1) {
+    switch (opt) {
+    case 'p': port = atoi(optarg); break;
+    case 'u': path = optarg; break;
+    case 't': ticks = atol(optarg); break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  int fd = connect_to(port, path);
+  if (fd < 0) {
+    return 1;
+  }
+
+  WireGrid wg = {0};
+  Buffer in = {0};
+  long deltas = 0;
+  long delta_bytes = 0;
+  long keyframe_bytes = 0;
+  long mismatches = 0;
+
+  while (deltas < ticks) {
+    uint8_t chunk[1 << 16];
+    ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+    if (n <= 0) {
+      fprintf(stderr, "connection closed\n");
+      break;
+    }
+    buffer_put_bytes(&in, chunk, n);
+
+    long size;
+    while ((size = wire_message_size(in.data, in.len)) > 0 && deltas < ticks) {
+      int type = wire_apply(&wg, in.data, size);
+      if (type < 0) {
+	fprintf(stderr, "malformed message\n");
+	return 1;
+      }
+
+      if (type == WIRE_KEYFRAME) {
+	keyframe_bytes = size;
+      }
+      if (type == WIRE_DELTA) {
+	deltas += 1;
+	delta_bytes += size;
+
+	int head = wg.snake >= 0 ? find_head(&wg, in.data, size) : -1;
+	int dir = head >= 0 ? choose_dir(&wg, head) : -1;
+	if (dir >= 0) {
+	  uint8_t byte = (uint8_t) dir;
+	  send(fd, &byte, 1, 0);
+	}
+      }
+      if (type != WIRE_HELLO && wg.hash != wg.expected) {
+	mismatches += 1;
+      }
+
+      buffer_consume(&in, size);
+    }
+
+    if (size < 0 || in.error) {
+      fprintf(stderr, "malformed message\n");
+      return 1;
+    }
+  }
+
+  fprintf(stderr, "board:     %dx%d, %d snakes, playing snake %d\n", wg.width, wg.height, wg.snakes, wg.snake);
+  fprintf(stderr, "ticks:     %ld, %.0f bytes per tick (keyframe %ld bytes)\n",
+	  deltas, deltas ? (double) delta_bytes / deltas : 0.0, keyframe_bytes);
+  fprintf(stderr, "hash:      %s\n", mismatches ? "MISMATCH" : "matches the server's");
+
+  close(fd);
+  buffer_free(&in);
+  wire_grid_free(&wg);
+
+  return mismatches > 0;
+}
@@ -0,0 +1,111 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdint.h>
+
+#include "./snake.h"
+
+// Many snakes on one shared board, all moving once per arena_step(),
+// for the multiplayer server (see server.c).
+//
+// The board is a grid with the owner of each cell: empty, food, or
+// the snake that is on it. Every collision is found by looking at the
+// cell a head moves into, so a step costs the same however long the
+// snakes are. Two heads that move into the same cell are found by
+// marking the cells claimed on the current step.
+//
+// Snakes that run into a body (theirs or another one) or into
+// another head die, half of their body turns into food, and after
+// ARENA_RESPAWN_TICKS steps they start again somewhere else. Tails
+// move before heads, so a snake can follow a tail closely. The board
+// wraps around its edges, as in the single player game.
+//
+// Every change to the grid is recorded, so that the cells that
+// changed on the last step can be sent to clients, together with a
+// hash of the whole grid that is kept up to date as it changes.
+
+#define ARENA_MAX_SIDE 4096
+#define ARENA_MAX_SNAKES 65536
+
+#define ARENA_START_LENGTH 3
+#define ARENA_RESPAWN_TICKS 20
+
+// values of the cells of the grid, snake i is on the cells ARENA_SNAKE(i)
+#define ARENA_EMPTY 0
+#define ARENA_FOOD 1
+#define ARENA_SNAKE(i) ((uint32_t) (i) + 2)
+#define ARENA_IS_SNAKE(v) ((v) >= 2)
+#define ARENA_SNAKE_ID(v) ((int) (v) - 2)
+
+// -------------------
+// STRUTTURE DATI
+
+typedef struct {
+  Snake snake;  // dir is where it goes on the next step
+  int alive;
+  int respawn;  // steps left before it starts again, while dead
+  int target;   // cell its head moves into on the current step
+  int score;
+} ArenaSnake;
+
+typedef struct {
+  int width;
+  int height;
+  int cells;
+
+  uint32_t *grid;       // value of each cell, row by row
+  // cells claimed by a head on the current step, where claim_tick[]
+  // holds the step, and by which snake
+  uint32_t *claim_tick;
+  int32_t *claim_by;
+
+  ArenaSnake *snakes;
+  int count;
+
+  int food;             // cells with food
+  int food_target;      // food kept on the board, at least
+
+  uint64_t rng;
+  uint32_t tick;
+  uint64_t hash;        // of the whole grid, see arena_cell_hash()
+
+  // cells that changed on the last step, each once, where
+  // changed_tick[] holds the step
+  int *changed;
+  int changed_count;
+  uint32_t *changed_tick;
+
+  // what happened on the last step, for the statistics
+  int deaths;
+  int eaten;
+} Arena;
+
+// -------------------
+// DICHIARAZIONI FUNZIONI
+
+// Hash of one cell holding a value. The hash of the grid is the xor of
+// those of all of its non empty cells, so that clients can compute it
+// the same way and check that their copy matches.
+static inline uint64_t arena_cell_hash(int cell, uint32_t value) {
+  uint64_t state = ((uint64_t) cell << 32) | value;
+  return value == ARENA_EMPTY ? 0 : splitmix64(&state);
+}
+
+// Returns 0 if the size is out of range or out of memory. Snakes start
+// at random cells, with food on about one cell in food_every.
+int arena_init(Arena *arena, int width, int height, int snakes, int food_every, uint64_t seed);
+void arena_free(Arena *arena);
+
+// Moves every snake that is alive one cell towards its dir, and
+// brings back the ones that waited long enough.
+void arena_step(Arena *arena);
+
+// Cell next to `cell` towards dir, wrapping around the board.
+int arena_neighbor(const Arena *arena, int cell, Dir dir);
+int arena_head(const Arena *arena, int snake);
+
+// Sets where a snake goes next. A snake cannot turn back onto itself,
+// so that turn is ignored.
+void arena_turn(Arena *arena, int snake, Dir dir);
+
+#endif // ARENA_H_
@@ -0,0 +1,96 @@
+#ifndef AUTOPILOT_H_
+#define AUTOPILOT_H_
+
+#include <stdint.h>
+
+#include "./snake.h"
+
+// Plays snake on its own, one decision per move of the snake.
+//
+// It first looks for a path to the food with A* over the board
+// (cells of the snake count as free once its tail has left them),
+// and only takes it if, once the food is eaten, the head can still
+// reach the tail. A path that passed the check is followed until the
+// food is eaten or moves, without searching again, and if the food
+// moved and there is no safe path to it, until its end.
+//
+// When there is no safe path, or once the snake covers half of the
+// board, it follows a Hamiltonian cycle of the board instead, taking
+// shortcuts along it towards the food as long as they cannot catch up
+// with the tail. As long as the body lies along the cycle in order,
+// following it can never end the game. The cycle is made of 2x2
+// blocks, so cells in a block with an obstacle are not on it: food
+// there is only taken while the snake is short, and a long snake
+// fills the cycle rather than the whole board.
+
+// it keeps a few ints for each cell of the board, so it only plays on
+// boards up to this size
+#define AUTOPILOT_MAX_CELLS (2048 * 2048)
+
+typedef struct {
+  int width;
+  int height;
+  int cells;
+
+  // the Hamiltonian cycle: the position of each cell along it and the
+  // cell after it, -1 for cells that are not on it
+  int *order;
+  int *next;
+  int cycle_len;
+
+  // state of the snake when it was last seen, to follow it one move
+  // at a time
+  int valid;
+  int head;
+  int tail_cell;
+  int tail_next;  // the piece after the tail
+  int length;
+  // move on which the snake entered each of its cells
+  uint32_t *entered;
+  uint32_t clock;
+  // consecutive pieces of the body that are not one after the other
+  // along the cycle, and how far along it the body spans
+  int unordered;
+  long span;
+
+  // path to the food that was found safe, and how much of it is left
+  int *path;
+  int *spare;     // the next one, while it is being checked
+  int path_len;
+  int path_pos;
+  int path_food;
+
+  // A* state, per cell, valid where seen[] holds the current epoch
+  uint32_t *seen;
+  uint32_t epoch;
+  int *dist;
+  int *parent;
+  // position of each cell of the path being checked, valid where
+  // planned[] holds the current check
+  uint32_t *planned;
+  uint32_t check;
+  int *planned_at;
+
+  // binary heap of the open cells
+  struct AutopilotNode *heap;
+  int heap_len;
+  int heap_cap;
+
+  // what was decided, for the statistics
+  long searches;
+  long cycle_moves;
+} Autopilot;
+
+// -------------------
+// DICHIARAZIONI FUNZIONI
+
+// Builds the cycle around the obstacles of the game. Returns 0 if the
+// board is larger than AUTOPILOT_MAX_CELLS or out of memory.
+int autopilot_init(Autopilot *ap, const Game *game);
+void autopilot_free(Autopilot *ap);
+
+// Where the snake should go on its next move. The game can be a new
+// one, or any number of moves ahead since the last call.
+Action autopilot_decide(Autopilot *ap, const Game *game);
+
+#endif // AUTOPILOT_H_
@@ -0,0 +1,99 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "./snake.h"
+
+// Many independent games of snake stepped together, one move each per
+// batch_step(), for training agents. The rules are the ones of
+// snake_step() (same board, obstacles, growth, speed and food
+// timing), but the state of the games is kept as structure of
+// arrays, with the walls and snake of each game as a bitboard, so
+// that the checks of a step run over plain arrays.
+//
+// Games that end are reset right away, with done set for that step,
+// so the batch always holds `count` running games. Each step writes
+// the observation of every game in `obs`, which callers can read (or
+// pass to their model) in place.
+//
+// Games are independent, so ranges of them can be stepped by
+// different threads at the same time, see batch_partition().
+
+// the games of a batch are played on a board of the default size
+#define BATCH_WIDTH DEFAULT_BOARD_WIDTH
+#define BATCH_HEIGHT DEFAULT_BOARD_HEIGHT
+#define BATCH_CELLS ((BATCH_WIDTH) * (BATCH_HEIGHT))
+#define BATCH_MAX_LENGTH BATCH_CELLS
+
+// Cells are numbered y * BATCH_STRIDE + x, the rows padded to a power
+// of two so that x and y of a cell are a mask and a shift. The cells
+// of the padding are walls.
+#define BATCH_ROW_BITS 5
+#define BATCH_STRIDE (1 << BATCH_ROW_BITS)
+#define BATCH_GRID (BATCH_STRIDE * (BATCH_HEIGHT))
+
+#define BATCH_WORDS ((BATCH_GRID + 63) / 64)
+
+// Observation of a game, BATCH_OBS_SIZE floats that are either 0 or 1:
+//
+//   0-3   the cell next to the head towards DIR_RIGHT, DIR_UP, DIR_LEFT
+//         and DIR_DOWN is blocked
+//   4-7   the food is towards that direction
+//   8-11  the snake is going in that direction
+#define BATCH_OBS_SIZE 12
+
+typedef struct {
+  size_t count;
+
+  // one entry per game
+  uint16_t *head;        // cell of the head, y * BATCH_STRIDE + x
+  uint16_t *tail;        // index of the tail in the game's body
+  uint16_t *length;
+  uint16_t *grow;        // moves left on which the tail stays
+  uint8_t *dir;
+  uint16_t *food;        // cell of the food, if food_alive
+  uint8_t *food_alive;
+  uint16_t *food_ticks;  // since the food was last placed
+  uint8_t *period;       // ticks per move at the current speed
+  int32_t *score;
+  uint64_t *rng;
+
+  // count * BATCH_MAX_LENGTH cells, the body of game i is a ring
+  // starting at body + i * BATCH_MAX_LENGTH, as in Snake
+  uint16_t *body;
+  // count * BATCH_WORDS words, bit c of game i is set if cell c is a
+  // wall or under its snake, so that a collision is a single bit test
+  uint64_t *taken;
+  // obstacles, plus the padding of the rows and the bits past the last
+  // row, same for every game
+  uint64_t walls[BATCH_WORDS];
+  int open_cells;        // cells that are not walls
+
+  // results of the last step
+  float *obs;            // count * BATCH_OBS_SIZE
+  float *reward;         // 1 if the game ate, -1 if it died
+  uint8_t *done;         // 1 if the game ended (and was reset)
+
+  int owns_obs;
+} Batch;
+
+// `obs` can be a buffer of count * BATCH_OBS_SIZE floats owned by the
+// caller, or NULL to have the batch allocate it. Game i is seeded with
+// seed + i.
+Batch *batch_create(size_t count, uint64_t seed, float *obs);
+void batch_destroy(Batch *b);
+
+// Starts a new game in slot i, with the random generator of the slot,
+// and writes its observation.
+void batch_reset(Batch *b, size_t i);
+
+// Moves games [begin, end) once, game i taking actions[i].
+void batch_step(Batch *b, const Action *actions, size_t begin, size_t end);
+
+// Range of games of the part-th of `parts` threads, in multiples of 64
+// games so that threads do not share cache lines.
+void batch_partition(const Batch *b, size_t parts, size_t part, size_t *begin, size_t *end);
+
+#endif // BATCH_H_
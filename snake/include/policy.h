@@ -0,0 +1,61 @@
+#ifndef POLICY_H_
+#define POLICY_H_
+
+#include <stddef.h>
+
+#include "./snake.h"
+#include "./batch.h"
+
+// A small neural network that plays snake, trained by snake_train (see
+// train.c) and loaded by the game as its autopilot.
+//
+// It looks at the observation of batch.h (what is next to the head,
+// where the food is, where the snake goes), has one hidden layer of
+// POLICY_HIDDEN ReLUs, and picks the direction with the highest of
+// its POLICY_OUTPUTS outputs. The weights are stored by input, so that
+// a layer adds up whole columns of a multiple of 4 floats, 4 floats at
+// a time.
+//
+// Checkpoints are text files, the sizes on the first line and then
+// the parameters, one per line.
+
+#define POLICY_INPUTS BATCH_OBS_SIZE
+#define POLICY_HIDDEN 16
+#define POLICY_OUTPUTS 4
+
+// hidden weights (POLICY_INPUTS columns of POLICY_HIDDEN) and biases,
+// then output weights (POLICY_HIDDEN columns of POLICY_OUTPUTS) and
+// biases
+#define POLICY_PARAMS (POLICY_INPUTS * POLICY_HIDDEN + POLICY_HIDDEN + \
+		       POLICY_HIDDEN * POLICY_OUTPUTS + POLICY_OUTPUTS)
+
+#define POLICY_MAGIC "snake-policy"
+#define POLICY_VERSION 1
+
+// -------------------
+// STRUTTURE DATI
+
+typedef struct {
+  float params[POLICY_PARAMS];
+} Policy;
+
+// -------------------
+// DICHIARAZIONI FUNZIONI
+
+// The observation of a game, as batch_step() writes it for the games
+// of a batch, into POLICY_INPUTS floats.
+void policy_observe(const Game *game, float *obs);
+
+// Actions of `count` games from their observations, one after the
+// other as in Batch.obs.
+void policy_act(const Policy *p, const float *obs, size_t count, Action *actions);
+
+// Where the snake of a game should go on its next move. Turning back
+// into the neck, which the batch ignores, gives ACTION_NONE.
+Action policy_decide(const Policy *p, const Game *game);
+
+// Return 0 on failure.
+int policy_save(const Policy *p, const char *path);
+int policy_load(Policy *p, const char *path);
+
+#endif // POLICY_H_
@@ -0,0 +1,99 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "./snake.h"
+#include "./wire.h"
+
+// Recording of a real-time game (one update_game_state() per tick),
+// as the seed and the inputs given between ticks, plus a snapshot of
+// the whole game every REPLAY_SNAPSHOT_TICKS ticks.
+//
+// Games are deterministic, so the inputs are enough to play a game
+// again, and to check the score it ended with. The snapshots are there
+// to seek: replay_seek() restores the last snapshot before the tick and
+// plays at most REPLAY_SNAPSHOT_TICKS ticks from there.
+//
+// Inputs take a varint each, with the ticks since the previous input,
+// and snapshots store the body of the snake as 2 bits per piece (the
+// direction to the next one), the board being rebuilt from the snake,
+// the food and the obstacles.
+
+#define REPLAY_SNAPSHOT_TICKS 1000
+
+#define REPLAY_MAGIC "SNKR"
+#define REPLAY_VERSION 1
+
+// -------------------
+// STRUTTURE DATI
+
+typedef enum {
+  INPUT_MOVE = 0,  // move_snake() with a key, right away
+  INPUT_TURN,      // the direction changes, for the next move (autopilot)
+} InputKind;
+
+typedef struct {
+  uint32_t tick;   // given before this tick ran
+  uint8_t kind;
+  uint8_t dir;
+} Input;
+
+typedef struct {
+  uint32_t tick;   // ticks that ran before it was taken
+  uint32_t input;  // first input given after it
+  size_t offset;   // of its bytes in data
+  size_t size;
+} Snapshot;
+
+typedef struct {
+  int width;
+  int height;
+  uint64_t seed;
+  uint32_t ticks;      // ticks recorded
+
+  Input *inputs;
+  uint32_t input_count;
+  uint32_t input_cap;
+
+  Snapshot *snapshots;
+  uint32_t snapshot_count;
+  uint32_t snapshot_cap;
+  Buffer data;         // the snapshots, one after the other
+
+  // how the game ended, to check it when playing it again
+  uint64_t checksum;
+  int score;
+
+  int error;           // out of memory while recording
+} Replay;
+
+// -------------------
+// DICHIARAZIONI FUNZIONI
+
+// Starts recording a game that was just created with new_game() (or
+// restarted with init_game()) from seed.
+int replay_begin(Replay *r, const Game *game, uint64_t seed);
+// Gives an input to the game and records it. With r NULL the game is
+// played without being recorded.
+void replay_play(Replay *r, Game *game, InputKind kind, Dir dir);
+// Runs a tick of the game and records it, unless r is NULL.
+void replay_tick(Replay *r, Game *game);
+// Records how the game ended.
+void replay_end(Replay *r, const Game *game);
+
+// Return 0 on failure.
+int replay_save(const Replay *r, const char *path);
+int replay_load(Replay *r, const char *path);
+void replay_free(Replay *r);
+
+// Puts game, created with the width and height of the replay, in the
+// state it was in after `tick` ticks. Returns the index of the next
+// input to play, or -1 if the replay is broken.
+long replay_seek(const Replay *r, Game *game, uint32_t tick);
+// Plays tick `tick` on a game that is right before it, starting from
+// the input at *input, which is moved past the inputs it played.
+void replay_step(const Replay *r, Game *game, uint32_t tick, uint32_t *input);
+
+#endif // REPLAY_H_
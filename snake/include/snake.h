@@ -0,0 +1,217 @@
+#ifndef SNAKE_H_
+#define SNAKE_H_
+
+#include <stdint.h>
+
+// Game logic of snake, without any rendering or global state, so that
+// it can run headless. Games are created with new_game(), restarted
+// with init_game() and freed with free_game(), and in between a game
+// only changes through update_game_state()
+// (one tick of the real-time game), move_snake() and snake_step()
+// (one move, for agents), and all of its randomness comes from its
+// own generator: the same seed and the same inputs always give the
+// same game.
+
+// The board is set when the game is created, up to MAX_BOARD_SIDE
+// cells per side. It is stored in chunks of CHUNK_SIDE x CHUNK_SIDE
+// cells, and only the chunks with something in them are allocated, so
+// that the memory of a game follows what is on the board rather than
+// its area.
+#define DEFAULT_BOARD_WIDTH 30
+#define DEFAULT_BOARD_HEIGHT 30
+#define MAX_BOARD_SIDE 10000
+
+#define CHUNK_BITS 5
+#define CHUNK_SIDE (1 << CHUNK_BITS)
+#define CHUNK_MASK (CHUNK_SIDE - 1)
+#define CHUNK_CELLS (CHUNK_SIDE * CHUNK_SIDE)
+
+#define MAX_SNAKE_MOVEMENT 0.15
+#define MIN_SNAKE_MOVEMENT 0.06
+#define STEP_SNAKE_MOVEMENT 0.03
+
+// pieces the body of a new snake has room for, a power of two
+#define INITIAL_SNAKE_CAPACITY 16
+
+// i-th piece of the snake, starting from the tail
+#define SNAKE_AT(snake, i) ((snake)->body[((snake)->tail + (i)) & ((snake)->capacity - 1)])
+
+// the simulation advances in fixed steps of 1 / TICKS_PER_SECOND
+// seconds, no matter how often frames are drawn
+#define TICKS_PER_SECOND 100
+#define SECONDS_TO_TICKS(s) ((int) ((s) * TICKS_PER_SECOND + 0.5))
+
+// food moves somewhere else every DELAY_FOOD_SPAWN seconds
+#define DELAY_FOOD_SPAWN 3
+#define FOOD_SPAWN_TICKS (DELAY_FOOD_SPAWN * TICKS_PER_SECOND)
+#define FOODS_COUNT 1
+
+#define OBSTACLES_COUNT 20
+
+// -------------------
+// STRUTTURE DATI
+
+typedef enum {
+  DIR_RIGHT = 0,
+  DIR_UP,
+  DIR_LEFT,
+  DIR_DOWN,
+} Dir;
+
+// what an agent can do on a move: keep going, or turn
+typedef enum {
+  ACTION_NONE = 0,
+  ACTION_RIGHT,
+  ACTION_UP,
+  ACTION_LEFT,
+  ACTION_DOWN,
+} Action;
+
+typedef enum {
+  STEP_NONE = 0,
+  STEP_ATE,
+  STEP_DIED,
+} StepEvent;
+
+typedef struct {
+  int x;
+  int y;
+} Pos;
+
+typedef enum {
+  CELL_EMPTY = 0,
+  CELL_SNAKE,
+  CELL_FOOD,
+  CELL_OBSTACLE,
+} CellKind;
+
+typedef struct {
+  Pos pos;
+  int score;
+} Food;
+
+typedef struct {
+  Pos pos;
+  int init;
+} Obstacle;
+
+// The body is a circular buffer going from the tail to the head, so
+// that moving only touches its two ends. It doubles when the snake
+// outgrows it, and its capacity is always a power of two. Use
+// SNAKE_AT() to walk it.
+typedef struct {
+  Pos *body;
+  int capacity;
+  int tail;    // index of the tail in body
+  int length;
+  int grow;    // moves left on which the tail stays where it is
+  Dir dir;
+  Pos last_tail;  // cell left by the tail on the last move
+} Snake;
+
+typedef struct {
+  uint8_t cells[CHUNK_CELLS];  // CellKind, row by row
+  int used;                    // cells that are not empty
+} Chunk;
+
+typedef struct {
+  int width;
+  int height;
+  int chunks_x;
+  int chunks_y;
+  // chunks_x * chunks_y chunks, row by row, NULL where all is empty
+  Chunk **chunks;
+  Chunk *spare;     // last chunk that got empty, kept for reuse
+  long occupied;    // cells that are not empty
+  // Fenwick tree of the empty cells of each chunk, 1-based, so that
+  // random_empty_board_pos() finds the chunk of any empty cell in
+  // O(log chunks) steps
+  int *free_tree;
+  int free_top;     // largest power of two not above the chunks
+} Board;
+
+typedef struct {
+  Snake snake;
+  Food food[FOODS_COUNT];
+  Obstacle obs[OBSTACLES_COUNT];
+  double game_speed;
+  int quit;
+  int global_score;
+  uint64_t rng;    // state of the game's random generator
+
+  // timers, in simulation ticks
+  int move_ticks;  // since the snake last moved
+  int food_ticks;  // since the food was last placed
+
+  // what is in each cell, kept up to date by board_set()
+  Board board;
+  // what the head found in its cell on the last move
+  CellKind head_hit;
+} Game;
+
+// -------------------
+// DICHIARAZIONI FUNZIONI
+
+// splitmix64, https://prng.di.unimi.it/splitmix64.c
+static inline uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// xorshift64, for the bots and agents of the headless tools: they keep
+// their own state, not to change the randomness of the game. The state
+// must not be 0.
+static inline uint64_t xorshift64(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *state = x;
+}
+
+static inline CellKind board_at(const Game *game, int x, int y) {
+  const Chunk *chunk = game->board.chunks[(y >> CHUNK_BITS) * game->board.chunks_x + (x >> CHUNK_BITS)];
+  return chunk ? (CellKind) chunk->cells[((y & CHUNK_MASK) << CHUNK_BITS) | (x & CHUNK_MASK)] : CELL_EMPTY;
+}
+
+uint64_t random_next(Game *game);
+int random_int_range(Game *game, int low, int high);
+Pos random_board_pos(Game *game);
+Dir random_dir(Game *game);
+int pos_is_not_empty(Game *game, Pos p);
+Pos random_empty_board_pos(Game *game);
+
+int init_board(Game *game, int width, int height);
+void clear_board(Game *game);
+void free_board(Game *game);
+CellKind board_get(const Game *game, Pos p);
+void board_set(Game *game, Pos p, CellKind kind);
+
+int new_game(Game *game, int width, int height, uint64_t seed);
+void init_game(Game *game, uint64_t seed);
+void free_game(Game *game);
+uint64_t game_checksum(const Game *game);
+
+Pos *get_snake_head(Snake *snake);
+int grow_body(Snake *snake);
+int allow_snake_movement(int manual, Game *game);
+Pos peak_next_pos(Game *game, Dir new_dir);
+int move_snake(Game *game, Dir new_dir, int manual);
+void eat_food(Game *game, Food *f);
+
+void init_food(Game *game);
+int allow_refresh_food(Game *game, int ticks);
+Food *check_for_food(Game *game);
+void update_food(Game *game, int ticks);
+
+int check_for_obstacles(Game *game);
+
+void update_game_speed(Game *game);
+
+StepEvent resolve_move(Game *game);
+void update_game_state(Game *game);
+StepEvent snake_step(Game *game, Action action);
+
+#endif // SNAKE_H_
@@ -0,0 +1,22 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include <time.h>
+
+// Helpers of the headless tools that time what they run. clock_gettime()
+// needs _POSIX_C_SOURCE to be defined before the first include.
+
+static inline double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// For qsort() of times, to take their percentiles.
+static inline int compare_floats(const void *a, const void *b) {
+  float x = *(const float *) a;
+  float y = *(const float *) b;
+  return (x > y) - (x < y);
+}
+
+#endif // TIMING_H_
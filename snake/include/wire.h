@@ -0,0 +1,96 @@
+#ifndef WIRE_H_
+#define WIRE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "./arena.h"
+
+// Messages between the snake server and its clients (see server.c).
+//
+// Every message is its length, as 4 bytes little endian, followed by
+// its type and its fields. Numbers are varints (LEB128), 7 bits per
+// byte, so small ones take a single byte.
+//
+//   WIRE_HELLO     width, height, snakes, id of the client's snake + 1
+//                  (0 if it only watches)
+//   WIRE_KEYFRAME  tick, hash (8 bytes), then the whole grid as runs
+//                  of cells with the same value: value, length
+//   WIRE_DELTA     tick, hash, count, then for each cell that changed
+//                  on the tick, in increasing order, the distance from
+//                  the previous one and its new value
+//
+// A client gets a hello and a keyframe when it connects, then a delta
+// every tick. The hash is the one of the whole grid after the message
+// (see arena_cell_hash()), so clients can check their copy. Clients
+// send single bytes, the Dir their snake should turn towards.
+
+#define WIRE_HELLO    'H'
+#define WIRE_KEYFRAME 'K'
+#define WIRE_DELTA    'D'
+
+#define WIRE_HEADER 4
+#define WIRE_MAX_MESSAGE (64 << 20)
+
+// -------------------
+// STRUTTURE DATI
+
+// Bytes being written, growing as needed. error is set if it could not
+// grow, after which writes are dropped.
+typedef struct {
+  uint8_t *data;
+  size_t len;
+  size_t cap;
+  int error;
+} Buffer;
+
+// Bytes being read. error is set on reads past the end.
+typedef struct {
+  const uint8_t *pos;
+  const uint8_t *end;
+  int error;
+} Reader;
+
+// The copy of the grid kept by a client.
+typedef struct {
+  int width;
+  int height;
+  int cells;
+  int snakes;
+  int snake;         // the client's snake, -1 if it only watches
+  uint32_t *grid;
+  uint32_t tick;
+  uint64_t hash;     // of grid, kept up to date as it changes
+  uint64_t expected; // hash sent with the last message
+} WireGrid;
+
+// -------------------
+// DICHIARAZIONI FUNZIONI
+
+void buffer_put_byte(Buffer *buf, uint8_t byte);
+void buffer_put_bytes(Buffer *buf, const void *data, size_t n);
+void buffer_put_varint(Buffer *buf, uint64_t value);
+void buffer_put_u64(Buffer *buf, uint64_t value);
+// Drops the first n bytes, once they were sent.
+void buffer_consume(Buffer *buf, size_t n);
+void buffer_free(Buffer *buf);
+
+uint8_t reader_byte(Reader *r);
+uint64_t reader_varint(Reader *r);
+uint64_t reader_u64(Reader *r);
+
+// Length of the message at the start of data, header included, or 0
+// if not all of it is there yet. Returns -1 on a malformed header.
+long wire_message_size(const uint8_t *data, size_t len);
+
+// Append a message to buf. wire_delta() sorts arena->changed.
+void wire_hello(Buffer *buf, const Arena *arena, int snake);
+void wire_keyframe(Buffer *buf, const Arena *arena);
+void wire_delta(Buffer *buf, Arena *arena);
+
+// Applies a whole message, header included, to the client's grid.
+// Returns its type, or -1 if it is malformed.
+int wire_apply(WireGrid *wg, const uint8_t *msg, size_t len);
+void wire_grid_free(WireGrid *wg);
+
+#endif // WIRE_H_
@@ -11,51 +11,58 @@
     sudo pacman -S sdl2_ttf (archlinux)
     sudo apt-get install libsdl2-ttf-dev (ubuntu)
 
+  Usage:
+
+    ./main [-r replay] [-a policy] [width height]
+    ./main -p replay
+
+  The board is 30x30 unless given, up to MAX_BOARD_SIDE cells per
+  side. On boards larger than VIEW_CELLS the screen shows
+  VIEW_CELLS x VIEW_CELLS cells around the head of the snake.
+
+  With -r the game is saved to the file `replay` when it ends, and -p
+  plays such a file back (see include/replay.h): space pauses, left
+  and right seek 5 seconds back and forward, home goes to the start.
+
+  With -a the autopilot is the policy in the checkpoint `policy`, as
+  saved by snake_train (see include/policy.h), instead of the one of
+  autopilot.c.
+
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
-#include <sys/time.h>
 #include <SDL2/SDL.h>
 #include <SDL_ttf.h>
 
+#include "./include/snake.h"
+#include "./include/autopilot.h"
+#include "./include/replay.h"
+#include "./include/policy.h"
+
 #define SCREEN_WIDTH  900
 #define SCREEN_HEIGHT 900
 
-#define BOARD_WIDTH 30
-#define BOARD_HEIGHT 30
-
-#define CELL_WIDTH ((SCREEN_WIDTH / BOARD_WIDTH))
-#define CELL_HEIGHT ((SCREEN_HEIGHT / BOARD_HEIGHT))
+// at most this many cells are shown per side, larger boards scroll
+#define VIEW_CELLS 30
 
-#define MAX_SNAKE_MOVEMENT 0.15
-#define MIN_SNAKE_MOVEMENT 0.06
-#define STEP_SNAKE_MOVEMENT 0.03
+// squares of one color drawn in a frame: every cell on screen, one
+// more per side while the camera is between cells, and head and tail
+#define MAX_RECTS ((VIEW_CELLS + 1) * (VIEW_CELLS + 1) + 2)
 
-#define MAX_SNAKE_LENGTH ((BOARD_WIDTH) * (BOARD_HEIGHT))
+// frames are drawn at most this often (vsync permitting), and after a
+// stall the simulation catches up on at most MAX_FRAME_TIME seconds
+#define FRAME_TIME (1.0 / 60)
+#define MAX_FRAME_TIME 0.25
 
-#define DELAY_FOOD_SPAWN 3
-#define FOODS_COUNT 1
-
-#define OBSTACLES_COUNT 20
+// ticks skipped by left and right, while playing back a replay
+#define PLAYBACK_SEEK_TICKS (5 * TICKS_PER_SECOND)
 
 #define FONT_PATH "./fonts/LiberationMono-Regular.ttf"
 
-// NOTE: to use these off has to be an int initialized to 0
-#define STAR_OBSTACLE(game, off, x, y)					\
-  (game)->obs[off++] = (Obstacle){(Pos) {x    , y}    , 1};		\
-  (game)->obs[off++] = (Obstacle){(Pos) {x + 1, y}    , 1};		\
-  (game)->obs[off++] = (Obstacle){(Pos) {x - 1, y}    , 1};		\
-  (game)->obs[off++] = (Obstacle){(Pos) {x    , y + 1}, 1};		\
-  (game)->obs[off++] = (Obstacle){(Pos) {x    , y - 1}, 1};
-
-#define HORIZONTAL_WALL_OBSACLE(game, off, x, y)		\
-  (game)->obs[off++] = (Obstacle){(Pos) {x    , y}    , 1};	\
-  (game)->obs[off++] = (Obstacle){(Pos) {x + 1, y}    , 1};	\
-  (game)->obs[off++] = (Obstacle){(Pos) {x + 1, y}    , 1};	\
-  (game)->obs[off++] = (Obstacle){(Pos) {x - 1, y}    , 1};	\
-  (game)->obs[off++] = (Obstacle){(Pos) {x -2 , y}    , 1};
-
+#define SCORE_LABEL "Score: "
 
 // RGBA, Red Green Blue Alpha
 #define BACKGROUND_COLOR 0x000000FF
@@ -77,43 +84,31 @@
 // -------------------
 // STRUTTURE DATI
 
-typedef enum {
-  DIR_RIGHT = 0,
-  DIR_UP,
-  DIR_LEFT,
-  DIR_DOWN,
-} Dir;
-
+// The part of the board on screen. x and y are the cell at the top
+// left corner, with a fraction as the camera moves along with the
+// head between cells.
 typedef struct {
-  int x;
-  int y;
-} Pos;
-
+  double x;
+  double y;
+  int cols;
+  int rows;
+  int cell_width;
+  int cell_height;
+} Camera;
+
+// Squares of the same color, drawn with a single call.
 typedef struct {
-  Pos pos;
-  int score;
-} Food;
+  SDL_Rect rects[MAX_RECTS];
+  int count;
+} RectList;
 
+// The score label and the ten digits, rendered once into a single
+// texture, with where each of them is in it.
 typedef struct {
-  Pos pos;
-  int init;
-} Obstacle;
-
-typedef struct {
-  Pos body[MAX_SNAKE_LENGTH];
-  int length;
-  Dir dir;
-} Snake;
-
-typedef struct {
-  Snake snake;
-  Food food[FOODS_COUNT];
-  Obstacle obs[OBSTACLES_COUNT];
-  double game_speed;
-  int quit;
-  int global_score;
-} Game;
-
+  SDL_Texture *texture;
+  SDL_Rect label;
+  SDL_Rect digits[10];
+} ScoreGlyphs;
 
 // -------------------
 // DICHIARAZIONI FUNZIONI
@@ -121,42 +116,43 @@ typedef struct {
 void scc(int code);
 void *scp(void *ptr);
 
-int random_int_range(int low, int high);
-Pos random_board_pos(void);
-int pos_is_not_empty(Game *game, Pos p);
-Pos random_empty_board_pos(Game *game);
-
-void init_game(Game *game);
-
-Pos *get_snake_head(Snake *snake);
-int allow_snake_movement(int manual, Game *game);
-Pos peak_next_pos(Snake *snake, Dir new_dir);
-void move_snake(Game *game, Dir new_dir, int manual);
-void eat_food(Game *game, Food *f);
+void update_camera(Camera *camera, Game *game, double t);
+double camera_offset(double pos, double camera, int side);
 
-void init_food(Game *game);
-int allow_refresh_food(void);
-Food *check_for_food(Game *game);
-void update_food(Game *game);
+void init_score_glyphs(SDL_Renderer *renderer, TTF_Font *font, ScoreGlyphs *glyphs);
+void free_score_glyphs(ScoreGlyphs *glyphs);
 
-int check_for_obstacles(Game *game);
+void render_game(SDL_Renderer *renderer, Game *game, ScoreGlyphs *glyphs, double alpha);
+void render_snake(Game *game, double t);
+void render_cells(Game *game);
+void render_game_score(SDL_Renderer *renderer, Game *game, ScoreGlyphs *glyphs);
+void render_board(SDL_Renderer *renderer, Game *game);
+void render_rects(SDL_Renderer *renderer, RectList *list, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void add_square_at(RectList *list, double x, double y);
+void add_square(RectList *list, Pos pos);
+void add_square_between(RectList *list, Pos from, Pos to, double t);
 
-void update_game_speed(Game *game);
-
-void update_game_state(Game *game);
-
-void render_game(SDL_Renderer *renderer, Game *game, TTF_Font *font);
-void render_snake(SDL_Renderer *renderer, Game *game);
-void render_food(SDL_Renderer *renderer, Game *game);
-void render_obstacles(SDL_Renderer *renderer, Game *game);
-void render_game_score(SDL_Renderer *renderer, Game *game, TTF_Font *font);
-void render_board(SDL_Renderer *renderer);
-void render_square(SDL_Renderer *renderer, Pos pos, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+int handle_playback_key(SDL_Keycode key);
 
 // -------------------
 // VARIABILI GLOBALI
 
 Game GAME = {0};
+Camera CAMERA = {0};
+ScoreGlyphs GLYPHS = {0};
+RectList SNAKE_RECTS = {0};
+RectList FOOD_RECTS = {0};
+RectList OBSTACLE_RECTS = {0};
+Autopilot PILOT = {0};  // built only while the autopilot is on
+int AUTOPILOT = 0;      // toggled with `a`
+Policy POLICY = {0};
+int POLICY_OK = 0;  // the autopilot is POLICY, loaded with -a
+// the game being played is recorded here, or played back from it with -p
+Replay REPLAY = {0};
+int PLAYBACK = 0;
+int PAUSED = 0;               // toggled with space, while playing back
+uint32_t PLAYBACK_TICK = 0;   // ticks played back so far
+uint32_t PLAYBACK_INPUT = 0;  // next input to play back
 
 // -------------------
 // UTILS
@@ -180,410 +176,423 @@ void *scp(void *ptr) {
   return ptr;
 }
 
-int random_int_range(int low, int high) {
-  return (rand() % (high - low)) + low;
-}
-
-Pos random_board_pos(void) {
-  Pos p = {0};
-  p.x = random_int_range(0, BOARD_WIDTH);
-  p.y = random_int_range(0, BOARD_HEIGHT);
-
-  return p;
+// -------------------
+// SCORE GLYPHS
+
+// width of the first n characters of str in the font
+static int text_width(TTF_Font *font, const char *str, int n) {
+  char buf[32];
+  int w = 0;
+  snprintf(buf, sizeof(buf), "%.*s", n, str);
+  if (n > 0 && TTF_SizeText(font, buf, &w, NULL) < 0) {
+    printf("Error: %s\n", TTF_GetError());
+    exit(1);
+  }
+  return w;
 }
 
-Dir random_dir(void) {
-  return (Dir) random_int_range(0, 4);
-  
-}
+/*
+  Renders the score label followed by the digits into one texture, so
+  that drawing the score never goes through SDL_ttf again.
+*/
+void init_score_glyphs(SDL_Renderer *renderer, TTF_Font *font, ScoreGlyphs *glyphs) {
+  const char *text = SCORE_LABEL "0123456789";
+  int label_len = (int) strlen(SCORE_LABEL);
 
-int pos_is_not_empty(Game *game, Pos p) {
-  // Food is here?
-  for (int i = 0; i < FOODS_COUNT; i++) {
-    if (p.x == game->food[i].pos.x && p.y == game->food[i].pos.y)
-      return 1;
+  SDL_Surface *surface = TTF_RenderText_Solid(font, text, (SDL_Color){HEX_COLOR(SCORE_COLOR)});
+  if(!surface) {
+    printf("Error: %s\n", TTF_GetError());
+    exit(1);
   }
 
-  for (int i = 0; i < game->snake.length; i++) {
-    if (p.x == game->snake.body[i].x &&
-	p.y == game->snake.body[i].y)
-      return 1;
-  }  
-
-  for (int i = 0; i < OBSTACLES_COUNT; i++) {
-    if (p.x == game->obs[i].pos.x && p.y == game->obs[i].pos.y)
-      return 1;
-  }  
+  glyphs->texture = scp(SDL_CreateTextureFromSurface(renderer, surface));
+  int h = surface->h;
+  SDL_FreeSurface(surface);
 
-  return 0;
+  glyphs->label = (SDL_Rect) {0, 0, text_width(font, text, label_len), h};
+  for (int i = 0; i < 10; i++) {
+    int x = text_width(font, text, label_len + i);
+    glyphs->digits[i] = (SDL_Rect) {x, 0, text_width(font, text, label_len + i + 1) - x, h};
+  }
 }
 
-Pos random_empty_board_pos(Game *game) {
-  Pos p = {0};
-  do {
-    p = random_board_pos();
-  } while (pos_is_not_empty(game, p));
-
-  return p;
+void free_score_glyphs(ScoreGlyphs *glyphs) {
+  SDL_DestroyTexture(glyphs->texture);
+  glyphs->texture = NULL;
 }
 
 // -------------------
-// GAME LOGIC FUNCTIONS
+// CAMERA
 
-void init_game(Game *game) {
-  // -- init snake
-  game->snake.body[0] = random_board_pos();
-  game->snake.length = 1;
-  game->snake.dir = random_dir();
-  
-  init_food(game);
+/*
+  Centers the camera on the head of the snake, a fraction t of the way
+  from the neck. Boards that fit on screen are shown whole and do not
+  scroll.
+*/
+void update_camera(Camera *camera, Game *game, double t) {
+  int width = game->board.width;
+  int height = game->board.height;
+
+  camera->cols = width < VIEW_CELLS ? width : VIEW_CELLS;
+  camera->rows = height < VIEW_CELLS ? height : VIEW_CELLS;
+  camera->cell_width = SCREEN_WIDTH / camera->cols;
+  camera->cell_height = SCREEN_HEIGHT / camera->rows;
 
-  // init obstacles
-  int off = 0;  
-  STAR_OBSTACLE(game, off, 10, 10);
-  HORIZONTAL_WALL_OBSACLE(game, off, 20, 20)
+  Snake *snake = &game->snake;
+  Pos head = *get_snake_head(snake);
+  Pos neck = snake->length >= 2 ? SNAKE_AT(snake, snake->length - 2) : snake->last_tail;
+  double x = head.x;
+  double y = head.y;
+  if (abs(head.x - neck.x) + abs(head.y - neck.y) == 1) {
+    x = neck.x + (head.x - neck.x) * t;
+    y = neck.y + (head.y - neck.y) * t;
+  }
 
-  game->quit = 0;
-  game->global_score = 0;
-  game->game_speed = MAX_SNAKE_MOVEMENT;
+  camera->x = 0;
+  camera->y = 0;
+  if (width > camera->cols) {
+    camera->x = x + 0.5 - camera->cols / 2.0;
+    camera->x -= width * floor(camera->x / width);
+  }
+  if (height > camera->rows) {
+    camera->y = y + 0.5 - camera->rows / 2.0;
+    camera->y -= height * floor(camera->y / height);
+  }
 }
 
-Pos *get_snake_head(Snake *snake) {
-  return &snake->body[snake->length - 1];
+/*
+  How many cells from the camera `pos` is on screen, along a side of
+  the board `side` cells long. The board wraps around, so a cell just
+  left of the camera is at -1 rather than at side - 1.
+*/
+double camera_offset(double pos, double camera, int side) {
+  double offset = pos - camera;
+  offset -= side * floor(offset / side);
+  if (offset > side - 1) {
+    offset -= side;
+  }
+  return offset;
 }
 
-int allow_snake_movement(int manual, Game *game) {
-  static struct timeval old_t = {0};
-  static struct timeval new_t = {0};
-  static int init = -1;
-  double time_elapsed = -1;
+// -------------------
+// RENDER FUNCTIONS
 
-  if (init == -1) {
-    // -- first call to function
-    init = 1;
-    gettimeofday(&old_t, NULL);
+/*
+  alpha is how far we are into the current tick, from 0 to 1, and is
+  used to draw the snake between cells while it moves.
 
-    return manual ? 1 : 0;
-  }
-    
-  gettimeofday(&new_t, NULL);
-  time_elapsed = (double) (new_t.tv_usec - old_t.tv_usec) / 1000000 +
-    (double) (new_t.tv_sec - old_t.tv_sec);
-  
-  if (!manual && time_elapsed < game->game_speed) {
-    // not enough time has passed for automatic movement
-    return 0;
-  } else {
-    old_t = new_t;
-    return 1;
+  The squares on screen are first collected by color, then each color
+  is drawn with a single call, so a frame takes the same few calls
+  however long the snake is.
+*/
+void render_game(SDL_Renderer *renderer, Game *game, ScoreGlyphs *glyphs, double alpha) {
+  double t = (game->move_ticks + alpha) / SECONDS_TO_TICKS(game->game_speed);
+  if (t > 1) {
+    t = 1;
   }
-}
 
-Pos peak_next_pos(Snake *snake, Dir new_dir) {
-  Pos new_pos;
-  Pos *head_pos = get_snake_head(snake);
-
-  switch(new_dir) {
-  case DIR_RIGHT:
-    new_pos.x = (head_pos->x + 1) % BOARD_WIDTH;
-    new_pos.y = head_pos->y;
-    break;
-    
-  case DIR_LEFT:
-    new_pos.x = head_pos->x == 0 ? BOARD_WIDTH - 1 : head_pos->x - 1;
-    new_pos.y = head_pos->y;
-    break;
-
-  case DIR_UP:
-    new_pos.x = head_pos->x;    
-    new_pos.y = head_pos->y == 0 ? BOARD_HEIGHT - 1 : head_pos->y - 1;
-    break;
-
-  case DIR_DOWN:
-    new_pos.x = head_pos->x;    
-    new_pos.y = (head_pos->y + 1) % BOARD_HEIGHT;
-    break;
-  }
+  update_camera(&CAMERA, game, t);
 
-  return new_pos;
+  scc(SDL_SetRenderDrawColor(renderer, HEX_COLOR(BACKGROUND_COLOR)));
+  SDL_RenderClear(renderer);
   
-}
+  // render_board(renderer, game);
+  render_cells(game);
+  render_snake(game, t);
+  render_rects(renderer, &OBSTACLE_RECTS, HEX_COLOR(OBSTACLE_COLOR));
+  render_rects(renderer, &FOOD_RECTS, HEX_COLOR(FOOD_COLOR));
+  render_rects(renderer, &SNAKE_RECTS, HEX_COLOR(SNAKE_COLOR));
+  render_game_score(renderer, game, glyphs);
 
-void move_snake(Game *game, Dir new_dir, int manual) {
-  if(!allow_snake_movement(manual, game)) {
-    return;
-  }
-
-  Snake *snake = &game->snake;
-  Pos new_pos = peak_next_pos(snake, new_dir);
+  SDL_RenderPresent(renderer);
+}
 
-  // cant move back to snake's own tail
-  if (snake->length >= 2 &&
-      new_pos.x == snake->body[snake->length - 2].x &&
-      new_pos.y == snake->body[snake->length - 2].y)
-    return;
+void render_board(SDL_Renderer *renderer, Game *game) {
+  scc(SDL_SetRenderDrawColor(renderer, HEX_COLOR(GRID_COLOR)));
 
-  // perform movement
-  Pos *head_pos = get_snake_head(snake);
-  Pos old_pos = *head_pos;
-  Pos tmp_pos = old_pos;
+  // lines follow the camera, one per cell on screen
+  double dx = camera_offset(0, CAMERA.x, game->board.width);
+  double dy = camera_offset(0, CAMERA.y, game->board.height);
+  dx -= floor(dx);
+  dy -= floor(dy);
 
-  *head_pos = new_pos;
-  snake->dir = new_dir;
+  for(int x = 0; x <= CAMERA.cols; x++) {
+    int sx = (int) floor((x + dx) * CAMERA.cell_width);
+    SDL_RenderDrawLine(renderer,
+		       sx, 0,             // starting (x_1, y_1)
+		       sx, SCREEN_HEIGHT  // ending   (x_2, y_2)
+		       );
+  }
 
-  for (int i = snake->length -2 ; i >= 0; i--) {
-    tmp_pos = snake->body[i];
-    snake->body[i] = old_pos;
-    old_pos = tmp_pos;
+  for(int y = 0; y <= CAMERA.rows; y++) {
+    int sy = (int) floor((y + dy) * CAMERA.cell_height);
+    SDL_RenderDrawLine(renderer,
+		       0, sy,	      // starting (x_1, y_1)
+		       SCREEN_WIDTH, sy  // ending   (x_2, y_2)
+		       );
   }
 }
 
-void eat_food(Game *game, Food *f) {
+/*
+  Between two moves the head slides from the neck into its cell, and
+  the tail slides from the cell it left into its own, so the snake
+  moves smoothly even though it only changes cell on ticks. The rest
+  of the body is drawn by render_cells.
+*/
+void render_snake(Game *game, double t) {
   Snake *snake = &game->snake;
 
-  // eat food
-  game->global_score += f->score;
-  f->score = 0;
-
-  // grow snake's body
-  Pos new_pos = peak_next_pos(snake, snake->dir);
-  snake->length += 1;
-  snake->body[snake->length - 1] = new_pos;
-
-  return;
-}
+  Pos head = *get_snake_head(snake);
+  Pos neck = snake->length >= 2 ? SNAKE_AT(snake, snake->length - 2) : snake->last_tail;
+  add_square_between(&SNAKE_RECTS, neck, head, t);
 
-void init_food(Game *game) {
-  for (int i = 0; i < FOODS_COUNT; i++) {
-    game->food[i].score = 1;
-    game->food[i].pos = random_empty_board_pos(game);
+  if (snake->length >= 2) {
+    add_square_between(&SNAKE_RECTS, snake->last_tail, SNAKE_AT(snake, 0), t);
   }
-
-  return;
 }
 
-int allow_refresh_food(void) {
-  // TODO: check if (OS) windows has it
-  static struct timeval old_t = {0};
-  static struct timeval new_t = {0};
-  static int init = -1;
-  Uint32 time_elapsed = -1;
-
-  if (init == -1) {
-    init = 1;
-    gettimeofday(&old_t, NULL);
-    return 1;
-  }
+/*
+  Collects the food, the obstacles and the body of the snake in the
+  cells on screen, reading them from the board. Chunks that were never
+  written to are empty and are skipped a row of the chunk at a time.
+*/
+void render_cells(Game *game) {
+  const Board *board = &game->board;
+  Pos head = *get_snake_head(&game->snake);
+  Pos tail = SNAKE_AT(&game->snake, 0);
+
+  // one more cell per side when the camera is between cells
+  int x0 = (int) floor(CAMERA.x);
+  int y0 = (int) floor(CAMERA.y);
+  int cols = CAMERA.cols + (board->width > CAMERA.cols);
+  int rows = CAMERA.rows + (board->height > CAMERA.rows);
+
+  for (int j = 0; j < rows; j++) {
+    int y = (y0 + j) % board->height;
+
+    for (int i = 0; i < cols; ) {
+      int x = (x0 + i) % board->width;
+      const Chunk *chunk = board->chunks[(y >> CHUNK_BITS) * board->chunks_x + (x >> CHUNK_BITS)];
+
+      // cells left in this row of the chunk
+      int run = CHUNK_SIDE - (x & CHUNK_MASK);
+      if (run > board->width - x) {
+	run = board->width - x;
+      }
+      if (run > cols - i) {
+	run = cols - i;
+      }
 
-  gettimeofday(&new_t, NULL);
-  time_elapsed = (double) (new_t.tv_usec - old_t.tv_usec) / 1000000 + (double) (new_t.tv_sec - old_t.tv_sec);
+      for (int k = 0; chunk && k < run; k++) {
+	Pos pos = { x + k, y };
+	CellKind kind = (CellKind) chunk->cells[((y & CHUNK_MASK) << CHUNK_BITS) | ((x + k) & CHUNK_MASK)];
 
-  if (time_elapsed < DELAY_FOOD_SPAWN) {
-    return 0;
-  } else {
-    old_t = new_t;
-    return 1;
-  }
-}
+	switch (kind) {
+	case CELL_FOOD:
+	  add_square(&FOOD_RECTS, pos);
+	  break;
 
-Food *check_for_food(Game *game) {
-  Snake *snake = &game->snake;
-  Pos head_pos = *get_snake_head(snake);
+	case CELL_OBSTACLE:
+	  add_square(&OBSTACLE_RECTS, pos);
+	  break;
+
+	case CELL_SNAKE:
+	  // head and tail are drawn between cells by render_snake
+	  if ((pos.x != head.x || pos.y != head.y) && (pos.x != tail.x || pos.y != tail.y)) {
+	    add_square(&SNAKE_RECTS, pos);
+	  }
+	  break;
 
-  for (int i = 0; i < FOODS_COUNT; i++) {
-    Food *f = &game->food[i];
+	default:
+	  break;
+	}
+      }
 
-    if(f->pos.x == head_pos.x && f->pos.y == head_pos.y && f->score > 0) {
-      return f;
+      i += run;
     }
   }
-
-  return NULL;
 }
 
-void update_food(Game *game) {
-  if (allow_refresh_food()) {
-    init_food(game);
+/*
+  Draws the score a glyph at a time from the atlas, on every frame.
+*/
+void render_game_score(SDL_Renderer *renderer, Game *game, ScoreGlyphs *glyphs) {
+  SDL_Rect dst = glyphs->label;
+  scc(SDL_RenderCopy(renderer, glyphs->texture, &glyphs->label, &dst));
+  dst.x += glyphs->label.w;
+
+  char str[16];
+  snprintf(str, sizeof(str), "%d", game->global_score);
+
+  for (char *c = str; *c; c++) {
+    if (*c < '0' || *c > '9') {
+      continue;
+    }
+    SDL_Rect *glyph = &glyphs->digits[*c - '0'];
+    dst.w = glyph->w;
+    dst.h = glyph->h;
+    scc(SDL_RenderCopy(renderer, glyphs->texture, glyph, &dst));
+    dst.x += glyph->w;
   }
-  return;
 }
 
-void update_game_speed(Game *game) {
-  double step_update = game->global_score * STEP_SNAKE_MOVEMENT;
-  
-  if (MAX_SNAKE_MOVEMENT - step_update < MIN_SNAKE_MOVEMENT) {
-    game->game_speed = MIN_SNAKE_MOVEMENT;
-  } else {
-    game->game_speed = MAX_SNAKE_MOVEMENT - step_update;
+/*
+  Draws all the squares of a list with the specified color, and
+  empties it.
+*/
+void render_rects(SDL_Renderer *renderer, RectList *list, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+  if (list->count > 0) {
+    scc(SDL_SetRenderDrawColor(renderer, r, g, b, a));
+    scc(SDL_RenderFillRects(renderer, list->rects, list->count));
   }
-
-  return;
+  list->count = 0;
 }
 
-int check_for_obstacles(Game *game) {
-  Snake *s = &game->snake;
-  Pos head_pos = *get_snake_head(s);
+/*
+  Adds the square of the grid at position (x, y) to a list, unless it
+  is off screen. x and y can fall between cells.
+*/
+void add_square_at(RectList *list, double x, double y) {
+  SDL_Rect rect = {
+    (int) floor(camera_offset(x, CAMERA.x, GAME.board.width) * CAMERA.cell_width),
+    (int) floor(camera_offset(y, CAMERA.y, GAME.board.height) * CAMERA.cell_height),
+    CAMERA.cell_width,
+    CAMERA.cell_height,
+  };
 
-  // did we go into our own tail?
-  for (int i = 0; i < s->length - 2; i++) {
-    if (s->body[i].x == head_pos.x &&
-	s->body[i].y == head_pos.y)
-      return 1;
+  if (rect.x >= SCREEN_WIDTH || rect.y >= SCREEN_HEIGHT || list->count == MAX_RECTS) {
+    return;
   }
 
-  // or against an initialized obstacle?
-  for (int i = 0; i < OBSTACLES_COUNT; i++) {
-    Obstacle ob = game->obs[i];
-    if (ob.init &&
-	ob.pos.x == head_pos.x &&
-	ob.pos.y == head_pos.y)
-      return 1;
-  }
+  list->rects[list->count++] = rect;
+}
 
-  return 0;
+void add_square(RectList *list, Pos pos) {
+  add_square_at(list, pos.x, pos.y);
 }
 
-void update_game_state(Game *game) {
-  move_snake(&GAME, GAME.snake.dir, 0);
-  GAME.quit |= check_for_obstacles(&GAME);    
-  Food *f = check_for_food(&GAME);
-  if (f) {
-    eat_food(&GAME, f);
-    update_game_speed(&GAME);
+/*
+  Adds a square a fraction t of the way from cell `from` to cell `to`.
+  Cells that are not next to each other (as when wrapping around the
+  board) are not interpolated.
+*/
+void add_square_between(RectList *list, Pos from, Pos to, double t) {
+  if (abs(to.x - from.x) + abs(to.y - from.y) != 1) {
+    add_square(list, to);
+    return;
   }
-  update_food(&GAME);  
+
+  add_square_at(list, from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t);
 }
 
 // -------------------
-// RENDER FUNCTIONS
-
-void render_game(SDL_Renderer *renderer, Game *game, TTF_Font *font) {
-  scc(SDL_SetRenderDrawColor(renderer, HEX_COLOR(BACKGROUND_COLOR)));
-  SDL_RenderClear(renderer);
-  
-  // render_board(renderer);
-  render_snake(renderer, game);
-  render_food(renderer, game);
-  render_obstacles(renderer, game);
-  render_game_score(renderer, game, font);
+// PLAYBACK
 
-  SDL_RenderPresent(renderer);
-}
+/*
+  Space pauses, left and right go back and forward by
+  PLAYBACK_SEEK_TICKS ticks, home goes back to the start.
 
-void render_board(SDL_Renderer *renderer) {
-  scc(SDL_SetRenderDrawColor(renderer, HEX_COLOR(GRID_COLOR)));
-  
-  for(int x = 0; x < BOARD_WIDTH; x++) {
-    SDL_RenderDrawLine(renderer,
-		       x * CELL_WIDTH, 0,             // starting (x_1, y_1)
-		       x * CELL_WIDTH, SCREEN_HEIGHT  // ending   (x_2, y_2)
-		       );
+  A seek that fails leaves the game half restored, so it goes back to
+  the tick it was at. Returns 0 if that fails too, and the playback
+  has to end.
+*/
+int handle_playback_key(SDL_Keycode key) {
+  long tick = PLAYBACK_TICK;
+
+  switch (key) {
+  case SDLK_SPACE: PAUSED = !PAUSED; return 1;
+  case SDLK_LEFT:  tick -= PLAYBACK_SEEK_TICKS; break;
+  case SDLK_RIGHT: tick += PLAYBACK_SEEK_TICKS; break;
+  case SDLK_HOME:  tick = 0; break;
+  default: return 1;
   }
 
-  for(int y = 0; y < BOARD_HEIGHT; y++) {
-    SDL_RenderDrawLine(renderer,
-		       0, y * CELL_HEIGHT,	      // starting (x_1, y_1)
-		       SCREEN_WIDTH, y * CELL_HEIGHT  // ending   (x_2, y_2)
-		       );
+  if (tick < 0) {
+    tick = 0;
   }
-}
-
-void render_snake(SDL_Renderer *renderer, Game *game) {
-  for (int i = game->snake.length - 1; i >= 0; i--) {
-    render_square(renderer, game->snake.body[i], HEX_COLOR(SNAKE_COLOR));
+  if (tick > (long) REPLAY.ticks) {
+    tick = REPLAY.ticks;
   }
-}
 
-void render_food(SDL_Renderer *renderer, Game *game) {
-  for (int i = 0; i < FOODS_COUNT; i++) {
-    if (game->food[i].score == 0) {
-      continue; // Skip foods that have already been eaten
-    }
-    render_square(renderer, game->food[i].pos, HEX_COLOR(FOOD_COLOR));
+  long input = replay_seek(&REPLAY, &GAME, (uint32_t) tick);
+  if (input < 0) {
+    printf("Error: the replay is broken at tick %ld\n", tick);
+    return replay_seek(&REPLAY, &GAME, PLAYBACK_TICK) == (long) PLAYBACK_INPUT;
   }
+  PLAYBACK_TICK = (uint32_t) tick;
+  PLAYBACK_INPUT = (uint32_t) input;
+  return 1;
 }
 
-void render_obstacles(SDL_Renderer *renderer, Game *game) {
-  scc(SDL_SetRenderDrawColor(renderer, HEX_COLOR(OBSTACLE_COLOR)));
-
-  for (int i = 0; i < OBSTACLES_COUNT; i++) {
-    Obstacle ob = game->obs[i];
-
-    if (!ob.init)
-      // do not render Uninitialized obstacles 
-      continue;
+// -------------------
 
-    render_square(renderer, ob.pos, HEX_COLOR(OBSTACLE_COLOR));
-  }    
-}
 
-void render_game_score(SDL_Renderer *renderer, Game *game, TTF_Font *font) {
-  static SDL_Surface *surface;
-  static SDL_Texture *texture;
-  static int init = -1;
-  static int prev_score = -1;
+int main(int argc, char **argv) {
+  int width = DEFAULT_BOARD_WIDTH;
+  int height = DEFAULT_BOARD_HEIGHT;
+  const char *record_path = NULL;
+  const char *playback_path = NULL;
+  const char *policy_path = NULL;
+
+  int arg = 1;
+  while (arg + 1 < argc) {
+    if (strcmp(argv[arg], "-r") == 0) {
+      record_path = argv[arg + 1];
+    } else if (strcmp(argv[arg], "-p") == 0) {
+      playback_path = argv[arg + 1];
+    } else if (strcmp(argv[arg], "-a") == 0) {
+      policy_path = argv[arg + 1];
+    } else {
+      break;
+    }
+    arg += 2;
+  }
 
-  if(prev_score == game->global_score) {
-    // -- nothing to update
-    return;
+  if (argc - arg == 2 && !playback_path) {
+    width = atoi(argv[arg]);
+    height = atoi(argv[arg + 1]);
+  } else if (argc != arg || (record_path && playback_path)) {
+    printf("Usage: %s [-r replay] [-a policy] [width height]\n", argv[0]);
+    printf("       %s -p replay\n", argv[0]);
+    exit(1);
   }
 
-  if (init != -1) {
-    // -- clean previous allocations
-    SDL_DestroyTexture(texture);
-    SDL_FreeSurface(surface);
+  if (policy_path) {
+    if (!policy_load(&POLICY, policy_path)) {
+      printf("Error: cannot load a policy from `%s`\n", policy_path);
+      exit(1);
+    }
+    POLICY_OK = 1;
   }
 
-  // -- create new string
-  char str[32];
-  sprintf(str, "Score: %d", game->global_score);
+  uint64_t seed = time(NULL);
+  if (playback_path) {
+    if (!replay_load(&REPLAY, playback_path)) {
+      printf("Error: cannot load a replay from `%s`\n", playback_path);
+      exit(1);
+    }
+    PLAYBACK = 1;
+    width = REPLAY.width;
+    height = REPLAY.height;
+    seed = REPLAY.seed;
+  }
 
-  // -- allocate it and display it
-  surface = TTF_RenderText_Solid(font, str, (SDL_Color){HEX_COLOR(SCORE_COLOR)});
-  
-  if(!surface) {
-    printf("Error: %s\n", TTF_GetError());
+  if (!new_game(&GAME, width, height, seed)) {
+    printf("Error: cannot create a %dx%d board (at most %dx%d)\n",
+	   width, height, MAX_BOARD_SIDE, MAX_BOARD_SIDE);
+    exit(1);
+  }
+  // the game is only recorded when it is going to be saved
+  Replay *recording = record_path ? &REPLAY : NULL;
+  if (recording && !replay_begin(recording, &GAME, seed)) {
+    printf("Error: out of memory\n");
     exit(1);
   }
-  
-  texture = scp(SDL_CreateTextureFromSurface(renderer, surface));
-
-  int textW = 0;
-  int textH = 0;
-  SDL_QueryTexture(texture, NULL, NULL, &textW, &textH);
-  SDL_Rect text_rect = {0, 0, textW, textH};
-
-  SDL_RenderCopy(renderer, texture, NULL, &text_rect);
-  
-}
-
-/*
-  Draws a square in the grid at position (pos.x, pos.y)
-  with the specified color.
-*/
-void render_square(SDL_Renderer *renderer, Pos pos, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
-  scc(SDL_SetRenderDrawColor(renderer, r, g, b, a));
-  
-  SDL_Rect rect = {
-    (int) floorf(pos.x * CELL_WIDTH),
-    (int) floorf(pos.y * CELL_HEIGHT),
-    (int) floorf(CELL_WIDTH),
-    (int) floorf(CELL_HEIGHT),
-  };
-
-  scc(SDL_RenderFillRect(renderer, &rect));
-}
-
-// -------------------
-
-
-int main(void) {
-  srand(time(0));
 
   // init classic SDL
   SDL_Init(SDL_INIT_VIDEO);
   SDL_Window *const window = scp(SDL_CreateWindow("Description", 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_RESIZABLE));  
-  SDL_Renderer *const renderer = scp(SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED));
+  SDL_Renderer *const renderer = scp(SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
 
   // init font
   TTF_Init();
@@ -591,50 +600,119 @@ int main(void) {
   if(!font) {
     printf("Error loading font `%s`: %s\n", FONT_PATH, TTF_GetError());
     exit(1);
-  }  
+  }
+  init_score_glyphs(renderer, font, &GLYPHS);
 
-  init_game(&GAME);
+
+  const double frequency = SDL_GetPerformanceFrequency();
+  Uint64 last_time = SDL_GetPerformanceCounter();
+  double lag = 0;  // time the simulation is behind, in seconds
+  int running = 1;
   
-  while(!GAME.quit) {
+  while(running) {
     SDL_Event event;
 
     // event handling
     while(SDL_PollEvent(&event)) {
       if (event.type == SDL_QUIT) {
-	GAME.quit = 1;
+	running = 0;
       }
 
-      if (event.type == SDL_KEYDOWN) {
+      if (event.type == SDL_KEYDOWN && PLAYBACK) {
+	if (!handle_playback_key(event.key.keysym.sym)) {
+	  running = 0;
+	}
+      } else if (event.type == SDL_KEYDOWN && !GAME.quit) {
 	switch (event.key.keysym.sym) {
 	case SDLK_UP: {
-	  move_snake(&GAME, DIR_UP, 1);
+	  replay_play(recording, &GAME, INPUT_MOVE, DIR_UP);
 	  break;
 	}
 
 	case SDLK_DOWN: {
-	  move_snake(&GAME, DIR_DOWN, 1);
+	  replay_play(recording, &GAME, INPUT_MOVE, DIR_DOWN);
 	  break;
 	}
 
 	case SDLK_LEFT: {
-	  move_snake(&GAME, DIR_LEFT, 1);
+	  replay_play(recording, &GAME, INPUT_MOVE, DIR_LEFT);
 	  break;
 	}
 
 	case SDLK_RIGHT: {
-	  move_snake(&GAME, DIR_RIGHT, 1);
+	  replay_play(recording, &GAME, INPUT_MOVE, DIR_RIGHT);
 	  break;
 	}	  
+
+	case SDLK_a: {
+	  if (AUTOPILOT) {
+	    AUTOPILOT = 0;
+	    autopilot_free(&PILOT);
+	    break;
+	  }
+	  // the autopilot does not fit on very large boards
+	  if (!POLICY_OK && !autopilot_init(&PILOT, &GAME)) {
+	    printf("The autopilot only plays on boards up to %d cells\n", AUTOPILOT_MAX_CELLS);
+	    break;
+	  }
+	  AUTOPILOT = 1;
+	  break;
+	}
+	}
+      }
+    }
+
+    // main logic loop, as many ticks as needed to catch up with the
+    // time elapsed since the last frame
+    Uint64 now = SDL_GetPerformanceCounter();
+    lag += (now - last_time) / frequency;
+    last_time = now;
+
+    if (lag > MAX_FRAME_TIME) {
+      lag = MAX_FRAME_TIME;
+    }
+
+    while (lag >= 1.0 / TICKS_PER_SECOND && running) {
+      if (PLAYBACK) {
+	// stays on the last tick once there, until a seek back
+	if (!PAUSED && PLAYBACK_TICK < REPLAY.ticks) {
+	  replay_step(&REPLAY, &GAME, PLAYBACK_TICK++, &PLAYBACK_INPUT);
 	}
+      } else {
+	// the autopilot turns right before the snake moves on its own
+	if (AUTOPILOT && GAME.move_ticks + 1 >= SECONDS_TO_TICKS(GAME.game_speed)) {
+	  Action action = POLICY_OK ? policy_decide(&POLICY, &GAME) : autopilot_decide(&PILOT, &GAME);
+	  if (action != ACTION_NONE) {
+	    replay_play(recording, &GAME, INPUT_TURN, (Dir) (action - ACTION_RIGHT));
+	  }
+	}
+	replay_tick(recording, &GAME);
+	running = !GAME.quit;
       }
+      lag -= 1.0 / TICKS_PER_SECOND;
+    }
+
+    // rendering stuff, which waits for vsync when available
+    render_game(renderer, &GAME, &GLYPHS, PLAYBACK && (PAUSED || PLAYBACK_TICK == REPLAY.ticks) ? 0 : lag * TICKS_PER_SECOND);
+
+    // without vsync, sleep until the next frame is due
+    double frame = (SDL_GetPerformanceCounter() - now) / frequency;
+    if (frame < FRAME_TIME) {
+      SDL_Delay((Uint32) ((FRAME_TIME - frame) * 1000));
     }
+  }
 
-    // main logic loop
-    update_game_state(&GAME);
-    // rendering stuff
-    render_game(renderer, &GAME, font);
+  if (record_path) {
+    replay_end(&REPLAY, &GAME);
+    if (REPLAY.error || !replay_save(&REPLAY, record_path)) {
+      printf("Error: cannot save the replay to `%s`\n", record_path);
+    }
   }
 
+  replay_free(&REPLAY);
+  autopilot_free(&PILOT);
+  free_game(&GAME);
+  free_score_glyphs(&GLYPHS);
   TTF_CloseFont(font);
   TTF_Quit();
   SDL_Quit();
@@ -0,0 +1,140 @@
+/*
+  Decision time of the autopilot (see include/autopilot.h).
+
+  Usage:
+
+    ./snake_pilot [-n games] [-s seed] [-m moves] [-b WIDTHxHEIGHT] [-f]
+
+  Plays games with the autopilot, headless, until the snake dies, is
+  as long as the autopilot's cycle or reaches `moves` moves, and
+  reports how long each decision took against the time between two
+  moves of the snake at full speed (MIN_SNAKE_MOVEMENT). The board is
+  30x30 unless -b says otherwise.
+
+  With -f food stays where it is until it is eaten, instead of moving
+  every DELAY_FOOD_SPAWN seconds, so that on large boards the snake
+  gets to eat and grow (new food still shows up only after that
+  time).
+
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./include/snake.h"
+#include "./include/autopilot.h"
+#include "./include/timing.h"
+
+#define DEFAULT_GAMES 10
+#define DEFAULT_MOVES 100000
+
+// -------------------
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-n games] [-s seed] [-m moves] [-b WIDTHxHEIGHT] [-f]\n", program);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  size_t games = DEFAULT_GAMES;
+  uint64_t seed = 1;
+  size_t max_moves = DEFAULT_MOVES;
+  int width = DEFAULT_BOARD_WIDTH;
+  int height = DEFAULT_BOARD_HEIGHT;
+  int keep_food = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:s:m:b:f")) != -1) {
+    switch (opt) {
+    case 'n': games = strtoull(optarg, NULL, 10); break;
+    case 's': seed = strtoull(optarg, NULL, 10); break;
+    case 'm': max_moves = strtoull(optarg, NULL, 10); break;
+    case 'f': keep_food = 1; break;
+    case 'b':
+      if (sscanf(optarg, "%dx%d", &width, &height) != 2) {
+	usage(argv[0]);
+      }
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (games == 0 || max_moves == 0) {
+    usage(argv[0]);
+  }
+
+  Game game;
+  float *times = malloc(games * max_moves * sizeof(float));
+  Autopilot pilot;
+
+  if (!new_game(&game, width, height, seed)) {
+    fprintf(stderr, "cannot create a %dx%d board (at most %dx%d)\n",
+	    width, height, MAX_BOARD_SIDE, MAX_BOARD_SIDE);
+    return 1;
+  }
+  if (!times || !autopilot_init(&pilot, &game)) {
+    fprintf(stderr, "out of memory, or board larger than %d cells\n", AUTOPILOT_MAX_CELLS);
+    return 1;
+  }
+
+  size_t moves = 0;
+  size_t died = 0;
+  size_t full = 0;
+  long length = 0;
+  int best = 0;
+  double total = 0;
+
+  for (size_t g = 0; g < games; g++) {
+    init_game(&game, seed + g);
+
+    for (size_t m = 0; m < max_moves; m++) {
+      double start = now_seconds();
+      Action action = autopilot_decide(&pilot, &game);
+      double elapsed = now_seconds() - start;
+
+      times[moves++] = (float) (elapsed * 1000);
+      total += elapsed;
+
+      if (keep_food && game.food[0].score > 0) {
+	game.food_ticks = 0;
+      }
+      if (snake_step(&game, action) == STEP_DIED) {
+	died += 1;
+	break;
+      }
+      // past this point the snake only goes around the cycle
+      if (game.snake.length + game.snake.grow >= pilot.cycle_len) {
+	full += 1;
+	break;
+      }
+    }
+
+    length += game.snake.length;
+    if (game.snake.length > best) {
+      best = game.snake.length;
+    }
+  }
+
+  qsort(times, moves, sizeof(float), compare_floats);
+
+  fprintf(stderr, "board:     %dx%d, cycle of %d cells\n", width, height, pilot.cycle_len);
+  fprintf(stderr, "games:     %zu (%zu died, %zu filled the cycle)\n", games, died, full);
+  fprintf(stderr, "length:    %.1f on average, %d at most\n", (double) length / games, best);
+  fprintf(stderr, "moves:     %zu (%.2f searches per move, %.1f%% along the cycle)\n", moves,
+	  (double) pilot.searches / moves, 100.0 * pilot.cycle_moves / moves);
+  fprintf(stderr, "decision:  %.4f ms mean, %.4f ms p50, %.4f ms p99, %.4f ms max\n",
+	  total * 1000 / moves, times[moves / 2], times[moves * 99 / 100], times[moves - 1]);
+  fprintf(stderr, "budget:    %.0f ms per move at full speed\n", MIN_SNAKE_MOVEMENT * 1000);
+
+  autopilot_free(&pilot);
+  free(times);
+  free_game(&game);
+
+  return 0;
+}
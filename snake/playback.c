@@ -0,0 +1,250 @@
+/*
+  Records and plays back replays of snake games (see include/replay.h).
+
+  Usage:
+
+    ./snake_replay -o file [-t ticks] [-s seed] [-b WIDTHxHEIGHT] [-m every]
+    ./snake_replay [-n seeks] [-k tick] file
+
+  With -o plays a game with the autopilot, headless, tick by tick as
+  main does, for `ticks` ticks (100000 unless given) or until the
+  snake dies, and saves its replay to file. With -m a random key is
+  also pressed about every `every` ticks.
+
+  Otherwise loads a replay and checks it: playing it from the start
+  must give back every snapshot and the checksum and score the game
+  ended with. Then it seeks to `seeks` random ticks (1000 unless
+  given), and reports how long loading and seeking took. With -k it
+  also prints the game at that tick, around the head of the snake.
+
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./include/snake.h"
+#include "./include/autopilot.h"
+#include "./include/replay.h"
+#include "./include/timing.h"
+
+#define DEFAULT_TICKS 100000
+#define DEFAULT_SEEKS 1000
+
+// cells printed around the head with -k
+#define VIEW_CELLS 30
+
+// -------------------
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s -o file [-t ticks] [-s seed] [-b WIDTHxHEIGHT] [-m every]\n", program);
+  fprintf(stderr, "       %s [-n seeks] [-k tick] file\n", program);
+  exit(1);
+}
+
+int record(const char *path, uint32_t ticks, uint64_t seed, int width, int height, int every) {
+  Game game;
+  Autopilot pilot;
+  Replay replay;
+
+  if (!new_game(&game, width, height, seed)) {
+    fprintf(stderr, "cannot create a %dx%d board (at most %dx%d)\n",
+	    width, height, MAX_BOARD_SIDE, MAX_BOARD_SIDE);
+    return 1;
+  }
+  if (!autopilot_init(&pilot, &game) || !replay_begin(&replay, &game, seed)) {
+    fprintf(stderr, "out of memory, or board larger than %d cells\n", AUTOPILOT_MAX_CELLS);
+    return 1;
+  }
+
+  // keys come from their own generator: the one of the game is part
+  // of its state, and drawing from it would change the game
+  uint64_t keys = ~seed;
+
+  double start = now_seconds();
+  while (replay.ticks < ticks && !game.quit) {
+    if (every > 0 && splitmix64(&keys) % every == 0) {
+      replay_play(&replay, &game, INPUT_MOVE, (Dir) (splitmix64(&keys) & 3));
+    }
+    // the autopilot turns right before the snake moves on its own
+    if (game.move_ticks + 1 >= SECONDS_TO_TICKS(game.game_speed)) {
+      Action action = autopilot_decide(&pilot, &game);
+      if (action != ACTION_NONE) {
+	replay_play(&replay, &game, INPUT_TURN, (Dir) (action - ACTION_RIGHT));
+      }
+    }
+    replay_tick(&replay, &game);
+  }
+  replay_end(&replay, &game);
+  double elapsed = now_seconds() - start;
+
+  if (replay.error || !replay_save(&replay, path)) {
+    fprintf(stderr, "cannot save the replay to %s\n", path);
+    return 1;
+  }
+
+  FILE *f = fopen(path, "rb");
+  long size = 0;
+  if (f && fseek(f, 0, SEEK_END) == 0) {
+    size = ftell(f);
+  }
+  if (f) {
+    fclose(f);
+  }
+
+  fprintf(stderr, "game:      %dx%d, seed %llu, %u ticks in %.2f s, score %d, length %d%s\n",
+	  width, height, (unsigned long long) seed, replay.ticks, elapsed, game.global_score,
+	  game.snake.length, game.quit ? ", died" : "");
+  fprintf(stderr, "replay:    %ld bytes, %u inputs, %u snapshots\n",
+	  size, replay.input_count, replay.snapshot_count);
+
+  replay_free(&replay);
+  autopilot_free(&pilot);
+  free_game(&game);
+
+  return 0;
+}
+
+void print_game(const Game *game, uint32_t tick) {
+  Pos head = SNAKE_AT(&game->snake, game->snake.length - 1);
+  int cols = game->board.width < VIEW_CELLS ? game->board.width : VIEW_CELLS;
+  int rows = game->board.height < VIEW_CELLS ? game->board.height : VIEW_CELLS;
+  int x0 = head.x - cols / 2;
+  int y0 = head.y - rows / 2;
+
+  printf("tick %u: score %d, length %d, head at %d,%d%s\n", tick, game->global_score,
+	 game->snake.length, head.x, head.y, game->quit ? ", dead" : "");
+
+  for (int j = 0; j < rows; j++) {
+    for (int i = 0; i < cols; i++) {
+      int x = ((x0 + i) % game->board.width + game->board.width) % game->board.width;
+      int y = ((y0 + j) % game->board.height + game->board.height) % game->board.height;
+      putchar(x == head.x && y == head.y ? '@' : " o*#"[board_at(game, x, y)]);
+    }
+    putchar('\n');
+  }
+}
+
+int play(const char *path, int seeks, long show) {
+  Replay replay;
+  Game game;
+
+  double start = now_seconds();
+  if (!replay_load(&replay, path)) {
+    fprintf(stderr, "cannot load a replay from %s\n", path);
+    return 1;
+  }
+  double load = now_seconds() - start;
+
+  if (!new_game(&game, replay.width, replay.height, replay.seed)) {
+    fprintf(stderr, "cannot create a %dx%d board\n", replay.width, replay.height);
+    return 1;
+  }
+
+  // straight through from the start, against every snapshot
+  Game check;
+  new_game(&check, replay.width, replay.height, replay.seed);
+  int bad = 0;
+  uint32_t input = 0;
+  uint32_t s = 0;
+  for (uint32_t t = 0; t <= replay.ticks; t++) {
+    if (s < replay.snapshot_count && replay.snapshots[s].tick == t) {
+      if (replay_seek(&replay, &check, t) != (long) input || game_checksum(&check) != game_checksum(&game)) {
+	fprintf(stderr, "snapshot at tick %u does not match\n", t);
+	bad = 1;
+      }
+      s += 1;
+    }
+    if (t < replay.ticks) {
+      replay_step(&replay, &game, t, &input);
+    }
+  }
+  if (game_checksum(&game) != replay.checksum || game.global_score != replay.score) {
+    fprintf(stderr, "the game does not end as it was recorded\n");
+    bad = 1;
+  }
+
+  float *times = malloc((seeks > 0 ? seeks : 1) * sizeof(float));
+  uint64_t rng = replay.seed;
+  for (int i = 0; i < seeks; i++) {
+    uint32_t tick = (uint32_t) (splitmix64(&rng) % ((uint64_t) replay.ticks + 1));
+    double begin = now_seconds();
+    if (replay_seek(&replay, &game, tick) < 0) {
+      fprintf(stderr, "cannot seek to tick %u\n", tick);
+      bad = 1;
+    }
+    times[i] = (float) ((now_seconds() - begin) * 1000);
+  }
+  qsort(times, seeks, sizeof(float), compare_floats);
+
+  fprintf(stderr, "replay:    %dx%d, seed %llu, %u ticks, %u inputs, %u snapshots, score %d\n",
+	  replay.width, replay.height, (unsigned long long) replay.seed, replay.ticks,
+	  replay.input_count, replay.snapshot_count, replay.score);
+  fprintf(stderr, "load:      %.3f ms\n", load * 1000);
+  if (seeks > 0) {
+    fprintf(stderr, "seek:      %.3f ms p50, %.3f ms p99, %.3f ms max\n",
+	    times[seeks / 2], times[seeks * 99 / 100], times[seeks - 1]);
+  }
+  fprintf(stderr, "check:     %s\n", bad ? "MISMATCH" : "every snapshot and the end match");
+
+  if (show >= 0) {
+    if (replay_seek(&replay, &game, (uint32_t) show) < 0) {
+      fprintf(stderr, "tick %ld is past the end (%u)\n", show, replay.ticks);
+      bad = 1;
+    } else {
+      print_game(&game, (uint32_t) show);
+    }
+  }
+
+  free(times);
+  free_game(&check);
+  free_game(&game);
+  replay_free(&replay);
+
+  return bad;
+}
+
+int main(int argc, char **argv) {
+  const char *out = NULL;
+  uint32_t ticks = DEFAULT_TICKS;
+  uint64_t seed = time(NULL);
+  int width = DEFAULT_BOARD_WIDTH;
+  int height = DEFAULT_BOARD_HEIGHT;
+  int every = 0;
+  int seeks = DEFAULT_SEEKS;
+  long show = -1;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:t:s:b:m:n:k:")) != -1) {
+    switch (opt) {
+    case 'o': out = optarg; break;
+    case 't': ticks = strtoul(optarg, NULL, 10); break;
+    case 's': seed = strtoull(optarg, NULL, 10); break;
+    case 'm': every = atoi(optarg); break;
+    case 'n': seeks = atoi(optarg); break;
+    case 'k': show = atol(optarg); break;
+    case 'b':
+      if (sscanf(optarg, "%dx%d", &width, &height) != 2) {
+	usage(argv[0]);
+      }
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (out) {
+    if (optind != argc) {
+      usage(argv[0]);
+    }
+    return record(out, ticks, seed, width, height, every);
+  }
+  if (optind != argc - 1 || seeks < 0) {
+    usage(argv[0]);
+  }
+  return play(argv[optind], seeks, show);
+}
@@ -0,0 +1,160 @@
+/*
+  Neural network policy for snake, see include/policy.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "./include/policy.h"
+
+// where each part of the parameters starts
+#define HIDDEN_WEIGHTS 0
+#define HIDDEN_BIASES (POLICY_INPUTS * POLICY_HIDDEN)
+#define OUTPUT_WEIGHTS (HIDDEN_BIASES + POLICY_HIDDEN)
+#define OUTPUT_BIASES (OUTPUT_WEIGHTS + POLICY_HIDDEN * POLICY_OUTPUTS)
+
+// -------------------
+// UTILS
+
+// y += a * x, over n floats, n a multiple of 4.
+static inline void add_scaled(float *y, const float *x, float a, int n) {
+#if defined(__SSE__)
+  __m128 scale = _mm_set1_ps(a);
+  for (int i = 0; i < n; i += 4) {
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(scale, _mm_loadu_ps(x + i))));
+  }
+#elif defined(__ARM_NEON)
+  for (int i = 0; i < n; i += 4) {
+    vst1q_f32(y + i, vmlaq_n_f32(vld1q_f32(y + i), vld1q_f32(x + i), a));
+  }
+#else
+  for (int i = 0; i < n; i++) {
+    y[i] += a * x[i];
+  }
+#endif
+}
+
+// -------------------
+
+void policy_observe(const Game *game, float *obs) {
+  const Snake *snake = &game->snake;
+  const Food *food = &game->food[0];
+  Pos head = SNAKE_AT(snake, snake->length - 1);
+  int width = game->board.width;
+  int height = game->board.height;
+  int alive = food->score > 0;
+
+  for (int d = 0; d < 4; d++) {
+    Pos p = head;
+    switch ((Dir) d) {
+    case DIR_RIGHT: p.x = p.x + 1 == width ? 0 : p.x + 1; break;
+    case DIR_LEFT:  p.x = p.x == 0 ? width - 1 : p.x - 1; break;
+    case DIR_UP:    p.y = p.y == 0 ? height - 1 : p.y - 1; break;
+    case DIR_DOWN:  p.y = p.y + 1 == height ? 0 : p.y + 1; break;
+    }
+
+    CellKind kind = board_at(game, p.x, p.y);
+    obs[d] = kind == CELL_SNAKE || kind == CELL_OBSTACLE;
+    obs[8 + d] = snake->dir == (Dir) d;
+  }
+
+  obs[4 + DIR_RIGHT] = alive && food->pos.x > head.x;
+  obs[4 + DIR_UP]    = alive && food->pos.y < head.y;
+  obs[4 + DIR_LEFT]  = alive && food->pos.x < head.x;
+  obs[4 + DIR_DOWN]  = alive && food->pos.y > head.y;
+}
+
+/*
+  Each layer starts from its biases and adds the column of weights of
+  each input, scaled by it. Observations are mostly zeros, and so are
+  the hidden units after the ReLU, and their columns are skipped.
+*/
+void policy_act(const Policy *p, const float *obs, size_t count, Action *actions) {
+  const float *w = p->params;
+  float hidden[POLICY_HIDDEN];
+  float out[POLICY_OUTPUTS];
+
+  for (size_t i = 0; i < count; i++, obs += POLICY_INPUTS) {
+    memcpy(hidden, w + HIDDEN_BIASES, sizeof(hidden));
+    for (int j = 0; j < POLICY_INPUTS; j++) {
+      if (obs[j] != 0) {
+	add_scaled(hidden, w + HIDDEN_WEIGHTS + j * POLICY_HIDDEN, obs[j], POLICY_HIDDEN);
+      }
+    }
+
+    memcpy(out, w + OUTPUT_BIASES, sizeof(out));
+    for (int j = 0; j < POLICY_HIDDEN; j++) {
+      if (hidden[j] > 0) {
+	add_scaled(out, w + OUTPUT_WEIGHTS + j * POLICY_OUTPUTS, hidden[j], POLICY_OUTPUTS);
+      }
+    }
+
+    int best = 0;
+    for (int k = 1; k < POLICY_OUTPUTS; k++) {
+      if (out[k] > out[best]) {
+	best = k;
+      }
+    }
+
+    actions[i] = (Action) (ACTION_RIGHT + best);
+  }
+}
+
+Action policy_decide(const Policy *p, const Game *game) {
+  float obs[POLICY_INPUTS];
+  Action action;
+
+  policy_observe(game, obs);
+  policy_act(p, obs, 1, &action);
+
+  Dir dir = (Dir) (action - ACTION_RIGHT);
+  if (game->snake.length >= 2 && dir == (game->snake.dir + 2) % 4) {
+    return ACTION_NONE;
+  }
+  return action;
+}
+
+// -------------------
+// CHECKPOINTS
+
+int policy_save(const Policy *p, const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    return 0;
+  }
+
+  fprintf(f, "%s %d %d %d %d\n", POLICY_MAGIC, POLICY_VERSION, POLICY_INPUTS, POLICY_HIDDEN, POLICY_OUTPUTS);
+  for (int i = 0; i < POLICY_PARAMS; i++) {
+    fprintf(f, "%.9g\n", p->params[i]);
+  }
+
+  int ok = !ferror(f);
+  ok &= fclose(f) == 0;
+  return ok;
+}
+
+int policy_load(Policy *p, const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    return 0;
+  }
+
+  char magic[32];
+  int version, inputs, hidden, outputs;
+  int ok = fscanf(f, "%31s %d %d %d %d", magic, &version, &inputs, &hidden, &outputs) == 5 &&
+    strcmp(magic, POLICY_MAGIC) == 0 && version == POLICY_VERSION &&
+    inputs == POLICY_INPUTS && hidden == POLICY_HIDDEN && outputs == POLICY_OUTPUTS;
+
+  for (int i = 0; ok && i < POLICY_PARAMS; i++) {
+    ok = fscanf(f, "%f", &p->params[i]) == 1;
+  }
+
+  fclose(f);
+  return ok;
+}
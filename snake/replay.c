@@ -0,0 +1,454 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/replay.h"
+
+// -------------------
+// UTILS
+
+// zigzag, so that small negative numbers take a single byte too
+static void put_signed(Buffer *buf, int value) {
+  buffer_put_varint(buf, ((uint64_t) (uint32_t) value << 1) ^ (uint64_t) (value < 0 ? -1 : 0));
+}
+
+static int get_signed(Reader *r) {
+  uint64_t v = reader_varint(r);
+  return (int) (uint32_t) ((v >> 1) ^ (uint64_t) -(int64_t) (v & 1));
+}
+
+static void put_pos(Buffer *buf, Pos p) {
+  put_signed(buf, p.x);
+  put_signed(buf, p.y);
+}
+
+static Pos get_pos(Reader *r) {
+  Pos p;
+  p.x = get_signed(r);
+  p.y = get_signed(r);
+  return p;
+}
+
+static int on_board(const Game *game, Pos p) {
+  return p.x >= 0 && p.y >= 0 && p.x < game->board.width && p.y < game->board.height;
+}
+
+// direction from a piece of the body to the next one, which is next
+// to it, maybe across the edge of the board
+static Dir dir_between(const Game *game, Pos from, Pos to) {
+  if (from.y == to.y) {
+    return to.x == from.x + 1 || (to.x == 0 && from.x == game->board.width - 1) ? DIR_RIGHT : DIR_LEFT;
+  }
+  return to.y == from.y + 1 || (to.y == 0 && from.y == game->board.height - 1) ? DIR_DOWN : DIR_UP;
+}
+
+static Pos step_towards(const Game *game, Pos p, Dir dir) {
+  switch (dir) {
+  case DIR_RIGHT: p.x = p.x + 1 == game->board.width ? 0 : p.x + 1; break;
+  case DIR_LEFT:  p.x = p.x == 0 ? game->board.width - 1 : p.x - 1; break;
+  case DIR_UP:    p.y = p.y == 0 ? game->board.height - 1 : p.y - 1; break;
+  case DIR_DOWN:  p.y = p.y + 1 == game->board.height ? 0 : p.y + 1; break;
+  }
+  return p;
+}
+
+// -------------------
+// SNAPSHOTS
+
+static void put_snapshot(Buffer *buf, const Game *game) {
+  const Snake *snake = &game->snake;
+
+  buffer_put_varint(buf, snake->length);
+  buffer_put_varint(buf, snake->grow);
+  buffer_put_varint(buf, snake->dir);
+  put_pos(buf, snake->last_tail);
+  put_pos(buf, SNAKE_AT(snake, 0));
+
+  // 4 pieces per byte
+  uint8_t bits = 0;
+  for (int i = 1; i < snake->length; i++) {
+    bits |= dir_between(game, SNAKE_AT(snake, i - 1), SNAKE_AT(snake, i)) << (2 * ((i - 1) % 4));
+    if ((i - 1) % 4 == 3 || i == snake->length - 1) {
+      buffer_put_byte(buf, bits);
+      bits = 0;
+    }
+  }
+
+  // food that was eaten stays where it was, but not on the board
+  for (int i = 0; i < FOODS_COUNT; i++) {
+    const Food *f = &game->food[i];
+    put_pos(buf, f->pos);
+    put_signed(buf, f->score);
+    buffer_put_byte(buf, on_board(game, f->pos) && board_at(game, f->pos.x, f->pos.y) == CELL_FOOD);
+  }
+
+  for (int i = 0; i < OBSTACLES_COUNT; i++) {
+    put_pos(buf, game->obs[i].pos);
+    buffer_put_byte(buf, (uint8_t) game->obs[i].init);
+  }
+
+  uint64_t speed;
+  memcpy(&speed, &game->game_speed, sizeof(speed));
+  buffer_put_u64(buf, speed);
+  buffer_put_u64(buf, game->rng);
+  buffer_put_varint(buf, game->quit);
+  put_signed(buf, game->global_score);
+  buffer_put_varint(buf, game->move_ticks);
+  buffer_put_varint(buf, game->food_ticks);
+  buffer_put_varint(buf, game->head_hit);
+}
+
+/*
+  Restores a game from a snapshot, rebuilding the board: obstacles
+  first, then the snake, then the food that was on the board.
+*/
+static int get_snapshot(Reader *r, Game *game) {
+  Snake *snake = &game->snake;
+
+  int length = (int) reader_varint(r);
+  if (r->error || length < 1 || length > game->board.width * game->board.height) {
+    return 0;
+  }
+
+  int capacity = INITIAL_SNAKE_CAPACITY;
+  while (capacity < length) {
+    capacity *= 2;
+  }
+  if (capacity != snake->capacity) {
+    Pos *body = malloc(capacity * sizeof(Pos));
+    if (!body) {
+      return 0;
+    }
+    free(snake->body);
+    snake->body = body;
+    snake->capacity = capacity;
+  }
+
+  snake->tail = 0;
+  snake->length = length;
+  snake->grow = (int) reader_varint(r);
+  snake->dir = (Dir) (reader_varint(r) & 3);
+  snake->last_tail = get_pos(r);
+  snake->body[0] = get_pos(r);
+  if (!on_board(game, snake->body[0])) {
+    return 0;
+  }
+
+  uint8_t bits = 0;
+  for (int i = 1; i < length; i++) {
+    if ((i - 1) % 4 == 0) {
+      bits = reader_byte(r);
+    }
+    snake->body[i] = step_towards(game, snake->body[i - 1], (Dir) ((bits >> (2 * ((i - 1) % 4))) & 3));
+  }
+
+  int food_on_board[FOODS_COUNT];
+  for (int i = 0; i < FOODS_COUNT; i++) {
+    game->food[i].pos = get_pos(r);
+    game->food[i].score = get_signed(r);
+    food_on_board[i] = reader_byte(r) && on_board(game, game->food[i].pos);
+  }
+
+  for (int i = 0; i < OBSTACLES_COUNT; i++) {
+    game->obs[i].pos = get_pos(r);
+    game->obs[i].init = reader_byte(r) && on_board(game, game->obs[i].pos);
+  }
+
+  uint64_t speed = reader_u64(r);
+  memcpy(&game->game_speed, &speed, sizeof(speed));
+  game->rng = reader_u64(r);
+  game->quit = (int) reader_varint(r);
+  game->global_score = get_signed(r);
+  game->move_ticks = (int) reader_varint(r);
+  game->food_ticks = (int) reader_varint(r);
+  game->head_hit = (CellKind) reader_varint(r);
+
+  if (r->error) {
+    return 0;
+  }
+
+  clear_board(game);
+  for (int i = 0; i < OBSTACLES_COUNT; i++) {
+    if (game->obs[i].init) {
+      board_set(game, game->obs[i].pos, CELL_OBSTACLE);
+    }
+  }
+  for (int i = 0; i < length; i++) {
+    // the head of a dead snake is over what it hit
+    if (board_get(game, snake->body[i]) != CELL_OBSTACLE) {
+      board_set(game, snake->body[i], CELL_SNAKE);
+    }
+  }
+  for (int i = 0; i < FOODS_COUNT; i++) {
+    if (food_on_board[i]) {
+      board_set(game, game->food[i].pos, CELL_FOOD);
+    }
+  }
+
+  return 1;
+}
+
+static void add_snapshot(Replay *r, const Game *game) {
+  if (r->snapshot_count == r->snapshot_cap) {
+    uint32_t cap = r->snapshot_cap ? 2 * r->snapshot_cap : 64;
+    Snapshot *snapshots = realloc(r->snapshots, cap * sizeof(Snapshot));
+    if (!snapshots) {
+      r->error = 1;
+      return;
+    }
+    r->snapshots = snapshots;
+    r->snapshot_cap = cap;
+  }
+
+  Snapshot *s = &r->snapshots[r->snapshot_count++];
+  s->tick = r->ticks;
+  s->input = r->input_count;
+  s->offset = r->data.len;
+  put_snapshot(&r->data, game);
+  s->size = r->data.len - s->offset;
+
+  r->error |= r->data.error;
+}
+
+// -------------------
+// RECORDING
+
+static void apply_input(Game *game, InputKind kind, Dir dir) {
+  switch (kind) {
+  case INPUT_MOVE:
+    if (move_snake(game, dir, 1)) {
+      resolve_move(game);
+    }
+    break;
+  case INPUT_TURN:
+    game->snake.dir = dir;
+    break;
+  }
+}
+
+int replay_begin(Replay *r, const Game *game, uint64_t seed) {
+  memset(r, 0, sizeof(*r));
+  r->width = game->board.width;
+  r->height = game->board.height;
+  r->seed = seed;
+
+  add_snapshot(r, game);
+  return !r->error;
+}
+
+void replay_play(Replay *r, Game *game, InputKind kind, Dir dir) {
+  apply_input(game, kind, dir);
+  if (!r) {
+    return;
+  }
+
+  if (r->input_count == r->input_cap) {
+    uint32_t cap = r->input_cap ? 2 * r->input_cap : 1024;
+    Input *inputs = realloc(r->inputs, cap * sizeof(Input));
+    if (!inputs) {
+      r->error = 1;
+      return;
+    }
+    r->inputs = inputs;
+    r->input_cap = cap;
+  }
+
+  r->inputs[r->input_count++] = (Input) {r->ticks, (uint8_t) kind, (uint8_t) dir};
+}
+
+void replay_tick(Replay *r, Game *game) {
+  update_game_state(game);
+  if (!r) {
+    return;
+  }
+
+  r->ticks += 1;
+
+  if (r->ticks % REPLAY_SNAPSHOT_TICKS == 0) {
+    add_snapshot(r, game);
+  }
+}
+
+void replay_end(Replay *r, const Game *game) {
+  r->checksum = game_checksum(game);
+  r->score = game->global_score;
+}
+
+// -------------------
+// FILES
+
+/*
+  Layout of a file, after REPLAY_MAGIC:
+
+    version, width, height, seed, ticks, score, checksum (8 bytes)
+    inputs count, then each input as ticks since the previous one << 3
+    | kind << 2 | dir
+    snapshots count, then each snapshot as tick, first input, size,
+    bytes
+*/
+int replay_save(const Replay *r, const char *path) {
+  Buffer buf = {0};
+
+  buffer_put_bytes(&buf, REPLAY_MAGIC, 4);
+  buffer_put_varint(&buf, REPLAY_VERSION);
+  buffer_put_varint(&buf, r->width);
+  buffer_put_varint(&buf, r->height);
+  buffer_put_varint(&buf, r->seed);
+  buffer_put_varint(&buf, r->ticks);
+  put_signed(&buf, r->score);
+  buffer_put_u64(&buf, r->checksum);
+
+  buffer_put_varint(&buf, r->input_count);
+  uint32_t prev = 0;
+  for (uint32_t i = 0; i < r->input_count; i++) {
+    const Input *in = &r->inputs[i];
+    buffer_put_varint(&buf, (uint64_t) (in->tick - prev) << 3 | in->kind << 2 | in->dir);
+    prev = in->tick;
+  }
+
+  buffer_put_varint(&buf, r->snapshot_count);
+  for (uint32_t i = 0; i < r->snapshot_count; i++) {
+    const Snapshot *s = &r->snapshots[i];
+    buffer_put_varint(&buf, s->tick);
+    buffer_put_varint(&buf, s->input);
+    buffer_put_varint(&buf, s->size);
+    buffer_put_bytes(&buf, r->data.data + s->offset, s->size);
+  }
+
+  FILE *f = fopen(path, "wb");
+  int ok = f && !buf.error && fwrite(buf.data, 1, buf.len, f) == buf.len;
+  if (f) {
+    ok &= fclose(f) == 0;
+  }
+
+  buffer_free(&buf);
+  return ok;
+}
+
+int replay_load(Replay *r, const char *path) {
+  memset(r, 0, sizeof(*r));
+
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return 0;
+  }
+
+  Buffer file = {0};
+  uint8_t chunk[1 << 16];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    buffer_put_bytes(&file, chunk, n);
+  }
+  int ok = !ferror(f) && !file.error && file.len >= 4 && memcmp(file.data, REPLAY_MAGIC, 4) == 0;
+  fclose(f);
+
+  Reader rd = {file.data + 4, file.data + file.len, 0};
+  if (ok) {
+    ok = reader_varint(&rd) == REPLAY_VERSION;
+  }
+
+  if (ok) {
+    uint64_t width = reader_varint(&rd);
+    uint64_t height = reader_varint(&rd);
+    r->width = (int) width;
+    r->height = (int) height;
+    r->seed = reader_varint(&rd);
+    r->ticks = (uint32_t) reader_varint(&rd);
+    r->score = get_signed(&rd);
+    r->checksum = reader_u64(&rd);
+
+    uint64_t count = reader_varint(&rd);
+    // every input takes at least a byte
+    ok = !rd.error && width >= 1 && width <= MAX_BOARD_SIDE && height >= 1 && height <= MAX_BOARD_SIDE &&
+      count <= (uint64_t) (rd.end - rd.pos);
+    r->inputs = malloc((count ? count : 1) * sizeof(Input));
+    ok = ok && r->inputs;
+
+    uint32_t tick = 0;
+    for (uint64_t i = 0; ok && i < count; i++) {
+      uint64_t v = reader_varint(&rd);
+      tick += (uint32_t) (v >> 3);
+      r->inputs[i] = (Input) {tick, (uint8_t) ((v >> 2) & 1), (uint8_t) (v & 3)};
+    }
+    r->input_count = r->input_cap = (uint32_t) count;
+  }
+
+  if (ok && !rd.error) {
+    uint64_t count = reader_varint(&rd);
+    ok = !rd.error && count > 0 && count <= (uint64_t) (rd.end - rd.pos);
+    r->snapshots = ok ? malloc(count * sizeof(Snapshot)) : NULL;
+    ok = ok && r->snapshots;
+
+    for (uint64_t i = 0; ok && i < count; i++) {
+      Snapshot *s = &r->snapshots[i];
+      s->tick = (uint32_t) reader_varint(&rd);
+      s->input = (uint32_t) reader_varint(&rd);
+      s->size = (size_t) reader_varint(&rd);
+      s->offset = r->data.len;
+      // the first one is the start of the game, seeks begin from it
+      ok = !rd.error && s->size <= (size_t) (rd.end - rd.pos) && s->input <= r->input_count &&
+	s->tick <= r->ticks && (i == 0 ? s->tick == 0 : s->tick > r->snapshots[i - 1].tick);
+      if (ok) {
+	buffer_put_bytes(&r->data, rd.pos, s->size);
+	rd.pos += s->size;
+      }
+    }
+    r->snapshot_count = r->snapshot_cap = (uint32_t) count;
+  }
+
+  ok = ok && !rd.error && !r->data.error;
+  buffer_free(&file);
+
+  if (!ok) {
+    replay_free(r);
+  }
+  return ok;
+}
+
+void replay_free(Replay *r) {
+  free(r->inputs);
+  free(r->snapshots);
+  buffer_free(&r->data);
+  memset(r, 0, sizeof(*r));
+}
+
+// -------------------
+// PLAYBACK
+
+void replay_step(const Replay *r, Game *game, uint32_t tick, uint32_t *input) {
+  while (*input < r->input_count && r->inputs[*input].tick == tick) {
+    const Input *in = &r->inputs[(*input)++];
+    apply_input(game, (InputKind) in->kind, (Dir) in->dir);
+  }
+  update_game_state(game);
+}
+
+long replay_seek(const Replay *r, Game *game, uint32_t tick) {
+  if (r->snapshot_count == 0 || tick > r->ticks) {
+    return -1;
+  }
+
+  // last snapshot at or before tick
+  uint32_t lo = 0;
+  uint32_t hi = r->snapshot_count;
+  while (hi - lo > 1) {
+    uint32_t mid = (lo + hi) / 2;
+    if (r->snapshots[mid].tick <= tick) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+
+  const Snapshot *s = &r->snapshots[lo];
+  Reader rd = {r->data.data + s->offset, r->data.data + s->offset + s->size, 0};
+  if (!get_snapshot(&rd, game)) {
+    return -1;
+  }
+
+  uint32_t input = s->input;
+  for (uint32_t t = s->tick; t < tick; t++) {
+    replay_step(r, game, t, &input);
+  }
+  return input;
+}
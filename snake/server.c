@@ -0,0 +1,412 @@
+/*
+  Multiplayer snake server (see include/arena.h and include/wire.h).
+
+  Usage:
+
+    ./snake_server [-s snakes] [-b WIDTHxHEIGHT] [-r rate] [-t ticks]
+		   [-p port | -u path] [-S seed]
+
+  Runs an arena of bot snakes at `rate` ticks per second (20 unless
+  given, 0 to run as fast as it can). With -p clients connect over TCP
+  to 127.0.0.1:port, with -u over a Unix socket. Each client takes over
+  one of the snakes from the bots and steers it by sending directions.
+  Clients get the whole board when they connect and, after every
+  tick, the cells that changed.
+
+  With -t it stops after that many ticks and prints how long they
+  took, split between the step of the arena (bots included) and the
+  encoding of the delta sent to the clients.
+
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "./include/arena.h"
+#include "./include/wire.h"
+#include "./include/timing.h"
+
+#define DEFAULT_SNAKES 1000
+#define DEFAULT_SIDE 512
+#define DEFAULT_RATE 20
+// one cell in FOOD_EVERY has food on it
+#define FOOD_EVERY 32
+
+#define MAX_CLIENTS 64
+// clients that fall further behind than this are dropped
+#define MAX_BACKLOG (16 << 20)
+
+// -------------------
+// STRUTTURE DATI
+
+typedef struct {
+  int fd;
+  int snake;   // -1 if all snakes are taken
+  Buffer out;  // not sent yet
+} Client;
+
+// -------------------
+// VARIABILI GLOBALI
+
+Arena ARENA = {0};
+Client CLIENTS[MAX_CLIENTS];
+int CLIENTS_COUNT = 0;
+// 1 for the snakes that a client steers
+uint8_t *STEERED = NULL;
+
+// -------------------
+// UTILS
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-s snakes] [-b WIDTHxHEIGHT] [-r rate] [-t ticks] [-p port | -u path] [-S seed]\n", program);
+  exit(1);
+}
+
+// -------------------
+// BOTS
+
+/*
+  Looks one cell ahead: goes for food next to the head, otherwise keeps
+  going, turning now and then or when something is in the way.
+*/
+void bot_turn(Arena *arena, int i, uint64_t *rng) {
+  Dir dir = arena->snakes[i].snake.dir;
+  int head = arena_head(arena, i);
+  uint64_t r = xorshift64(rng);
+
+  // straight, then left and right in a random order
+  Dir dirs[3] = {dir, (Dir) ((dir + 1) % 4), (Dir) ((dir + 3) % 4)};
+  if (r & 1) {
+    dirs[1] = (Dir) ((dir + 3) % 4);
+    dirs[2] = (Dir) ((dir + 1) % 4);
+  }
+  // one move in 16, prefer a turn
+  int first = (r >> 1) % 16 == 0 ? 1 : 0;
+
+  int best = -1;
+  int best_score = 0;
+  for (int k = 0; k < 3; k++) {
+    Dir d = dirs[(first + k) % 3];
+    uint32_t v = arena->grid[arena_neighbor(arena, head, d)];
+    int score = v == ARENA_FOOD ? 2 : v == ARENA_EMPTY ? 1 : 0;
+    if (score > best_score) {
+      best = d;
+      best_score = score;
+    }
+  }
+
+  if (best >= 0) {
+    arena_turn(arena, i, (Dir) best);
+  }
+}
+
+// -------------------
+// CLIENTS
+
+int listen_on(int port, const char *path) {
+  int fd;
+
+  if (path) {
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+      fprintf(stderr, "socket path too long: %s\n", path);
+      return -1;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+      perror(path);
+      return -1;
+    }
+  } else {
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int one = 1;
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+	bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+      perror("bind");
+      return -1;
+    }
+  }
+
+  if (listen(fd, MAX_CLIENTS) < 0 || fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+    perror("listen");
+    return -1;
+  }
+  return fd;
+}
+
+void drop_client(int k) {
+  Client *c = &CLIENTS[k];
+
+  close(c->fd);
+  if (c->snake >= 0) {
+    STEERED[c->snake] = 0;
+  }
+  buffer_free(&c->out);
+  CLIENTS[k] = CLIENTS[--CLIENTS_COUNT];
+}
+
+// Gives the new client a snake, the size of the board and all of it.
+void accept_clients(int listen_fd) {
+  int fd;
+
+  while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+    if (CLIENTS_COUNT == MAX_CLIENTS || fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+      close(fd);
+      continue;
+    }
+
+    Client *c = &CLIENTS[CLIENTS_COUNT++];
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    c->snake = -1;
+    for (int i = 0; i < ARENA.count; i++) {
+      if (!STEERED[i]) {
+	STEERED[i] = 1;
+	c->snake = i;
+	break;
+      }
+    }
+
+    wire_hello(&c->out, &ARENA, c->snake);
+    wire_keyframe(&c->out, &ARENA);
+  }
+}
+
+// Turns the snakes of the clients that sent a direction.
+void read_clients(void) {
+  uint8_t buf[256];
+
+  for (int k = 0; k < CLIENTS_COUNT; k++) {
+    Client *c = &CLIENTS[k];
+    ssize_t n = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      drop_client(k--);
+      continue;
+    }
+    for (ssize_t i = 0; i < n; i++) {
+      if (buf[i] < 4 && c->snake >= 0) {
+	arena_turn(&ARENA, c->snake, (Dir) buf[i]);
+      }
+    }
+  }
+}
+
+// Sends what each client can take without blocking.
+void flush_clients(void) {
+  for (int k = 0; k < CLIENTS_COUNT; k++) {
+    Client *c = &CLIENTS[k];
+
+    if (c->out.len > 0) {
+      ssize_t n = send(c->fd, c->out.data, c->out.len, MSG_DONTWAIT);
+      if (n > 0) {
+	buffer_consume(&c->out, n);
+      } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+	drop_client(k--);
+	continue;
+      }
+    }
+
+    if (c->out.error || c->out.len > MAX_BACKLOG) {
+      drop_client(k--);
+    }
+  }
+}
+
+// Serves the clients until `until`, or once if it already passed.
+void serve(int listen_fd, double until) {
+  do {
+    struct pollfd fds[MAX_CLIENTS + 1];
+    int n = 0;
+
+    fds[n++] = (struct pollfd) {listen_fd, POLLIN, 0};
+    for (int k = 0; k < CLIENTS_COUNT; k++) {
+      fds[n++] = (struct pollfd) {CLIENTS[k].fd, CLIENTS[k].out.len > 0 ? POLLIN | POLLOUT : POLLIN, 0};
+    }
+
+    double wait = until - now_seconds();
+    poll(fds, n, wait > 0 ? (int) (wait * 1000) + 1 : 0);
+
+    accept_clients(listen_fd);
+    read_clients();
+    flush_clients();
+  } while (now_seconds() < until);
+}
+
+// -------------------
+
+int main(int argc, char **argv) {
+  int snakes = DEFAULT_SNAKES;
+  int width = DEFAULT_SIDE;
+  int height = DEFAULT_SIDE;
+  double rate = DEFAULT_RATE;
+  long ticks = 0;
+  int port = 0;
+  const char *path = NULL;
+  uint64_t seed = 1;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:b:r:t:p:u:S:")) != -1) {
+    switch (opt) {
+    case 's': snakes = atoi(optarg); break;
+    case 'r': rate = atof(optarg); break;
+    case 't': ticks = atol(optarg); break;
+    case 'p': port = atoi(optarg); break;
+    case 'u': path = optarg; break;
+    case 'S': seed = strtoull(optarg, NULL, 10); break;
+    case 'b':
+      if (sscanf(optarg, "%dx%d", &width, &height) != 2) {
+	usage(argv[0]);
+      }
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (ticks < 0 || rate < 0 || (port && path)) {
+    usage(argv[0]);
+  }
+
+  if (!arena_init(&ARENA, width, height, snakes, FOOD_EVERY, seed)) {
+    fprintf(stderr, "cannot create an arena of %dx%d cells with %d snakes (at most %dx%d and %d)\n",
+	    width, height, snakes, ARENA_MAX_SIDE, ARENA_MAX_SIDE, ARENA_MAX_SNAKES);
+    return 1;
+  }
+
+  STEERED = calloc(snakes > 0 ? snakes : 1, 1);
+  float *step_times = ticks > 0 ? malloc(ticks * sizeof(float)) : NULL;
+  if (!STEERED || (ticks > 0 && !step_times)) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  int listen_fd = -1;
+  if (port || path) {
+    signal(SIGPIPE, SIG_IGN);
+    listen_fd = listen_on(port, path);
+    if (listen_fd < 0) {
+      return 1;
+    }
+  }
+
+  Buffer delta = {0};
+  uint64_t bots = seed ^ 0x2545F4914F6CDD1DULL;
+  double encode_total = 0;
+  double step_total = 0;
+  long bytes = 0;
+  long alive = 0;
+  long deaths = 0;
+  double next = now_seconds();
+
+  for (long t = 0; ticks == 0 || t < ticks; t++) {
+    // wait for the tick, serving the clients in the meantime
+    if (rate > 0) {
+      next += 1.0 / rate;
+      if (listen_fd >= 0) {
+	serve(listen_fd, next);
+      } else {
+	double wait = next - now_seconds();
+	if (wait > 0) {
+	  struct timespec ts = {(time_t) wait, (long) ((wait - (time_t) wait) * 1e9)};
+	  nanosleep(&ts, NULL);
+	}
+      }
+      if (now_seconds() > next + 1.0 / rate) {
+	// too far behind, do not try to catch up
+	next = now_seconds();
+      }
+    } else if (listen_fd >= 0) {
+      serve(listen_fd, 0);
+    }
+
+    double start = now_seconds();
+    for (int i = 0; i < ARENA.count; i++) {
+      if (ARENA.snakes[i].alive && !STEERED[i]) {
+	bot_turn(&ARENA, i, &bots);
+      }
+    }
+    arena_step(&ARENA);
+    double stepped = now_seconds();
+
+    delta.len = 0;
+    wire_delta(&delta, &ARENA);
+    for (int k = 0; k < CLIENTS_COUNT; k++) {
+      Buffer *out = &CLIENTS[k].out;
+      if (out->len + delta.len > MAX_BACKLOG) {
+	out->error = 1;  // dropped by flush_clients()
+      }
+      buffer_put_bytes(out, delta.data, delta.len);
+    }
+    double encoded = now_seconds();
+
+    if (listen_fd >= 0) {
+      flush_clients();
+    }
+
+    if (step_times) {
+      step_times[t] = (float) ((stepped - start) * 1000);
+    }
+    step_total += stepped - start;
+    encode_total += encoded - stepped;
+    bytes += delta.len;
+    deaths += ARENA.deaths;
+    for (int i = 0; i < ARENA.count; i++) {
+      alive += ARENA.snakes[i].alive;
+    }
+  }
+
+  qsort(step_times, ticks, sizeof(float), compare_floats);
+
+  Buffer keyframe = {0};
+  wire_keyframe(&keyframe, &ARENA);
+
+  fprintf(stderr, "arena:     %dx%d, %d snakes (%.0f alive on average, %.2f deaths per tick)\n",
+	  width, height, snakes, (double) alive / ticks, (double) deaths / ticks);
+  fprintf(stderr, "step:      %.4f ms mean, %.4f ms p50, %.4f ms p99, %.4f ms max\n",
+	  step_total * 1000 / ticks, step_times[ticks / 2], step_times[ticks * 99 / 100], step_times[ticks - 1]);
+  fprintf(stderr, "delta:     %.4f ms mean to encode, %.0f bytes per tick (keyframe %zu bytes)\n",
+	  encode_total * 1000 / ticks, (double) bytes / ticks, keyframe.len);
+  if (rate > 0) {
+    fprintf(stderr, "budget:    %.0f ms per tick at %.0f Hz\n", 1000 / rate, rate);
+  }
+
+  while (CLIENTS_COUNT > 0) {
+    drop_client(0);
+  }
+  if (listen_fd >= 0) {
+    close(listen_fd);
+  }
+  if (path) {
+    unlink(path);
+  }
+  buffer_free(&keyframe);
+  buffer_free(&delta);
+  free(step_times);
+  free(STEERED);
+  arena_free(&ARENA);
+
+  return 0;
+}
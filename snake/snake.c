@@ -0,0 +1,605 @@
+/*
+  Game logic of snake, see include/snake.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/snake.h"
+
+// NOTE: to use these off has to be an int initialized to 0
+#define STAR_OBSTACLE(game, off, x, y)					\
+  (game)->obs[off++] = (Obstacle){(Pos) {x    , y}    , 1};		\
+  (game)->obs[off++] = (Obstacle){(Pos) {x + 1, y}    , 1};		\
+  (game)->obs[off++] = (Obstacle){(Pos) {x - 1, y}    , 1};		\
+  (game)->obs[off++] = (Obstacle){(Pos) {x    , y + 1}, 1};		\
+  (game)->obs[off++] = (Obstacle){(Pos) {x    , y - 1}, 1};
+
+#define HORIZONTAL_WALL_OBSACLE(game, off, x, y)		\
+  (game)->obs[off++] = (Obstacle){(Pos) {x    , y}    , 1};	\
+  (game)->obs[off++] = (Obstacle){(Pos) {x + 1, y}    , 1};	\
+  (game)->obs[off++] = (Obstacle){(Pos) {x + 1, y}    , 1};	\
+  (game)->obs[off++] = (Obstacle){(Pos) {x - 1, y}    , 1};	\
+  (game)->obs[off++] = (Obstacle){(Pos) {x -2 , y}    , 1};
+
+// random cells to try before counting the empty ones
+#define RANDOM_CELL_TRIES 16
+
+// -------------------
+// UTILS
+
+// cells along one side of a chunk, fewer on the last row and column
+static int chunk_side(int board_side, int chunk) {
+  int side = board_side - chunk * CHUNK_SIDE;
+  return side < CHUNK_SIDE ? side : CHUNK_SIDE;
+}
+
+uint64_t random_next(Game *game) {
+  return splitmix64(&game->rng);
+}
+
+// Lemire's multiply-shift, without the modulo of rand() % n
+int random_int_range(Game *game, int low, int high) {
+  return (int) (((random_next(game) >> 32) * (uint64_t) (high - low)) >> 32) + low;
+}
+
+Pos random_board_pos(Game *game) {
+  Pos p = {0};
+  p.x = random_int_range(game, 0, game->board.width);
+  p.y = random_int_range(game, 0, game->board.height);
+
+  return p;
+}
+
+Dir random_dir(Game *game) {
+  return (Dir) random_int_range(game, 0, 4);
+
+}
+
+int pos_is_not_empty(Game *game, Pos p) {
+  return board_get(game, p) != CELL_EMPTY;
+}
+
+/*
+  Picks one of the empty cells, or returns {-1, -1} if the board is
+  full. While most of the board is empty a few random cells are
+  enough, otherwise the tree of the empty cells of each chunk leads to
+  the chunk of the one that was picked, and that chunk is scanned.
+*/
+Pos random_empty_board_pos(Game *game) {
+  const Board *board = &game->board;
+  long empty = (long) board->width * board->height - board->occupied;
+
+  if (empty == 0) {
+    return (Pos) {-1, -1};
+  }
+
+  for (int i = 0; i < RANDOM_CELL_TRIES; i++) {
+    Pos p = random_board_pos(game);
+    if (board_get(game, p) == CELL_EMPTY) {
+      return p;
+    }
+  }
+
+  int k = random_int_range(game, 0, (int) empty);
+  int chunks = board->chunks_x * board->chunks_y;
+  int c = 0;
+
+  // the last chunk whose empty cells before it are at most k
+  for (int step = board->free_top; step > 0; step >>= 1) {
+    if (c + step <= chunks && board->free_tree[c + step] <= k) {
+      c += step;
+      k -= board->free_tree[c];
+    }
+  }
+
+  int cx = c % board->chunks_x;
+  int cy = c / board->chunks_x;
+  const Chunk *chunk = board->chunks[c];
+  int w = chunk_side(board->width, cx);
+  int h = chunk_side(board->height, cy);
+
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      if ((!chunk || chunk->cells[(y << CHUNK_BITS) | x] == CELL_EMPTY) && k-- == 0) {
+	return (Pos) {cx * CHUNK_SIDE + x, cy * CHUNK_SIDE + y};
+      }
+    }
+  }
+
+  return (Pos) {-1, -1};
+}
+
+// -------------------
+// BOARD
+
+// Every chunk all empty, built from the leaves up in O(chunks).
+static void free_tree_reset(Board *board) {
+  int chunks = board->chunks_x * board->chunks_y;
+
+  for (int i = 1; i <= chunks; i++) {
+    int cx = (i - 1) % board->chunks_x;
+    int cy = (i - 1) / board->chunks_x;
+    board->free_tree[i] = chunk_side(board->width, cx) * chunk_side(board->height, cy);
+  }
+  for (int i = 1; i <= chunks; i++) {
+    int parent = i + (i & -i);
+    if (parent <= chunks) {
+      board->free_tree[parent] += board->free_tree[i];
+    }
+  }
+}
+
+static void free_tree_add(Board *board, int chunk, int delta) {
+  int chunks = board->chunks_x * board->chunks_y;
+
+  for (int i = chunk + 1; i <= chunks; i += i & -i) {
+    board->free_tree[i] += delta;
+  }
+}
+
+int init_board(Game *game, int width, int height) {
+  Board *board = &game->board;
+
+  if (width < 1 || height < 1 || width > MAX_BOARD_SIDE || height > MAX_BOARD_SIDE) {
+    return 0;
+  }
+
+  board->width = width;
+  board->height = height;
+  board->chunks_x = (width + CHUNK_MASK) >> CHUNK_BITS;
+  board->chunks_y = (height + CHUNK_MASK) >> CHUNK_BITS;
+  board->chunks = calloc(board->chunks_x * board->chunks_y, sizeof(Chunk *));
+  board->spare = NULL;
+  board->occupied = 0;
+  board->free_tree = malloc((board->chunks_x * board->chunks_y + 1) * sizeof(int));
+  board->free_top = 1;
+  while (board->free_top * 2 <= board->chunks_x * board->chunks_y) {
+    board->free_top *= 2;
+  }
+
+  if (!board->chunks || !board->free_tree) {
+    return 0;
+  }
+  free_tree_reset(board);
+  return 1;
+}
+
+// Empties the board, freeing all of its chunks but one.
+void clear_board(Game *game) {
+  Board *board = &game->board;
+
+  for (int i = 0; i < board->chunks_x * board->chunks_y; i++) {
+    if (board->chunks[i]) {
+      free(board->spare);
+      board->spare = board->chunks[i];
+      board->chunks[i] = NULL;
+    }
+  }
+  board->occupied = 0;
+  free_tree_reset(board);
+}
+
+void free_board(Game *game) {
+  // without the tree init_board() failed before any chunk was used
+  if (game->board.chunks && game->board.free_tree) {
+    clear_board(game);
+  }
+  free(game->board.spare);
+  free(game->board.chunks);
+  free(game->board.free_tree);
+  memset(&game->board, 0, sizeof(game->board));
+}
+
+CellKind board_get(const Game *game, Pos p) {
+  return board_at(game, p.x, p.y);
+}
+
+/*
+  Every change to the board goes through here, so that each chunk
+  knows how many of its cells are in use, and the tree of the empty
+  cells stays up to date. A chunk is allocated when
+  something is put in it, and freed when it gets empty again (keeping
+  the last one aside, as the snake often goes back and forth between
+  two chunks). Without memory for a new chunk the game ends.
+*/
+void board_set(Game *game, Pos p, CellKind kind) {
+  Board *board = &game->board;
+  int index = (p.y >> CHUNK_BITS) * board->chunks_x + (p.x >> CHUNK_BITS);
+  Chunk **slot = &board->chunks[index];
+  Chunk *chunk = *slot;
+
+  if (!chunk) {
+    if (kind == CELL_EMPTY) {
+      return;
+    }
+
+    chunk = board->spare ? board->spare : malloc(sizeof(Chunk));
+    board->spare = NULL;
+    if (!chunk) {
+      game->quit = 1;
+      return;
+    }
+
+    memset(chunk->cells, CELL_EMPTY, sizeof(chunk->cells));
+    chunk->used = 0;
+    *slot = chunk;
+  }
+
+  uint8_t *cell = &chunk->cells[((p.y & CHUNK_MASK) << CHUNK_BITS) | (p.x & CHUNK_MASK)];
+  int used = (kind != CELL_EMPTY) - (*cell != CELL_EMPTY);
+
+  *cell = kind;
+  chunk->used += used;
+  board->occupied += used;
+  if (used) {
+    free_tree_add(board, index, -used);
+  }
+
+  if (chunk->used == 0) {
+    free(board->spare);
+    board->spare = chunk;
+    *slot = NULL;
+  }
+}
+
+// -------------------
+// GAME LOGIC FUNCTIONS
+
+/*
+  Creates a game on an empty board of the given size, and starts it.
+  Returns 0 if the size is not valid or there is not enough memory.
+*/
+int new_game(Game *game, int width, int height, uint64_t seed) {
+  memset(game, 0, sizeof(*game));
+
+  game->snake.capacity = INITIAL_SNAKE_CAPACITY;
+  game->snake.body = malloc(INITIAL_SNAKE_CAPACITY * sizeof(Pos));
+
+  if (!game->snake.body || !init_board(game, width, height)) {
+    free_game(game);
+    return 0;
+  }
+
+  init_game(game, seed);
+  return 1;
+}
+
+// Starts a new game on the same board.
+void init_game(Game *game, uint64_t seed) {
+  game->rng = seed;
+  game->quit = 0;
+  clear_board(game);
+
+  // init obstacles, first so that nothing else spawns on them. Those
+  // that do not fit on a small board are left out.
+  memset(game->obs, 0, sizeof(game->obs));
+  int off = 0;  
+  STAR_OBSTACLE(game, off, 10, 10);
+  HORIZONTAL_WALL_OBSACLE(game, off, 20, 20)
+
+  for (int i = 0; i < OBSTACLES_COUNT; i++) {
+    Pos p = game->obs[i].pos;
+    if (p.x >= game->board.width || p.y >= game->board.height) {
+      game->obs[i].init = 0;
+    }
+    if (game->obs[i].init) {
+      board_set(game, p, CELL_OBSTACLE);
+    }
+  }
+
+  // -- init snake
+  game->snake.body[0] = random_empty_board_pos(game);
+  game->snake.tail = 0;
+  game->snake.length = 1;
+  game->snake.grow = 0;
+  game->snake.last_tail = game->snake.body[0];
+  game->snake.dir = random_dir(game);
+  board_set(game, game->snake.body[0], CELL_SNAKE);
+  
+  init_food(game);
+
+  game->global_score = 0;
+  game->game_speed = MAX_SNAKE_MOVEMENT;
+  game->move_ticks = 0;
+  game->food_ticks = 0;
+  game->head_hit = CELL_EMPTY;
+}
+
+void free_game(Game *game) {
+  free(game->snake.body);
+  free_board(game);
+  memset(game, 0, sizeof(*game));
+}
+
+static uint64_t checksum_add(uint64_t sum, uint64_t value) {
+  sum ^= value;
+  return splitmix64(&sum);
+}
+
+/*
+  Sums up the state of a game, the body of the snake included, so that
+  two games can be compared without looking at how their memory is
+  laid out.
+*/
+uint64_t game_checksum(const Game *game) {
+  const Snake *snake = &game->snake;
+  uint64_t sum = 0;
+
+  sum = checksum_add(sum, game->board.width);
+  sum = checksum_add(sum, game->board.height);
+  sum = checksum_add(sum, game->board.occupied);
+  for (int i = 0; i < snake->length; i++) {
+    Pos p = SNAKE_AT(snake, i);
+    sum = checksum_add(sum, (uint64_t) p.y * MAX_BOARD_SIDE + p.x);
+  }
+  sum = checksum_add(sum, snake->grow);
+  sum = checksum_add(sum, snake->dir);
+  sum = checksum_add(sum, (uint64_t) snake->last_tail.y * MAX_BOARD_SIDE + snake->last_tail.x);
+  for (int i = 0; i < FOODS_COUNT; i++) {
+    sum = checksum_add(sum, (uint64_t) game->food[i].pos.y * MAX_BOARD_SIDE + game->food[i].pos.x);
+    sum = checksum_add(sum, game->food[i].score);
+  }
+  sum = checksum_add(sum, game->quit);
+  sum = checksum_add(sum, game->global_score);
+  sum = checksum_add(sum, game->rng);
+  sum = checksum_add(sum, game->move_ticks);
+  sum = checksum_add(sum, game->food_ticks);
+  sum = checksum_add(sum, game->head_hit);
+
+  return sum;
+}
+
+Pos *get_snake_head(Snake *snake) {
+  return &SNAKE_AT(snake, snake->length - 1);
+}
+
+/*
+  The snake moves on its own every game_speed seconds, counted in
+  ticks. Manual moves are always allowed, and restart the count.
+*/
+int allow_snake_movement(int manual, Game *game) {
+  if (!manual && game->move_ticks < SECONDS_TO_TICKS(game->game_speed)) {
+    // not enough time has passed for automatic movement
+    return 0;
+  } else {
+    game->move_ticks = 0;
+    return 1;
+  }
+}
+
+Pos peak_next_pos(Game *game, Dir new_dir) {
+  Pos new_pos;
+  Pos *head_pos = get_snake_head(&game->snake);
+  int width = game->board.width;
+  int height = game->board.height;
+
+  switch(new_dir) {
+  case DIR_RIGHT:
+    new_pos.x = head_pos->x + 1 == width ? 0 : head_pos->x + 1;
+    new_pos.y = head_pos->y;
+    break;
+    
+  case DIR_LEFT:
+    new_pos.x = head_pos->x == 0 ? width - 1 : head_pos->x - 1;
+    new_pos.y = head_pos->y;
+    break;
+
+  case DIR_UP:
+    new_pos.x = head_pos->x;    
+    new_pos.y = head_pos->y == 0 ? height - 1 : head_pos->y - 1;
+    break;
+
+  case DIR_DOWN:
+    new_pos.x = head_pos->x;    
+    new_pos.y = head_pos->y + 1 == height ? 0 : head_pos->y + 1;
+    break;
+  }
+
+  return new_pos;
+  
+}
+
+/*
+  Makes room in the body for one more piece, doubling it when it is
+  full. Returns 0 if there is not enough memory.
+*/
+int grow_body(Snake *snake) {
+  if (snake->length < snake->capacity) {
+    return 1;
+  }
+
+  Pos *body = malloc(2 * snake->capacity * sizeof(Pos));
+  if (!body) {
+    return 0;
+  }
+
+  for (int i = 0; i < snake->length; i++) {
+    body[i] = SNAKE_AT(snake, i);
+  }
+  free(snake->body);
+  snake->body = body;
+  snake->tail = 0;
+  snake->capacity *= 2;
+  return 1;
+}
+
+/*
+  Moves the snake one cell, returns 1 if it moved. What the head ran
+  into is left in head_hit, and each move has to be resolved with
+  resolve_move() before the next one, or the snake could go through
+  an obstacle with two keys between ticks.
+*/
+int move_snake(Game *game, Dir new_dir, int manual) {
+  if (game->quit || !allow_snake_movement(manual, game)) {
+    return 0;
+  }
+
+  Snake *snake = &game->snake;
+  Pos new_pos = peak_next_pos(game, new_dir);
+
+  // cant move back to snake's own tail
+  if (snake->length >= 2 &&
+      new_pos.x == SNAKE_AT(snake, snake->length - 2).x &&
+      new_pos.y == SNAKE_AT(snake, snake->length - 2).y)
+    return 0;
+
+  // perform movement: the tail leaves its cell before the head takes
+  // the new one, so that the snake can follow its own tail. When
+  // growing the tail stays, and the head takes a new slot instead.
+  if (snake->grow > 0 && grow_body(snake)) {
+    snake->grow -= 1;
+    snake->length += 1;
+    snake->last_tail = snake->body[snake->tail];
+  } else {
+    snake->last_tail = snake->body[snake->tail];
+    board_set(game, snake->last_tail, CELL_EMPTY);
+    snake->tail = (snake->tail + 1) & (snake->capacity - 1);
+  }
+
+  // a head that hits something stays on top of it, and the cell
+  // keeps what was there
+  game->head_hit = board_get(game, new_pos);
+  if (game->head_hit == CELL_EMPTY || game->head_hit == CELL_FOOD) {
+    board_set(game, new_pos, CELL_SNAKE);
+  }
+
+  *get_snake_head(snake) = new_pos;
+  snake->dir = new_dir;
+  return 1;
+}
+
+void eat_food(Game *game, Food *f) {
+  Snake *snake = &game->snake;
+
+  // eat food
+  game->global_score += f->score;
+  f->score = 0;
+
+  // grow snake's body, on the next move
+  snake->grow += 1;
+
+  return;
+}
+
+void init_food(Game *game) {
+  for (int i = 0; i < FOODS_COUNT; i++) {
+    Food *f = &game->food[i];
+
+    // food that was not eaten moves somewhere else
+    if (f->score > 0 && board_get(game, f->pos) == CELL_FOOD) {
+      board_set(game, f->pos, CELL_EMPTY);
+    }
+
+    f->pos = random_empty_board_pos(game);
+    f->score = f->pos.x >= 0 ? 1 : 0;
+
+    if (f->score) {
+      board_set(game, f->pos, CELL_FOOD);
+    }
+  }
+
+  return;
+}
+
+int allow_refresh_food(Game *game, int ticks) {
+  game->food_ticks += ticks;
+
+  if (game->food_ticks < FOOD_SPAWN_TICKS) {
+    return 0;
+  } else {
+    game->food_ticks = 0;
+    return 1;
+  }
+}
+
+Food *check_for_food(Game *game) {
+  Snake *snake = &game->snake;
+  Pos head_pos = *get_snake_head(snake);
+
+  if (game->head_hit != CELL_FOOD) {
+    return NULL;
+  }
+
+  for (int i = 0; i < FOODS_COUNT; i++) {
+    Food *f = &game->food[i];
+
+    if(f->pos.x == head_pos.x && f->pos.y == head_pos.y && f->score > 0) {
+      return f;
+    }
+  }
+
+  return NULL;
+}
+
+void update_food(Game *game, int ticks) {
+  if (allow_refresh_food(game, ticks)) {
+    init_food(game);
+  }
+  return;
+}
+
+void update_game_speed(Game *game) {
+  double step_update = game->global_score * STEP_SNAKE_MOVEMENT;
+  
+  if (MAX_SNAKE_MOVEMENT - step_update < MIN_SNAKE_MOVEMENT) {
+    game->game_speed = MIN_SNAKE_MOVEMENT;
+  } else {
+    game->game_speed = MAX_SNAKE_MOVEMENT - step_update;
+  }
+
+  return;
+}
+
+int check_for_obstacles(Game *game) {
+  // did we go into our own tail, or against an obstacle?
+  return game->head_hit == CELL_SNAKE || game->head_hit == CELL_OBSTACLE;
+}
+
+// Checks what the head ran into on the last move.
+StepEvent resolve_move(Game *game) {
+  if (check_for_obstacles(game)) {
+    game->quit = 1;
+    return STEP_DIED;
+  }
+
+  Food *f = check_for_food(game);
+  if (f) {
+    eat_food(game, f);
+    update_game_speed(game);
+    return STEP_ATE;
+  }
+
+  return STEP_NONE;
+}
+
+// Advances the game by one tick.
+void update_game_state(Game *game) {
+  game->move_ticks += 1;
+  if (move_snake(game, game->snake.dir, 0)) {
+    resolve_move(game);
+  }
+  update_food(game, 1);
+}
+
+/*
+  Advances the game by one move of the snake, turning first if the
+  action says so, as if the player pressed a key right when the snake
+  was about to move on its own. Food moves after the same number of
+  ticks as in the real-time game.
+*/
+StepEvent snake_step(Game *game, Action action) {
+  Dir dir = action == ACTION_NONE ? game->snake.dir : (Dir) (action - ACTION_RIGHT);
+  int ticks = SECONDS_TO_TICKS(game->game_speed);
+
+  // turning back into the neck is ignored, the snake keeps going
+  if (!move_snake(game, dir, 1)) {
+    move_snake(game, game->snake.dir, 1);
+  }
+
+  StepEvent e = resolve_move(game);
+  if (e != STEP_DIED) {
+    update_food(game, ticks);
+  }
+  return e;
+}
@@ -0,0 +1,347 @@
+/*
+  Trains a policy for snake (see include/policy.h) with a genetic
+  algorithm.
+
+  Usage:
+
+    ./snake_train [-p population] [-e games] [-m moves] [-g generations]
+		  [-j threads] [-s seed] [-i checkpoint] [-o checkpoint]
+
+  Every generation each policy of the population (256 unless given)
+  plays `games` games (16), the same ones for every policy, for at
+  most `moves` moves (2000) each. All the games of a generation are
+  one batch (see include/batch.h), split across threads (one per core
+  unless given), and each thread moves the games of a policy together,
+  with one call to policy_act() and one to batch_step() per move.
+
+  A game ends when the snake dies, or when it did not eat for
+  STARVE_MOVES moves. The fitness of a policy is the food it ate in
+  its games, plus a little for every move it stayed alive. The best
+  tenth of the population goes on as is, and the rest is made of
+  children of parents picked by tournament, mixing their parameters
+  and changing some of them a little.
+
+  After every generation it prints how it went, and saves its best
+  policy to the checkpoint given with -o, which the game loads
+  with `./main -a checkpoint`. With -i the population starts from a
+  checkpoint instead of from random parameters.
+
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "./include/snake.h"
+#include "./include/batch.h"
+#include "./include/policy.h"
+#include "./include/timing.h"
+
+#define DEFAULT_POPULATION 256
+#define DEFAULT_GAMES 16
+#define DEFAULT_MOVES 2000
+#define DEFAULT_GENERATIONS 100
+
+// a game ends after this many moves without eating, so that policies
+// going around in circles do not take all of the time
+#define STARVE_MOVES 300
+// fitness for each move alive, against 1 for each food eaten
+#define MOVE_FITNESS 0.001f
+
+#define TOURNAMENT 3
+#define MUTATION_RATE 0.1
+#define MUTATION_SIZE 0.2
+#define INIT_SIZE 0.5
+
+#define TAU 6.283185307179586
+
+// -------------------
+// STRUTTURE DATI
+
+typedef struct {
+  Batch *batch;
+  Action *actions;
+  const Policy *population;
+  size_t games;      // games of each policy
+  size_t moves;
+  size_t begin;
+  size_t end;
+
+  // of each game, valid in [begin, end)
+  uint8_t *over;     // the game ended, later moves do not count
+  uint16_t *hungry;  // moves since it last ate
+  float *fitness;
+
+  long steps;        // moves that counted, for the statistics
+} Worker;
+
+typedef struct {
+  float fitness;
+  int index;
+} Ranked;
+
+// -------------------
+// UTILS
+
+// Best first.
+int compare_ranked(const void *a, const void *b) {
+  float x = ((const Ranked *) a)->fitness;
+  float y = ((const Ranked *) b)->fitness;
+  return (x < y) - (x > y);
+}
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-p population] [-e games] [-m moves] [-g generations]\n", program);
+  fprintf(stderr, "       %*s [-j threads] [-s seed] [-i checkpoint] [-o checkpoint]\n", (int) strlen(program), "");
+  exit(1);
+}
+
+// uniform in [0, 1)
+double uniform(uint64_t *rng) {
+  return (splitmix64(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// standard normal, Box-Muller
+double gaussian(uint64_t *rng) {
+  double u = 1 - uniform(rng);
+  double v = uniform(rng);
+  return sqrt(-2 * log(u)) * cos(TAU * v);
+}
+
+// -------------------
+// EVALUATION
+
+/*
+  Plays the games of a worker, the games of one policy at a time, until
+  every one of them ended or ran out of moves. The policy runs once on
+  all of their observations, and they move with one batch_step().
+*/
+void *evaluate(void *arg) {
+  Worker *w = arg;
+  Batch *b = w->batch;
+
+  for (size_t begin = w->begin; begin < w->end;) {
+    size_t p = begin / w->games;
+    size_t end = (p + 1) * w->games < w->end ? (p + 1) * w->games : w->end;
+    size_t live = end - begin;
+
+    for (size_t m = 0; m < w->moves && live > 0; m++) {
+      policy_act(&w->population[p], b->obs + begin * BATCH_OBS_SIZE, end - begin, w->actions + begin);
+      batch_step(b, w->actions, begin, end);
+
+      for (size_t i = begin; i < end; i++) {
+	if (w->over[i]) {
+	  continue;
+	}
+
+	w->steps += 1;
+	if (b->done[i]) {
+	  w->over[i] = 1;
+	  live -= 1;
+	  continue;
+	}
+
+	w->fitness[i] += MOVE_FITNESS + (b->reward[i] > 0);
+	w->hungry[i] = b->reward[i] > 0 ? 0 : w->hungry[i] + 1;
+	if (w->hungry[i] >= STARVE_MOVES) {
+	  w->over[i] = 1;
+	  live -= 1;
+	}
+      }
+    }
+
+    begin = end;
+  }
+
+  return NULL;
+}
+
+// -------------------
+// EVOLUTION
+
+int tournament(const Ranked *ranked, size_t population, uint64_t *rng) {
+  // ranked is sorted, so the best of the picks is the lowest one
+  size_t best = population;
+  for (int k = 0; k < TOURNAMENT; k++) {
+    size_t pick = splitmix64(rng) % population;
+    best = pick < best ? pick : best;
+  }
+  return ranked[best].index;
+}
+
+void mutate(Policy *p, uint64_t *rng) {
+  for (int i = 0; i < POLICY_PARAMS; i++) {
+    if (uniform(rng) < MUTATION_RATE) {
+      p->params[i] += (float) (gaussian(rng) * MUTATION_SIZE);
+    }
+  }
+}
+
+void next_generation(const Policy *population, const Ranked *ranked, size_t count, Policy *next, uint64_t *rng) {
+  size_t elite = count / 10 ? count / 10 : 1;
+
+  for (size_t i = 0; i < elite; i++) {
+    next[i] = population[ranked[i].index];
+  }
+
+  for (size_t i = elite; i < count; i++) {
+    const Policy *a = &population[tournament(ranked, count, rng)];
+    const Policy *b = &population[tournament(ranked, count, rng)];
+
+    for (int k = 0; k < POLICY_PARAMS; k++) {
+      next[i].params[k] = splitmix64(rng) & 1 ? a->params[k] : b->params[k];
+    }
+    mutate(&next[i], rng);
+  }
+}
+
+// -------------------
+
+int main(int argc, char **argv) {
+  size_t population = DEFAULT_POPULATION;
+  size_t games = DEFAULT_GAMES;
+  size_t moves = DEFAULT_MOVES;
+  size_t generations = DEFAULT_GENERATIONS;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  uint64_t seed = 1;
+  const char *in = NULL;
+  const char *out = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:e:m:g:j:s:i:o:")) != -1) {
+    switch (opt) {
+    case 'p': population = strtoull(optarg, NULL, 10); break;
+    case 'e': games = strtoull(optarg, NULL, 10); break;
+    case 'm': moves = strtoull(optarg, NULL, 10); break;
+    case 'g': generations = strtoull(optarg, NULL, 10); break;
+    case 'j': threads = atol(optarg); break;
+    case 's': seed = strtoull(optarg, NULL, 10); break;
+    case 'i': in = optarg; break;
+    case 'o': out = optarg; break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (population < 2 || games == 0 || moves == 0 || optind != argc) {
+    usage(argv[0]);
+  }
+  if (threads < 1) {
+    threads = 1;
+  }
+
+  size_t count = population * games;
+  Policy *pop = malloc(population * sizeof(Policy));
+  Policy *next = malloc(population * sizeof(Policy));
+  Ranked *ranked = malloc(population * sizeof(Ranked));
+  Batch *b = batch_create(count, seed, NULL);
+  Action *actions = calloc(count, sizeof(Action));
+  uint8_t *over = calloc(count, sizeof(uint8_t));
+  uint16_t *hungry = calloc(count, sizeof(uint16_t));
+  float *fitness = calloc(count, sizeof(float));
+  Worker *workers = calloc(threads, sizeof(Worker));
+  pthread_t *ids = calloc(threads, sizeof(pthread_t));
+
+  if (!pop || !next || !ranked || !b || !actions || !over || !hungry || !fitness || !workers || !ids) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  uint64_t rng = seed;
+  Policy start;
+  if (in && !policy_load(&start, in)) {
+    fprintf(stderr, "cannot load a policy from %s\n", in);
+    return 1;
+  }
+  for (size_t i = 0; i < population; i++) {
+    if (in) {
+      pop[i] = start;
+      if (i > 0) {
+	mutate(&pop[i], &rng);
+      }
+    } else {
+      for (int k = 0; k < POLICY_PARAMS; k++) {
+	pop[i].params[k] = (float) (gaussian(&rng) * INIT_SIZE);
+      }
+    }
+  }
+
+  long steps = 0;
+  double start_time = now_seconds();
+
+  for (size_t g = 0; g < generations; g++) {
+    double gen_start = now_seconds();
+
+    // every policy plays the same games, new ones every generation
+    uint64_t games_seed = splitmix64(&rng);
+    for (size_t i = 0; i < count; i++) {
+      b->rng[i] = games_seed + i % games;
+      batch_reset(b, i);
+    }
+    memset(over, 0, count * sizeof(uint8_t));
+    memset(hungry, 0, count * sizeof(uint16_t));
+    memset(fitness, 0, count * sizeof(float));
+
+    for (long t = 0; t < threads; t++) {
+      workers[t] = (Worker) {
+	.batch = b, .actions = actions, .population = pop, .games = games, .moves = moves,
+	.over = over, .hungry = hungry, .fitness = fitness,
+      };
+      batch_partition(b, threads, t, &workers[t].begin, &workers[t].end);
+      pthread_create(&ids[t], NULL, evaluate, &workers[t]);
+    }
+    for (long t = 0; t < threads; t++) {
+      pthread_join(ids[t], NULL);
+      steps += workers[t].steps;
+    }
+
+    double mean = 0;
+    for (size_t p = 0; p < population; p++) {
+      ranked[p] = (Ranked) {0, (int) p};
+      for (size_t e = 0; e < games; e++) {
+	ranked[p].fitness += fitness[p * games + e];
+      }
+      ranked[p].fitness /= games;
+      mean += ranked[p].fitness;
+    }
+    qsort(ranked, population, sizeof(Ranked), compare_ranked);
+
+    if (out && !policy_save(&pop[ranked[0].index], out)) {
+      fprintf(stderr, "cannot save the policy to %s\n", out);
+      return 1;
+    }
+
+    fprintf(stderr, "gen %4zu:  best %.2f, median %.2f, mean %.2f fitness, %.3f s\n",
+	    g, ranked[0].fitness, ranked[population / 2].fitness, mean / population, now_seconds() - gen_start);
+
+    next_generation(pop, ranked, population, next, &rng);
+    Policy *swap = pop;
+    pop = next;
+    next = swap;
+  }
+
+  double elapsed = now_seconds() - start_time;
+  fprintf(stderr, "games:     %zu policies, %zu games each, up to %zu moves\n", population, games, moves);
+  fprintf(stderr, "threads:   %ld\n", threads);
+  fprintf(stderr, "elapsed:   %.3f s, %.2f M moves/s\n", elapsed, steps / elapsed / 1e6);
+  fprintf(stderr, "rate:      %.1f generations per minute\n", generations * 60 / elapsed);
+
+  free(ids);
+  free(workers);
+  free(fitness);
+  free(hungry);
+  free(over);
+  free(actions);
+  batch_destroy(b);
+  free(ranked);
+  free(next);
+  free(pop);
+
+  return 0;
+}
@@ -0,0 +1,319 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/wire.h"
+
+// -------------------
+// BUFFER
+
+static int buffer_reserve(Buffer *buf, size_t n) {
+  if (buf->error) {
+    return 0;
+  }
+  if (buf->len + n <= buf->cap) {
+    return 1;
+  }
+
+  size_t cap = buf->cap ? buf->cap : 256;
+  while (cap < buf->len + n) {
+    cap *= 2;
+  }
+
+  uint8_t *data = realloc(buf->data, cap);
+  if (!data) {
+    buf->error = 1;
+    return 0;
+  }
+  buf->data = data;
+  buf->cap = cap;
+  return 1;
+}
+
+void buffer_put_byte(Buffer *buf, uint8_t byte) {
+  if (buffer_reserve(buf, 1)) {
+    buf->data[buf->len++] = byte;
+  }
+}
+
+void buffer_put_bytes(Buffer *buf, const void *data, size_t n) {
+  if (buffer_reserve(buf, n)) {
+    memcpy(buf->data + buf->len, data, n);
+    buf->len += n;
+  }
+}
+
+void buffer_put_varint(Buffer *buf, uint64_t value) {
+  if (!buffer_reserve(buf, 10)) {
+    return;
+  }
+  while (value >= 0x80) {
+    buf->data[buf->len++] = (uint8_t) (value | 0x80);
+    value >>= 7;
+  }
+  buf->data[buf->len++] = (uint8_t) value;
+}
+
+void buffer_put_u64(Buffer *buf, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    buffer_put_byte(buf, (uint8_t) (value >> (8 * i)));
+  }
+}
+
+void buffer_consume(Buffer *buf, size_t n) {
+  memmove(buf->data, buf->data + n, buf->len - n);
+  buf->len -= n;
+}
+
+void buffer_free(Buffer *buf) {
+  free(buf->data);
+  memset(buf, 0, sizeof(*buf));
+}
+
+// -------------------
+// READER
+
+uint8_t reader_byte(Reader *r) {
+  if (r->pos >= r->end) {
+    r->error = 1;
+    return 0;
+  }
+  return *r->pos++;
+}
+
+uint64_t reader_varint(Reader *r) {
+  uint64_t value = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte = reader_byte(r);
+    value |= (uint64_t) (byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+
+  r->error = 1;
+  return 0;
+}
+
+uint64_t reader_u64(Reader *r) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) {
+    value |= (uint64_t) reader_byte(r) << (8 * i);
+  }
+  return value;
+}
+
+// -------------------
+// MESSAGES
+
+long wire_message_size(const uint8_t *data, size_t len) {
+  if (len < WIRE_HEADER) {
+    return 0;
+  }
+
+  uint32_t size = data[0] | data[1] << 8 | data[2] << 16 | (uint32_t) data[3] << 24;
+  if (size == 0 || size > WIRE_MAX_MESSAGE) {
+    return -1;
+  }
+  return len >= WIRE_HEADER + size ? WIRE_HEADER + (long) size : 0;
+}
+
+// Starts a message, its length is written by end_message().
+static size_t begin_message(Buffer *buf, uint8_t type) {
+  size_t start = buf->len;
+  for (int i = 0; i < WIRE_HEADER; i++) {
+    buffer_put_byte(buf, 0);
+  }
+  buffer_put_byte(buf, type);
+  return start;
+}
+
+static void end_message(Buffer *buf, size_t start) {
+  if (buf->error) {
+    return;
+  }
+
+  uint32_t size = (uint32_t) (buf->len - start - WIRE_HEADER);
+  for (int i = 0; i < WIRE_HEADER; i++) {
+    buf->data[start + i] = (uint8_t) (size >> (8 * i));
+  }
+}
+
+void wire_hello(Buffer *buf, const Arena *arena, int snake) {
+  size_t start = begin_message(buf, WIRE_HELLO);
+  buffer_put_varint(buf, arena->width);
+  buffer_put_varint(buf, arena->height);
+  buffer_put_varint(buf, arena->count);
+  buffer_put_varint(buf, snake + 1);
+  end_message(buf, start);
+}
+
+void wire_keyframe(Buffer *buf, const Arena *arena) {
+  size_t start = begin_message(buf, WIRE_KEYFRAME);
+  buffer_put_varint(buf, arena->tick);
+  buffer_put_u64(buf, arena->hash);
+
+  int c = 0;
+  while (c < arena->cells) {
+    uint32_t value = arena->grid[c];
+    int run = 1;
+    while (c + run < arena->cells && arena->grid[c + run] == value) {
+      run++;
+    }
+    buffer_put_varint(buf, value);
+    buffer_put_varint(buf, run);
+    c += run;
+  }
+
+  end_message(buf, start);
+}
+
+/*
+  Sorts cell indices, which are below ARENA_MAX_SIDE^2 = 2^24, with two
+  passes of a radix sort on 12 bits each. Falls back to qsort() if
+  there is no memory for the copy.
+*/
+#define RADIX_BITS 12
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+static int compare_ints(const void *a, const void *b) {
+  int x = *(const int *) a;
+  int y = *(const int *) b;
+  return (x > y) - (x < y);
+}
+
+static void sort_cells(int *cells, int n) {
+  int *tmp = malloc((n > 0 ? n : 1) * sizeof(int));
+  if (!tmp) {
+    qsort(cells, n, sizeof(int), compare_ints);
+    return;
+  }
+
+  int counts[RADIX_SIZE];
+  int *from = cells;
+  int *to = tmp;
+
+  for (int shift = 0; shift < 2 * RADIX_BITS; shift += RADIX_BITS) {
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < n; i++) {
+      counts[(from[i] >> shift) & (RADIX_SIZE - 1)] += 1;
+    }
+    int sum = 0;
+    for (int k = 0; k < RADIX_SIZE; k++) {
+      int count = counts[k];
+      counts[k] = sum;
+      sum += count;
+    }
+    for (int i = 0; i < n; i++) {
+      to[counts[(from[i] >> shift) & (RADIX_SIZE - 1)]++] = from[i];
+    }
+    int *swap = from;
+    from = to;
+    to = swap;
+  }
+
+  // an even number of passes, so the result is back in cells
+  free(tmp);
+}
+
+void wire_delta(Buffer *buf, Arena *arena) {
+  sort_cells(arena->changed, arena->changed_count);
+
+  size_t start = begin_message(buf, WIRE_DELTA);
+  buffer_put_varint(buf, arena->tick);
+  buffer_put_u64(buf, arena->hash);
+  buffer_put_varint(buf, arena->changed_count);
+
+  int prev = 0;
+  for (int i = 0; i < arena->changed_count; i++) {
+    int c = arena->changed[i];
+    buffer_put_varint(buf, c - prev);
+    buffer_put_varint(buf, arena->grid[c]);
+    prev = c;
+  }
+
+  end_message(buf, start);
+}
+
+// -------------------
+// CLIENT
+
+static void grid_set(WireGrid *wg, int cell, uint32_t value) {
+  wg->hash ^= arena_cell_hash(cell, wg->grid[cell]) ^ arena_cell_hash(cell, value);
+  wg->grid[cell] = value;
+}
+
+int wire_apply(WireGrid *wg, const uint8_t *msg, size_t len) {
+  Reader r = {msg + WIRE_HEADER, msg + len, 0};
+  int type = reader_byte(&r);
+
+  switch (type) {
+  case WIRE_HELLO: {
+    int width = (int) reader_varint(&r);
+    int height = (int) reader_varint(&r);
+    int snakes = (int) reader_varint(&r);
+    int snake = (int) reader_varint(&r) - 1;
+    if (r.error || width < 1 || height < 1 || width > ARENA_MAX_SIDE || height > ARENA_MAX_SIDE) {
+      return -1;
+    }
+
+    wire_grid_free(wg);
+    wg->width = width;
+    wg->height = height;
+    wg->cells = width * height;
+    wg->snakes = snakes;
+    wg->snake = snake;
+    wg->grid = calloc(wg->cells, sizeof(uint32_t));
+    return wg->grid ? type : -1;
+  }
+
+  case WIRE_KEYFRAME: {
+    if (!wg->grid) {
+      return -1;
+    }
+    wg->tick = (uint32_t) reader_varint(&r);
+    wg->expected = reader_u64(&r);
+
+    int c = 0;
+    while (c < wg->cells && !r.error) {
+      uint32_t value = (uint32_t) reader_varint(&r);
+      uint64_t run = reader_varint(&r);
+      if (run == 0 || run > (uint64_t) (wg->cells - c)) {
+	return -1;
+      }
+      for (uint64_t i = 0; i < run; i++) {
+	grid_set(wg, c++, value);
+      }
+    }
+    return r.error || c != wg->cells ? -1 : type;
+  }
+
+  case WIRE_DELTA: {
+    if (!wg->grid) {
+      return -1;
+    }
+    wg->tick = (uint32_t) reader_varint(&r);
+    wg->expected = reader_u64(&r);
+    uint64_t count = reader_varint(&r);
+
+    uint64_t c = 0;
+    for (uint64_t i = 0; i < count && !r.error; i++) {
+      c += reader_varint(&r);
+      uint32_t value = (uint32_t) reader_varint(&r);
+      if (c >= (uint64_t) wg->cells) {
+	return -1;
+      }
+      grid_set(wg, (int) c, value);
+    }
+    return r.error ? -1 : type;
+  }
+
+  default:
+    return -1;
+  }
+}
+
+void wire_grid_free(WireGrid *wg) {
+  free(wg->grid);
+  memset(wg, 0, sizeof(*wg));
+}
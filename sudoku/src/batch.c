@@ -0,0 +1,299 @@
+/*
+  Headless batch solver.
+
+  Usage:
+
+    ./sudoku_batch [-j threads] [-e bitmask|dlx] [-o output] puzzles
+
+  The input is any 9x9 puzzle file understood by the loader (see
+  loader.h): one 81-character puzzle per line, the rows,cols,count
+  multi-puzzle format, or one or more boards in the rows,cols + CSV
+  format of the game.
+
+  Solutions are written in input order, one 81-character line per
+  puzzle. Puzzles without a solution are written as a line of dots.
+
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./include/solver.h"
+#include "./include/dlx.h"
+#include "./include/pool.h"
+#include "./include/loader.h"
+#include "./include/timing.h"
+
+#define CHUNK_PUZZLES 1024
+#define CHUNKS_PER_THREAD 4   // chunks in flight per worker
+#define LINE_SIZE (SOLVER_CELLS + 1)
+
+// latency histogram: 64 power-of-two ranges of ns, each split in 16
+#define HIST_SUB_BITS 4
+#define HIST_BUCKETS (64 << HIST_SUB_BITS)
+
+typedef struct Batch Batch;
+
+typedef struct {
+  Batch *batch;
+  size_t first;
+  size_t count;
+  char *out;
+  atomic_int done;
+} Chunk;
+
+typedef struct {
+  Dlx *dlx;
+  uint64_t hist[HIST_BUCKETS];
+  SolverStats stats;
+  size_t unsolved;
+  size_t malformed;
+} WorkerState;
+
+struct Batch {
+  Loader input;
+  int use_dlx;
+
+  Chunk *chunks;      // reorder buffer, chunk k goes in slot k % window
+  size_t window;
+  pthread_mutex_t lock;
+  pthread_cond_t chunk_done;
+
+  WorkerState *workers;
+};
+
+// ----------------------------------------
+
+size_t hist_bucket(uint64_t ns) {
+  if (ns < (1 << HIST_SUB_BITS)) {
+    return ns;
+  }
+  int log = 63 - __builtin_clzll(ns);
+  size_t sub = (ns >> (log - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1);
+  return ((log - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + sub;
+}
+
+// upper bound, in ns, of the values that fall in bucket b
+uint64_t hist_value(size_t b) {
+  if (b < (1 << HIST_SUB_BITS)) {
+    return b;
+  }
+  int log = (b >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+  uint64_t sub = b & ((1 << HIST_SUB_BITS) - 1);
+  return ((1ULL << HIST_SUB_BITS) + sub + 1) << (log - HIST_SUB_BITS);
+}
+
+uint64_t hist_percentile(const uint64_t *hist, uint64_t total, double p) {
+  uint64_t target = (uint64_t) (p * total);
+  if (target >= total) {
+    target = total - 1;
+  }
+  uint64_t seen = 0;
+  for (size_t b = 0; b < HIST_BUCKETS; b++) {
+    seen += hist[b];
+    if (seen > target) {
+      return hist_value(b);
+    }
+  }
+  return hist_value(HIST_BUCKETS - 1);
+}
+
+// ----------------------------------------
+// SOLVING
+
+void solve_chunk(void *arg, size_t worker) {
+  Chunk *c = arg;
+  Batch *b = c->batch;
+
+  WorkerState *w = &b->workers[worker];
+  if (b->use_dlx && !w->dlx) {
+    w->dlx = dlx_create();
+  }
+
+  for (size_t i = 0; i < c->count; i++) {
+    uint8_t cells[SOLVER_CELLS];
+    uint8_t solution[SOLVER_CELLS];
+    char *line = c->out + i * LINE_SIZE;
+
+    size_t found = 0;
+
+    // malformed puzzles are written as without solution
+    if (loader_puzzle(&b->input, c->first + i, cells)) {
+      uint64_t start = now_ns();
+      found = b->use_dlx
+	? dlx_count(w->dlx, cells, 1, solution, &w->stats)
+	: solver_count(cells, 1, solution, &w->stats);
+      w->hist[hist_bucket(now_ns() - start)] += 1;
+    } else {
+      w->malformed += 1;
+    }
+
+    if (found) {
+      for (size_t k = 0; k < SOLVER_CELLS; k++) {
+	line[k] = '0' + solution[k];
+      }
+    } else {
+      memset(line, '.', SOLVER_CELLS);
+      w->unsolved += 1;
+    }
+    line[SOLVER_CELLS] = '\n';
+  }
+
+  pthread_mutex_lock(&b->lock);
+  atomic_store(&c->done, 1);
+  pthread_cond_broadcast(&b->chunk_done);
+  pthread_mutex_unlock(&b->lock);
+}
+
+void submit_chunk(Batch *b, Pool *p, size_t k) {
+  Chunk *c = &b->chunks[k % b->window];
+  c->first = k * CHUNK_PUZZLES;
+  c->count = b->input.count - c->first < CHUNK_PUZZLES ? b->input.count - c->first : CHUNK_PUZZLES;
+  c->batch = b;
+  atomic_store(&c->done, 0);
+  pool_submit(p, solve_chunk, c);
+}
+
+// ----------------------------------------
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-j threads] [-e bitmask|dlx] [-o output] puzzles\n", program);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  size_t threads = pool_default_threads();
+  const char *output = NULL;
+  int use_dlx = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:e:o:")) != -1) {
+    switch (opt) {
+    case 'j': threads = strtoul(optarg, NULL, 10); break;
+    case 'o': output = optarg; break;
+    case 'e':
+      if (strcmp(optarg, "dlx") == 0) {
+	use_dlx = 1;
+      } else if (strcmp(optarg, "bitmask") != 0) {
+	usage(argv[0]);
+      }
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (optind >= argc) {
+    usage(argv[0]);
+  }
+
+  FILE *out = output ? fopen(output, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "ERROR: could not open file %s: %s\n", output, strerror(errno));
+    exit(1);
+  }
+
+  Batch b = { 0 };
+  b.use_dlx = use_dlx;
+  loader_open(&b.input, argv[optind]);
+
+  if (b.input.rows != SOLVER_SIZE || b.input.cols != SOLVER_SIZE) {
+    fprintf(stderr, "ERROR: only %dx%d puzzles are supported\n", SOLVER_SIZE, SOLVER_SIZE);
+    exit(1);
+  }
+
+  Pool *pool = pool_create(threads);
+  b.workers = calloc(pool->count, sizeof(WorkerState));
+  b.window = pool->count * CHUNKS_PER_THREAD;
+  b.chunks = calloc(b.window, sizeof(Chunk));
+  for (size_t i = 0; i < b.window; i++) {
+    b.chunks[i].out = malloc(CHUNK_PUZZLES * LINE_SIZE);
+  }
+  pthread_mutex_init(&b.lock, NULL);
+  pthread_cond_init(&b.chunk_done, NULL);
+
+  size_t chunks = (b.input.count + CHUNK_PUZZLES - 1) / CHUNK_PUZZLES;
+  size_t submitted = 0;
+  double start = now_seconds();
+
+  while (submitted < chunks && submitted < b.window) {
+    submit_chunk(&b, pool, submitted++);
+  }
+
+  // write the chunks in order, refilling the window as they go out
+  for (size_t k = 0; k < chunks; k++) {
+    Chunk *c = &b.chunks[k % b.window];
+
+    pthread_mutex_lock(&b.lock);
+    while (!atomic_load(&c->done)) {
+      pthread_cond_wait(&b.chunk_done, &b.lock);
+    }
+    pthread_mutex_unlock(&b.lock);
+
+    fwrite(c->out, LINE_SIZE, c->count, out);
+
+    if (submitted < chunks) {
+      submit_chunk(&b, pool, submitted++);
+    }
+  }
+
+  fflush(out);
+  double elapsed = now_seconds() - start;
+
+  pool_wait(pool);
+
+  // merge the per-worker statistics
+  uint64_t hist[HIST_BUCKETS] = { 0 };
+  SolverStats stats = { 0 };
+  size_t unsolved = 0, malformed = 0;
+  for (size_t i = 0; i < pool->count; i++) {
+    WorkerState *w = &b.workers[i];
+    for (size_t k = 0; k < HIST_BUCKETS; k++) {
+      hist[k] += w->hist[k];
+    }
+    stats.guesses += w->stats.guesses;
+    unsolved += w->unsolved;
+    malformed += w->malformed;
+    if (w->dlx) {
+      dlx_destroy(w->dlx);
+    }
+  }
+
+  size_t n = b.input.count;
+  fprintf(stderr, "puzzles:   %zu (%zu without solution, %zu malformed)\n", n, unsolved - malformed, malformed);
+  fprintf(stderr, "threads:   %zu\n", pool->count);
+  fprintf(stderr, "engine:    %s\n", use_dlx ? "dlx" : "bitmask");
+  fprintf(stderr, "elapsed:   %.3f s\n", elapsed);
+  fprintf(stderr, "rate:      %.0f puzzles/s (%.0f puzzles/s per thread)\n",
+	  n / elapsed, n / elapsed / pool->count);
+  fprintf(stderr, "guesses:   %.2f per puzzle\n", n ? (double) stats.guesses / n : 0.0);
+  // every puzzle but the malformed ones is in the histogram, with or
+  // without a solution
+  size_t timed = n - malformed;
+  if (timed) {
+    fprintf(stderr, "latency:   p50 %.1f us, p90 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+	    hist_percentile(hist, timed, 0.50) / 1e3, hist_percentile(hist, timed, 0.90) / 1e3,
+	    hist_percentile(hist, timed, 0.99) / 1e3, hist_percentile(hist, timed, 0.999) / 1e3,
+	    hist_percentile(hist, timed, 1.0) / 1e3);
+  }
+
+  pool_destroy(pool);
+
+  for (size_t i = 0; i < b.window; i++) {
+    free(b.chunks[i].out);
+  }
+  free(b.chunks);
+  free(b.workers);
+  loader_close(&b.input);
+  if (output) {
+    fclose(out);
+  }
+
+  return 0;
+}
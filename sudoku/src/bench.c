@@ -0,0 +1,482 @@
+/*
+  Benchmark suite for the solvers: runs the bitmask solver (with both
+  propagation paths) and the dancing links solver on a set of puzzle
+  corpora, and measures the propagation kernels alone.
+
+  Usage:
+
+    ./sudoku_bench [-t seconds] [-o results.json] [-b baseline.json] [-r percent] [corpora...]
+
+  Without corpora it runs on the bundled ones, data/easy.txt,
+  data/hard.txt, data/17clue.txt and data/16x16.txt. Any file
+  understood by the loader (see loader.h) works; grids other than
+  9x9 only run on the plain bitmask solver.
+
+  For each corpus, solver and limit it reports the median and the
+  99th percentile of the time per puzzle, the guesses per puzzle and
+  the overall puzzles/s. -o writes the same results as JSON, and -b
+  compares them with a JSON written by an earlier run, failing if any
+  median got slower by more than -r percent (default 25), or if any
+  solver makes more guesses than it did.
+
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "./include/solver.h"
+#include "./include/dlx.h"
+#include "./include/propagate.h"
+#include "./include/loader.h"
+#include "./include/timing.h"
+
+#define MAX_PUZZLES 100000
+#define MAX_RESULTS 256
+
+// each solver runs on the whole corpus for at least this long, unless
+// overridden with -t, split in BENCH_RUNS runs
+#define MIN_BENCH_TIME 1.0
+
+// the solvers and the corpora take turns, one run each, so that a
+// slow moment of the machine only slows down one run of a solver and
+// not all of them
+#define BENCH_RUNS 5
+
+// and each run solves the corpus at least this many times, for the
+// corpora where a single round takes longer than a run
+#define MIN_RUN_ROUNDS 3
+
+// what one run to the next differs by, on a quiet machine, is well
+// below this
+#define DEFAULT_TOLERANCE 25.0
+
+const char *DEFAULT_CORPORA[] = {
+  "./data/easy.txt",
+  "./data/hard.txt",
+  "./data/17clue.txt",
+  "./data/16x16.txt",
+};
+
+typedef enum {
+  ENGINE_BITMASK = 0,
+  ENGINE_BITMASK_KERNEL,
+  ENGINE_DLX,
+  ENGINE_COUNT,
+} Engine;
+
+const char *ENGINE_NAMES[ENGINE_COUNT] = { "bitmask", "bitmask+kernel", "dlx" };
+
+typedef struct {
+  char name[64];      // file name without directory and extension
+  size_t box;
+  size_t cells;
+  size_t count;
+  uint8_t *puzzles;   // one grid after the other
+  size_t *solutions[2][ENGINE_COUNT];  // of each puzzle, by limit and engine
+} Corpus;
+
+typedef struct {
+  char corpus[64];
+  Engine engine;
+  size_t limit;
+  size_t puzzles;
+  double median_us;
+  double p99_us;
+  double guesses;     // per puzzle
+  double rate;        // puzzles per second
+} Result;
+
+// ----------------------------------------
+
+void load_corpus(Corpus *c, const char *path) {
+  Loader l;
+  loader_open(&l, path);
+
+  c->box = 0;
+  for (size_t b = 2; b <= SOLVER_MAX_BOX; b++) {
+    if (l.rows == l.cols && l.rows == b * b) {
+      c->box = b;
+    }
+  }
+
+  if (!c->box) {
+    fprintf(stderr, "ERROR: %s: %zux%zu grids have no boxes\n", path, l.rows, l.cols);
+    exit(1);
+  }
+
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  snprintf(c->name, sizeof(c->name), "%.*s", (int) strcspn(base, "."), base);
+
+  c->cells = l.rows * l.cols;
+  c->puzzles = malloc((l.count < MAX_PUZZLES ? l.count : MAX_PUZZLES) * c->cells);
+  c->count = 0;
+
+  for (size_t i = 0; i < l.count && c->count < MAX_PUZZLES; i++) {
+    c->count += loader_puzzle(&l, i, c->puzzles + c->count * c->cells);
+  }
+
+  loader_close(&l);
+
+  if (!c->count) {
+    fprintf(stderr, "ERROR: no puzzles found in %s\n", path);
+    exit(1);
+  }
+
+  for (size_t e = 0; e < ENGINE_COUNT; e++) {
+    c->solutions[0][e] = calloc(c->count, sizeof(size_t));
+    c->solutions[1][e] = calloc(c->count, sizeof(size_t));
+  }
+}
+
+void free_corpus(Corpus *c) {
+  for (size_t e = 0; e < ENGINE_COUNT; e++) {
+    free(c->solutions[0][e]);
+    free(c->solutions[1][e]);
+  }
+  free(c->puzzles);
+}
+
+size_t run_engine(Engine e, Dlx *d, size_t box, const uint8_t *cells, size_t limit, SolverStats *stats) {
+  switch(e) {
+  case ENGINE_BITMASK:
+  case ENGINE_BITMASK_KERNEL:
+    return solver_count_box(box, cells, limit, NULL, stats);
+  case ENGINE_DLX:     return dlx_count(d, cells, limit, NULL, stats);
+  default:
+    fprintf(stderr, "ERROR: unknown engine %d\n", e);
+    exit(1);
+  }
+}
+
+int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *) a;
+  double y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+// Solves the whole corpus with the given engine, repeating it until
+// min_time has passed, and at least MIN_RUN_ROUNDS times. Each puzzle
+// is timed on its own, and its time is the best of all rounds.
+Result bench_engine(Engine e, Dlx *d, const Corpus *c, size_t limit, double min_time, size_t *solutions) {
+  SolverStats stats = { 0 };
+  size_t rounds = 0;
+  double *best = malloc(c->count * sizeof(double));
+
+  for (size_t i = 0; i < c->count; i++) {
+    best[i] = INFINITY;
+  }
+
+  solver_set_propagation(e == ENGINE_BITMASK_KERNEL ? SOLVER_PROP_KERNEL : SOLVER_PROP_LOOP);
+
+  double start = now_seconds();
+  double elapsed = 0;
+
+  do {
+    for (size_t i = 0; i < c->count; i++) {
+      double t = now_seconds();
+      size_t found = run_engine(e, d, c->box, c->puzzles + i * c->cells, limit, &stats);
+      t = now_seconds() - t;
+
+      if (t < best[i]) {
+	best[i] = t;
+      }
+      if (rounds == 0) {
+	solutions[i] = found;
+      }
+    }
+    rounds += 1;
+    elapsed = now_seconds() - start;
+  } while (elapsed < min_time || rounds < MIN_RUN_ROUNDS);
+
+  qsort(best, c->count, sizeof(double), compare_doubles);
+
+  double solved = (double) rounds * c->count;
+  Result r = { 0 };
+  snprintf(r.corpus, sizeof(r.corpus), "%s", c->name);
+  r.engine = e;
+  r.limit = limit;
+  r.puzzles = c->count;
+  r.median_us = best[c->count / 2] * 1e6;
+  r.p99_us = best[(size_t) ceil(c->count * 0.99) - 1] * 1e6;
+  r.guesses = stats.guesses / solved;
+  r.rate = solved / elapsed;
+
+  free(best);
+  return r;
+}
+
+// Keeps the best of two runs of the same engine. The guesses do not
+// change from run to run.
+void merge_runs(Result *best, const Result *r) {
+  best->median_us = r->median_us < best->median_us ? r->median_us : best->median_us;
+  best->p99_us = r->p99_us < best->p99_us ? r->p99_us : best->p99_us;
+  best->rate = r->rate > best->rate ? r->rate : best->rate;
+}
+
+// Runs each propagation kernel to a fixed point on the starting
+// candidates of every puzzle.
+void bench_propagation(const Corpus *c, double min_time) {
+  CandGrid *start = aligned_alloc(32, c->count * sizeof(CandGrid));
+  for (size_t i = 0; i < c->count; i++) {
+    prop_load(&start[i], c->puzzles + i * c->cells);
+  }
+
+  printf("\npropagation to fixed point (best on this cpu: %s)\n", PROP_IMPL_NAMES[prop_best_impl()]);
+
+  for (int impl = 0; impl < PROP_IMPL_COUNT; impl++) {
+    if (!prop_supported(impl)) {
+      printf("  %-14s not supported\n", PROP_IMPL_NAMES[impl]);
+      continue;
+    }
+
+    PropRoundFn round = prop_round_fn(impl);
+    uint64_t rounds = 0;
+    size_t runs = 0;
+    double begin = now_seconds();
+    double elapsed = 0;
+
+    do {
+      for (size_t i = 0; i < c->count; i++) {
+	CandGrid g = start[i];
+	int r = prop_fixpoint_with(round, &g);
+	rounds += r < 0 ? 1 : r;
+      }
+      runs += c->count;
+      elapsed = now_seconds() - begin;
+    } while (elapsed < min_time);
+
+    printf("  %-14s %10.1f ns/round %12.0f rounds/s %10.2f rounds/puzzle\n",
+	   PROP_IMPL_NAMES[impl], elapsed / rounds * 1e9, rounds / elapsed, (double) rounds / runs);
+  }
+
+  free(start);
+}
+
+size_t corpus_engines(const Corpus *c) {
+  return c->box == SOLVER_BOX ? ENGINE_COUNT : 1;
+}
+
+// One run of every engine that supports the corpus, with both limits:
+// 1 is plain solving, 2 is what uniqueness checks need. Each result
+// keeps the best of the runs so far.
+void run_corpus(Corpus *c, Dlx *d, double min_time, Result *results, int run) {
+  size_t engines = corpus_engines(c);
+
+  for (size_t limit = 1; limit <= 2; limit++) {
+    for (size_t e = 0; e < engines; e++) {
+      Result *best = &results[(limit - 1) * engines + e];
+      Result r = bench_engine(e, d, c, limit, min_time, c->solutions[limit - 1][e]);
+      if (run == 0) {
+	*best = r;
+      } else {
+	merge_runs(best, &r);
+      }
+    }
+  }
+}
+
+// Prints the results of a corpus, after checking that every engine
+// found as many solutions as the plain bitmask one. Returns the number
+// of results.
+size_t report_corpus(const Corpus *c, const Result *results, double min_time) {
+  size_t added = 0;
+  size_t engines = corpus_engines(c);
+
+  printf("%s: %zu %zux%zu puzzles\n", c->name, c->count, c->box * c->box, c->box * c->box);
+
+  for (size_t limit = 1; limit <= 2; limit++) {
+    size_t *const *solutions = c->solutions[limit - 1];
+
+    printf("\n%s (limit %zu)\n", limit == 1 ? "solve" : "uniqueness", limit);
+    printf("  %-14s %14s %14s\n", "", "median", "p99");
+
+    for (size_t e = 0; e < engines; e++) {
+      const Result *r = &results[added++];
+      printf("  %-14s %11.2f us %11.2f us %12.0f puzzles/s %10.2f guesses/puzzle\n",
+	     ENGINE_NAMES[e], r->median_us, r->p99_us, r->rate, r->guesses);
+    }
+
+    for (size_t e = 1; e < engines; e++) {
+      for (size_t i = 0; i < c->count; i++) {
+	if (solutions[0][i] != solutions[e][i]) {
+	  fprintf(stderr, "ERROR: %s and %s disagree on puzzle %zu of %s (%zu vs %zu solutions)\n",
+		  ENGINE_NAMES[0], ENGINE_NAMES[e], i, c->name, solutions[0][i], solutions[e][i]);
+	  exit(1);
+	}
+      }
+    }
+  }
+
+  if (c->box == SOLVER_BOX) {
+    bench_propagation(c, min_time);
+  }
+  printf("\n");
+
+  return added;
+}
+
+// ----------------------------------------
+
+// One result per line, so that read_baseline() can parse it back
+// without a JSON library.
+void write_json(const char *path, const Result *results, size_t count) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    fprintf(stderr, "ERROR: could not open %s\n", path);
+    exit(1);
+  }
+
+  fprintf(f, "{\n  \"propagation\": \"%s\",\n  \"results\": [\n", PROP_IMPL_NAMES[prop_best_impl()]);
+  for (size_t i = 0; i < count; i++) {
+    const Result *r = &results[i];
+    fprintf(f, "    {\"corpus\": \"%s\", \"engine\": \"%s\", \"limit\": %zu, \"puzzles\": %zu, "
+	    "\"median_us\": %.3f, \"p99_us\": %.3f, \"guesses\": %.3f, \"puzzles_per_s\": %.1f}%s\n",
+	    r->corpus, ENGINE_NAMES[r->engine], r->limit, r->puzzles,
+	    r->median_us, r->p99_us, r->guesses, r->rate, i + 1 < count ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+
+  fclose(f);
+}
+
+// Compares the medians with the ones in a JSON file written by
+// write_json(), and the guesses, which do not depend on the machine
+// and have to be the same up to the 3 decimals written. Results
+// missing from either side are skipped. Returns the number of medians
+// slower beyond the tolerance plus the number of results with more
+// guesses.
+size_t compare_baseline(const char *path, const Result *results, size_t count, double tolerance) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "ERROR: could not open %s\n", path);
+    exit(1);
+  }
+
+  size_t regressions = 0;
+  char line[512];
+
+  printf("against %s (tolerance %.1f%%)\n\n", path, tolerance);
+
+  while (fgets(line, sizeof(line), f)) {
+    char corpus[64], engine[32];
+    size_t limit;
+    double median, guesses;
+
+    if (sscanf(line, " {\"corpus\": \"%63[^\"]\", \"engine\": \"%31[^\"]\", \"limit\": %zu, \"puzzles\": %*u, "
+	       "\"median_us\": %lf, \"p99_us\": %*f, \"guesses\": %lf", corpus, engine, &limit, &median, &guesses) != 5) {
+      continue;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      const Result *r = &results[i];
+      if (strcmp(r->corpus, corpus) || strcmp(ENGINE_NAMES[r->engine], engine) || r->limit != limit) {
+	continue;
+      }
+
+      double change = (r->median_us / median - 1) * 100;
+      int regressed = change > tolerance;
+      regressions += regressed;
+
+      printf("  %-10s %-14s limit %zu %10.2f us -> %10.2f us %+7.1f%%%s\n", corpus, engine, limit,
+	     median, r->median_us, change, regressed ? "  REGRESSION" : "");
+
+      // compared as written to the file, so that rounding does not count
+      double written = round(r->guesses * 1000) / 1000;
+      if (written != round(guesses * 1000) / 1000) {
+	int more = written > guesses;
+	regressions += more;
+	printf("  %-10s %-14s limit %zu %10.3f guesses/puzzle -> %10.3f%s\n", corpus, engine, limit,
+	       guesses, written, more ? "  REGRESSION" : "");
+      }
+    }
+  }
+
+  fclose(f);
+  return regressions;
+}
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-t seconds] [-o results.json] [-b baseline.json] [-r percent] [corpora...]\n", program);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  double min_time = MIN_BENCH_TIME;
+  double tolerance = DEFAULT_TOLERANCE;
+  const char *output = NULL;
+  const char *baseline = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:o:b:r:")) != -1) {
+    switch (opt) {
+    case 't': min_time = strtod(optarg, NULL); break;
+    case 'o': output = optarg; break;
+    case 'b': baseline = optarg; break;
+    case 'r': tolerance = strtod(optarg, NULL); break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  const char **paths = (const char **) argv + optind;
+  size_t corpora = argc - optind;
+  if (!corpora) {
+    paths = DEFAULT_CORPORA;
+    corpora = sizeof(DEFAULT_CORPORA) / sizeof(DEFAULT_CORPORA[0]);
+  }
+
+  Dlx *d = dlx_create();
+  Result *results = malloc(MAX_RESULTS * sizeof(Result));
+  size_t count = 0;
+
+  Corpus *c = malloc(corpora * sizeof(Corpus));
+  size_t *first = malloc(corpora * sizeof(size_t));
+
+  if (corpora * 2 * ENGINE_COUNT > MAX_RESULTS) {
+    fprintf(stderr, "ERROR: too many corpora, at most %d results\n", MAX_RESULTS);
+    exit(1);
+  }
+  for (size_t i = 0; i < corpora; i++) {
+    load_corpus(&c[i], paths[i]);
+    first[i] = i ? first[i - 1] + 2 * corpus_engines(&c[i - 1]) : 0;
+  }
+
+  // the runs go around all of the corpora, so that the runs of each
+  // result are spread over the whole benchmark
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    for (size_t i = 0; i < corpora; i++) {
+      run_corpus(&c[i], d, min_time / BENCH_RUNS, results + first[i], run);
+    }
+  }
+
+  for (size_t i = 0; i < corpora; i++) {
+    count += report_corpus(&c[i], results + count, min_time);
+    free_corpus(&c[i]);
+  }
+  free(first);
+  free(c);
+
+  if (output) {
+    write_json(output, results, count);
+  }
+
+  size_t regressions = 0;
+  if (baseline) {
+    regressions = compare_baseline(baseline, results, count, tolerance);
+    if (regressions) {
+      fprintf(stderr, "ERROR: %zu results regressed, by more than %.1f%% or in guesses\n", regressions, tolerance);
+    }
+  }
+
+  free(results);
+  dlx_destroy(d);
+
+  return regressions ? 1 : 0;
+}
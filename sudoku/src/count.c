@@ -0,0 +1,168 @@
+/*
+  Parallel solution counter.
+
+  Usage:
+
+    ./sudoku_count [-j threads] [-l limit] [-s] puzzles
+
+  Counts the solutions of every puzzle of the file (any format and size
+  understood by the loader, see loader.h), stopping at `limit` of them
+  (default 2, enough to prove uniqueness, 0 to count them all).
+
+  With -s the whole file is counted once sequentially and then with 1,
+  2, 4, ... up to `threads` threads, reporting the speedup of each.
+
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./include/solver.h"
+#include "./include/pool.h"
+#include "./include/parallel.h"
+#include "./include/loader.h"
+#include "./include/timing.h"
+
+typedef struct {
+  size_t box;
+  size_t cells;
+  size_t count;
+  uint8_t *puzzles;   // one grid after the other
+} Puzzles;
+
+// ----------------------------------------
+
+void load_puzzles(Puzzles *p, const char *path) {
+  Loader l;
+  loader_open(&l, path);
+
+  p->box = 0;
+  for (size_t b = 2; b <= SOLVER_MAX_BOX; b++) {
+    if (l.rows == l.cols && l.rows == b * b) {
+      p->box = b;
+    }
+  }
+
+  if (!p->box) {
+    fprintf(stderr, "ERROR: %zux%zu grids have no boxes\n", l.rows, l.cols);
+    exit(1);
+  }
+
+  p->cells = l.rows * l.cols;
+  p->puzzles = malloc(l.count * p->cells);
+  p->count = 0;
+
+  for (size_t i = 0; i < l.count; i++) {
+    if (loader_puzzle(&l, i, p->puzzles + p->count * p->cells)) {
+      p->count += 1;
+    } else {
+      fprintf(stderr, "WARNING: skipping malformed puzzle %zu\n", i);
+    }
+  }
+
+  loader_close(&l);
+}
+
+// Counts every puzzle, sequentially if pool is NULL. Returns the
+// elapsed time, and the counts in `found`.
+double count_all(const Puzzles *p, Pool *pool, size_t limit, size_t *found, SolverStats *stats) {
+  double start = now_seconds();
+
+  for (size_t i = 0; i < p->count; i++) {
+    const uint8_t *cells = p->puzzles + i * p->cells;
+    found[i] = pool
+      ? parallel_count(pool, p->box, cells, limit, NULL, stats)
+      : solver_count_box(p->box, cells, limit ? limit : SIZE_MAX, NULL, stats);
+  }
+
+  return now_seconds() - start;
+}
+
+void scaling(const Puzzles *p, size_t max_threads, size_t limit) {
+  size_t *expected = calloc(p->count, sizeof(size_t));
+  size_t *found = calloc(p->count, sizeof(size_t));
+  SolverStats stats = { 0 };
+
+  double base = count_all(p, NULL, limit, expected, &stats);
+  printf("%-12s %10.3f s %8s %8.0f guesses/puzzle\n", "sequential", base, "", (double) stats.guesses / p->count);
+
+  for (size_t t = 1; t <= max_threads; t = t * 2 > max_threads && t < max_threads ? max_threads : t * 2) {
+    Pool *pool = pool_create(t);
+    memset(&stats, 0, sizeof(stats));
+
+    double elapsed = count_all(p, pool, limit, found, &stats);
+    pool_destroy(pool);
+
+    for (size_t i = 0; i < p->count; i++) {
+      if (found[i] != expected[i]) {
+	fprintf(stderr, "ERROR: puzzle %zu has %zu solutions sequentially, %zu with %zu threads\n",
+		i, expected[i], found[i], t);
+	exit(1);
+      }
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "%zu thread%s", t, t > 1 ? "s" : "");
+    printf("%-12s %10.3f s %7.2fx %8.0f guesses/puzzle\n", label, elapsed, base / elapsed,
+	   (double) stats.guesses / p->count);
+  }
+
+  free(expected);
+  free(found);
+}
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-j threads] [-l limit] [-s] puzzles\n", program);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  size_t threads = pool_default_threads();
+  size_t limit = 2;
+  int scale = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:l:s")) != -1) {
+    switch (opt) {
+    case 'j': threads = strtoul(optarg, NULL, 10); break;
+    case 'l': limit = strtoul(optarg, NULL, 10); break;
+    case 's': scale = 1; break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (optind >= argc) {
+    usage(argv[0]);
+  }
+
+  Puzzles p;
+  load_puzzles(&p, argv[optind]);
+  printf("%zu %zux%zu puzzles from %s, limit %zu\n\n", p.count, p.box * p.box, p.box * p.box,
+	 argv[optind], limit);
+
+  if (scale) {
+    scaling(&p, threads, limit);
+  } else {
+    Pool *pool = pool_create(threads);
+    size_t *found = calloc(p.count, sizeof(size_t));
+    SolverStats stats = { 0 };
+
+    double elapsed = count_all(&p, pool, limit, found, &stats);
+    for (size_t i = 0; i < p.count; i++) {
+      printf("%zu %zu\n", i, found[i]);
+    }
+    fprintf(stderr, "elapsed:   %.3f s with %zu threads\n", elapsed, pool->count);
+
+    free(found);
+    pool_destroy(pool);
+  }
+
+  free(p.puzzles);
+  return 0;
+}
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "./include/dlx.h"
+
+// Node 0 is the root, nodes 1..DLX_COLUMNS are the column headers and
+// the remaining ones are the four nodes of each matrix row.
+#define ROOT 0
+
+typedef struct {
+  uint8_t cells[SOLVER_CELLS];
+  size_t limit;
+  size_t found;
+  int stop;
+
+  DlxCallback cb;
+  void *ctx;
+  SolverStats *stats;
+} DlxSearch;
+
+// ----------------------------------------
+
+static void link_node(Dlx *d, int n, int c, int r) {
+  d->col[n] = c;
+  d->row[n] = r;
+  d->up[n] = d->up[c];
+  d->down[n] = c;
+  d->down[d->up[c]] = n;
+  d->up[c] = n;
+  d->size[c] += 1;
+}
+
+Dlx *dlx_create(void) {
+  Dlx *d = calloc(1, sizeof(Dlx));
+  if (!d) {
+    fprintf(stderr, "ERROR: could not allocate dlx arena\n");
+    exit(1);
+  }
+
+  for (int c = 0; c <= DLX_COLUMNS; c++) {
+    d->left[c] = c == 0 ? DLX_COLUMNS : c - 1;
+    d->right[c] = c == DLX_COLUMNS ? 0 : c + 1;
+    d->up[c] = c;
+    d->down[c] = c;
+    d->col[c] = c;
+  }
+
+  int n = DLX_COLUMNS + 1;
+  for (int cell = 0; cell < SOLVER_CELLS; cell++) {
+    int y = cell / SOLVER_SIZE;
+    int x = cell % SOLVER_SIZE;
+    int b = (y / SOLVER_BOX) * SOLVER_BOX + x / SOLVER_BOX;
+
+    for (int v = 0; v < SOLVER_SIZE; v++) {
+      int r = cell * SOLVER_SIZE + v;
+      int cols[4] = {
+	1 + cell,
+	1 + SOLVER_CELLS + y * SOLVER_SIZE + v,
+	1 + 2 * SOLVER_CELLS + x * SOLVER_SIZE + v,
+	1 + 3 * SOLVER_CELLS + b * SOLVER_SIZE + v,
+      };
+
+      for (int k = 0; k < 4; k++) {
+	link_node(d, n + k, cols[k], r);
+	d->left[n + k] = n + (k + 3) % 4;
+	d->right[n + k] = n + (k + 1) % 4;
+      }
+      n += 4;
+    }
+  }
+
+  assert(n == DLX_NODES);
+  return d;
+}
+
+void dlx_destroy(Dlx *d) { free(d); }
+
+// ----------------------------------------
+
+static void cover(Dlx *d, int c) {
+  d->right[d->left[c]] = d->right[c];
+  d->left[d->right[c]] = d->left[c];
+
+  for (int i = d->down[c]; i != c; i = d->down[i]) {
+    for (int j = d->right[i]; j != i; j = d->right[j]) {
+      d->down[d->up[j]] = d->down[j];
+      d->up[d->down[j]] = d->up[j];
+      d->size[d->col[j]] -= 1;
+    }
+  }
+}
+
+static void uncover(Dlx *d, int c) {
+  for (int i = d->up[c]; i != c; i = d->up[i]) {
+    for (int j = d->left[i]; j != i; j = d->left[j]) {
+      d->size[d->col[j]] += 1;
+      d->down[d->up[j]] = j;
+      d->up[d->down[j]] = j;
+    }
+  }
+
+  d->right[d->left[c]] = c;
+  d->left[d->right[c]] = c;
+}
+
+// Selects the matrix row of node n: covers the columns of the other
+// nodes of the row (the column of n must already be covered).
+static void select_row(Dlx *d, int n) {
+  for (int j = d->right[n]; j != n; j = d->right[j]) {
+    cover(d, d->col[j]);
+  }
+}
+
+static void unselect_row(Dlx *d, int n) {
+  for (int j = d->left[n]; j != n; j = d->left[j]) {
+    uncover(d, d->col[j]);
+  }
+}
+
+static void search(Dlx *d, DlxSearch *s) {
+  if (d->right[ROOT] == ROOT) {
+    s->found += 1;
+    s->stats->solutions += 1;
+    s->stop = (s->cb && s->cb(s->cells, s->ctx)) || (s->limit && s->found >= s->limit);
+    return;
+  }
+
+  s->stats->propagations += 1;
+
+  // branch on the column with the fewest rows left
+  int c = d->right[ROOT];
+  for (int j = d->right[c]; j != ROOT && d->size[c] > 1; j = d->right[j]) {
+    if (d->size[j] < d->size[c]) {
+      c = j;
+    }
+  }
+
+  if (d->size[c] == 0) {
+    return;
+  }
+
+  cover(d, c);
+  for (int r = d->down[c]; r != c && !s->stop; r = d->down[r]) {
+    int cell = d->row[r] / SOLVER_SIZE;
+
+    if (d->size[c] > 1) {
+      s->stats->guesses += 1;
+    }
+
+    s->cells[cell] = d->row[r] % SOLVER_SIZE + 1;
+    select_row(d, r);
+    search(d, s);
+    unselect_row(d, r);
+    s->cells[cell] = 0;
+  }
+  uncover(d, c);
+}
+
+// Covers the rows of the clues, then runs the search. The matrix is
+// always restored before returning.
+static size_t run(Dlx *d, const uint8_t *cells, DlxSearch *s) {
+  int clues[SOLVER_CELLS];
+  int count = 0;
+  uint8_t covered[DLX_COLUMNS + 1] = { 0 };
+
+  memcpy(s->cells, cells, SOLVER_CELLS);
+
+  for (int cell = 0; cell < SOLVER_CELLS && !s->stop; cell++) {
+    if (!cells[cell]) {
+      continue;
+    }
+    assert(cells[cell] <= SOLVER_SIZE && "invalid digit in grid");
+
+    // first node of the row (cell, digit)
+    int n = 1 + DLX_COLUMNS + 4 * (cell * SOLVER_SIZE + cells[cell] - 1);
+
+    // two clues competing for the same constraint
+    int j = n;
+    do {
+      s->stop |= covered[d->col[j]];
+      j = d->right[j];
+    } while (j != n);
+
+    if (s->stop) {
+      break;
+    }
+
+    do {
+      covered[d->col[j]] = 1;
+      cover(d, d->col[j]);
+      j = d->right[j];
+    } while (j != n);
+    clues[count++] = n;
+  }
+
+  if (!s->stop) {
+    search(d, s);
+  } else {
+    s->found = 0;
+  }
+
+  while (count > 0) {
+    int n = clues[--count];
+    int j = d->left[n];
+    do {
+      uncover(d, d->col[j]);
+      j = d->left[j];
+    } while (j != d->left[n]);
+  }
+
+  return s->found;
+}
+
+// ----------------------------------------
+
+typedef struct {
+  uint8_t *solution;
+} FirstSolution;
+
+static int save_first(const uint8_t *solution, void *ctx) {
+  FirstSolution *first = ctx;
+  if (first->solution) {
+    memcpy(first->solution, solution, SOLVER_CELLS);
+    first->solution = NULL;
+  }
+  return 0;
+}
+
+size_t dlx_count(Dlx *d, const uint8_t *cells, size_t limit, uint8_t *solution, SolverStats *stats) {
+  FirstSolution first = { solution };
+  return dlx_enumerate(d, cells, limit, save_first, &first, stats);
+}
+
+size_t dlx_enumerate(Dlx *d, const uint8_t *cells, size_t limit, DlxCallback cb, void *ctx, SolverStats *stats) {
+  SolverStats unused = { 0 };
+  DlxSearch s = { 0 };
+  s.limit = limit;
+  s.cb = cb;
+  s.ctx = ctx;
+  s.stats = stats ? stats : &unused;
+
+  return run(d, cells, &s);
+}
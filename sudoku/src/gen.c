@@ -0,0 +1,160 @@
+/*
+  Parallel puzzle generator.
+
+  Usage:
+
+    ./sudoku_gen [-n count] [-j threads] [-s seed] [-c clues] [-d any|easy|medium|hard] [-o output]
+
+  Writes one puzzle per line, as 81 characters with 0 for the empty
+  cells. Puzzle i is generated from seed + i, so the output does not
+  depend on the number of threads.
+
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./include/solver.h"
+#include "./include/generator.h"
+#include "./include/pool.h"
+#include "./include/timing.h"
+
+#define BLOCK_PUZZLES 64
+#define LINE_SIZE (SOLVER_CELLS + 1)
+
+typedef struct {
+  uint64_t seed;
+  GenOptions opts;
+  char *out;
+  size_t count;
+  atomic_size_t clues;
+  atomic_size_t missed;  // puzzles easier than asked for
+} Job;
+
+typedef struct {
+  Job *job;
+  size_t first;
+  size_t count;
+} Block;
+
+// ----------------------------------------
+
+void generate_block(void *arg, size_t worker) {
+  Block *b = arg;
+  Job *job = b->job;
+  size_t clues = 0;
+  size_t missed = 0;
+  (void) worker;
+
+  for (size_t i = b->first; i < b->first + b->count; i++) {
+    uint8_t puzzle[SOLVER_CELLS];
+    char *line = job->out + i * LINE_SIZE;
+
+    Difficulty reached;
+
+    clues += generate_puzzle(job->seed + i, &job->opts, puzzle, NULL, &reached);
+    missed += reached != job->opts.difficulty;
+    for (int k = 0; k < SOLVER_CELLS; k++) {
+      line[k] = '0' + puzzle[k];
+    }
+    line[SOLVER_CELLS] = '\n';
+  }
+
+  atomic_fetch_add(&job->clues, clues);
+  atomic_fetch_add(&job->missed, missed);
+}
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-n count] [-j threads] [-s seed] [-c clues] [-d any|easy|medium|hard] [-o output]\n", program);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  Job job = { 0 };
+  size_t threads = pool_default_threads();
+  const char *output = NULL;
+  int opt;
+
+  job.count = 1;
+  job.seed = time(NULL);
+
+  while ((opt = getopt(argc, argv, "n:j:s:c:d:o:")) != -1) {
+    switch (opt) {
+    case 'n': job.count = strtoul(optarg, NULL, 10); break;
+    case 'j': threads = strtoul(optarg, NULL, 10); break;
+    case 's': job.seed = strtoull(optarg, NULL, 10); break;
+    case 'c': job.opts.clues = strtoul(optarg, NULL, 10); break;
+    case 'o': output = optarg; break;
+    case 'd': {
+      int found = 0;
+      for (int d = 0; d < DIFFICULTY_COUNT; d++) {
+	if (strcmp(optarg, DIFFICULTY_NAMES[d]) == 0) {
+	  job.opts.difficulty = d;
+	  found = 1;
+	}
+      }
+      if (!found) {
+	usage(argv[0]);
+      }
+      break;
+    }
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (job.opts.difficulty == DIFFICULTY_EASY && job.opts.clues && job.opts.clues < EASY_MIN_CLUES) {
+    fprintf(stderr, "ERROR: easy puzzles have at least %d clues, not %zu\n", EASY_MIN_CLUES, job.opts.clues);
+    exit(1);
+  }
+
+  FILE *out = output ? fopen(output, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "ERROR: could not open file %s: %s\n", output, strerror(errno));
+    exit(1);
+  }
+
+  size_t blocks = (job.count + BLOCK_PUZZLES - 1) / BLOCK_PUZZLES;
+  Block *block = calloc(blocks, sizeof(Block));
+  job.out = malloc(job.count * LINE_SIZE);
+
+  Pool *pool = pool_create(threads);
+  double start = now_seconds();
+
+  for (size_t k = 0; k < blocks; k++) {
+    block[k].job = &job;
+    block[k].first = k * BLOCK_PUZZLES;
+    block[k].count = job.count - block[k].first < BLOCK_PUZZLES ? job.count - block[k].first : BLOCK_PUZZLES;
+    pool_submit(pool, generate_block, &block[k]);
+  }
+  pool_wait(pool);
+
+  double elapsed = now_seconds() - start;
+
+  fwrite(job.out, LINE_SIZE, job.count, out);
+  fflush(out);
+
+  fprintf(stderr, "puzzles:   %zu (%s, seed %lu)\n", job.count, DIFFICULTY_NAMES[job.opts.difficulty], (unsigned long) job.seed);
+  fprintf(stderr, "threads:   %zu\n", pool->count);
+  fprintf(stderr, "clues:     %.2f per puzzle\n", job.count ? (double) atomic_load(&job.clues) / job.count : 0.0);
+  if (atomic_load(&job.missed)) {
+    fprintf(stderr, "missed:    %zu puzzles are only %s\n", atomic_load(&job.missed), DIFFICULTY_NAMES[DIFFICULTY_MEDIUM]);
+  }
+  fprintf(stderr, "elapsed:   %.3f s\n", elapsed);
+  fprintf(stderr, "rate:      %.0f puzzles/s\n", job.count / elapsed);
+
+  pool_destroy(pool);
+  free(job.out);
+  free(block);
+  if (output) {
+    fclose(out);
+  }
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "./include/generator.h"
+
+// hard puzzles are retried from a new grid this many times
+#define HARD_ATTEMPTS 64
+
+const char *DIFFICULTY_NAMES[DIFFICULTY_COUNT] = { "any", "easy", "medium", "hard" };
+
+// ----------------------------------------
+// RNG
+
+static uint64_t splitmix64(uint64_t *x) {
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static uint64_t rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+void rng_seed(Rng *r, uint64_t seed) {
+  for (int i = 0; i < 4; i++) {
+    r->s[i] = splitmix64(&seed);
+  }
+}
+
+uint64_t rng_next(Rng *r) {
+  uint64_t *s = r->s;
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+
+  return result;
+}
+
+uint32_t rng_range(Rng *r, uint32_t n) {
+  // Lemire's multiply-shift, the bias is negligible for our n
+  return (uint32_t) (((rng_next(r) >> 32) * n) >> 32);
+}
+
+static void shuffle(Rng *r, uint8_t *v, size_t n) {
+  for (size_t i = n - 1; i > 0; i--) {
+    size_t j = rng_range(r, i + 1);
+    uint8_t tmp = v[i];
+    v[i] = v[j];
+    v[j] = tmp;
+  }
+}
+
+// ----------------------------------------
+// GRIDS
+
+// The three boxes on the diagonal don't constrain each other, so they
+// are filled with random permutations and the solver completes the
+// rest. The grid is then mixed up with transformations that preserve
+// validity: relabeling the digits, shuffling the rows of each band and
+// the bands themselves, and the same for columns and stacks.
+void generate_grid(Rng *r, uint8_t *grid) {
+  uint8_t tmp[SOLVER_CELLS];
+  uint8_t digits[SOLVER_SIZE];
+
+  memset(grid, 0, SOLVER_CELLS);
+
+  for (int b = 0; b < SOLVER_BOX; b++) {
+    for (int i = 0; i < SOLVER_SIZE; i++) {
+      digits[i] = i + 1;
+    }
+    shuffle(r, digits, SOLVER_SIZE);
+
+    for (int i = 0; i < SOLVER_SIZE; i++) {
+      int y = b * SOLVER_BOX + i / SOLVER_BOX;
+      int x = b * SOLVER_BOX + i % SOLVER_BOX;
+      grid[y * SOLVER_SIZE + x] = digits[i];
+    }
+  }
+
+  int solved = solver_solve(grid, NULL);
+  assert(solved && "diagonal boxes always have a completion");
+  (void) solved;
+
+  // relabel digits
+  uint8_t label[SOLVER_SIZE + 1] = { 0 };
+  for (int i = 0; i < SOLVER_SIZE; i++) {
+    digits[i] = i + 1;
+  }
+  shuffle(r, digits, SOLVER_SIZE);
+  for (int i = 0; i < SOLVER_SIZE; i++) {
+    label[i + 1] = digits[i];
+  }
+
+  // row and column permutations that keep bands and stacks together
+  uint8_t perm[2][SOLVER_SIZE];
+  for (int k = 0; k < 2; k++) {
+    uint8_t bands[SOLVER_BOX], inner[SOLVER_BOX];
+    for (int i = 0; i < SOLVER_BOX; i++) {
+      bands[i] = i;
+    }
+    shuffle(r, bands, SOLVER_BOX);
+
+    for (int b = 0; b < SOLVER_BOX; b++) {
+      for (int i = 0; i < SOLVER_BOX; i++) {
+	inner[i] = i;
+      }
+      shuffle(r, inner, SOLVER_BOX);
+      for (int i = 0; i < SOLVER_BOX; i++) {
+	perm[k][b * SOLVER_BOX + i] = bands[b] * SOLVER_BOX + inner[i];
+      }
+    }
+  }
+
+  int transpose = rng_range(r, 2);
+  for (int y = 0; y < SOLVER_SIZE; y++) {
+    for (int x = 0; x < SOLVER_SIZE; x++) {
+      int sy = perm[0][y], sx = perm[1][x];
+      uint8_t v = transpose ? grid[sx * SOLVER_SIZE + sy] : grid[sy * SOLVER_SIZE + sx];
+      tmp[y * SOLVER_SIZE + x] = label[v];
+    }
+  }
+
+  memcpy(grid, tmp, SOLVER_CELLS);
+}
+
+// ----------------------------------------
+// PUZZLES
+
+// Removes clues in random order, keeping a removal only if the puzzle
+// still has a single solution and, if `singles_only`, if it can still
+// be solved without guessing.
+static size_t remove_clues(Rng *r, uint8_t *puzzle, size_t target, int singles_only) {
+  uint8_t order[SOLVER_CELLS];
+  size_t clues = SOLVER_CELLS;
+
+  for (int i = 0; i < SOLVER_CELLS; i++) {
+    order[i] = i;
+  }
+  shuffle(r, order, SOLVER_CELLS);
+
+  for (int k = 0; k < SOLVER_CELLS && clues > target; k++) {
+    int i = order[k];
+    uint8_t value = puzzle[i];
+    SolverStats stats = { 0 };
+
+    puzzle[i] = 0;
+    if (solver_count(puzzle, 2, NULL, &stats) == 1 && (!singles_only || stats.guesses == 0)) {
+      clues -= 1;
+    } else {
+      puzzle[i] = value;
+    }
+  }
+
+  return clues;
+}
+
+size_t generate_puzzle(uint64_t seed, const GenOptions *opts, uint8_t *puzzle, uint8_t *solution, Difficulty *reached) {
+  Rng r;
+  uint8_t grid[SOLVER_CELLS];
+  size_t clues = 0;
+  size_t target = opts->clues;
+  Difficulty difficulty = opts->difficulty;
+
+  rng_seed(&r, seed);
+
+  if (opts->difficulty == DIFFICULTY_EASY && target < EASY_MIN_CLUES) {
+    target = EASY_MIN_CLUES;
+  }
+
+  for (int attempt = 0; attempt < HARD_ATTEMPTS; attempt++) {
+    generate_grid(&r, grid);
+    memcpy(puzzle, grid, SOLVER_CELLS);
+
+    int singles_only = opts->difficulty == DIFFICULTY_EASY || opts->difficulty == DIFFICULTY_MEDIUM;
+    clues = remove_clues(&r, puzzle, target, singles_only);
+
+    if (opts->difficulty != DIFFICULTY_HARD) {
+      break;
+    }
+
+    // a hard puzzle must not be solvable by singles alone
+    SolverStats stats = { 0 };
+    solver_count(puzzle, 1, NULL, &stats);
+    if (stats.guesses > 0) {
+      break;
+    }
+
+    // out of attempts, what is left is only as hard as a medium one
+    if (attempt == HARD_ATTEMPTS - 1) {
+      difficulty = DIFFICULTY_MEDIUM;
+    }
+  }
+
+  if (solution) {
+    memcpy(solution, grid, SOLVER_CELLS);
+  }
+  if (reached) {
+    *reached = difficulty;
+  }
+
+  return clues;
+}
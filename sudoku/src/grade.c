@@ -0,0 +1,192 @@
+/*
+  Batch grader.
+
+  Usage:
+
+    ./sudoku_grade [-j threads] [-o output] puzzles
+
+  The input is any 9x9 puzzle file understood by the loader (see
+  loader.h). For each puzzle one line is written, in input order, with
+  the puzzle, its score, its level and the hardest technique it needs.
+  A summary of the whole dataset goes to stderr.
+
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./include/solver.h"
+#include "./include/grader.h"
+#include "./include/pool.h"
+#include "./include/loader.h"
+#include "./include/timing.h"
+
+#define BLOCK_PUZZLES 256
+
+typedef struct {
+  uint32_t score;
+  int8_t hardest;
+  uint8_t level;
+} Result;
+
+typedef struct {
+  Loader input;
+  Result *results;
+} Job;
+
+typedef struct {
+  Job *job;
+  size_t first;
+  size_t count;
+
+  // totals of the block, merged at the end
+  uint64_t uses[TECH_COUNT];
+  size_t needs[TECH_COUNT];   // puzzles where each technique was needed
+} Block;
+
+// ----------------------------------------
+
+void grade_block(void *arg, size_t worker) {
+  Block *b = arg;
+  Job *job = b->job;
+  (void) worker;
+
+  for (size_t i = b->first; i < b->first + b->count; i++) {
+    uint8_t cells[SOLVER_CELLS];
+    Grade g;
+
+    // malformed puzzles are reported as invalid
+    if (!loader_puzzle(&job->input, i, cells)) {
+      job->results[i] = (Result){ 0, -1, LEVEL_INVALID };
+      continue;
+    }
+
+    grade_puzzle(cells, &g);
+    job->results[i] = (Result){ g.score, g.hardest, g.level };
+
+    for (int t = 0; t < TECH_COUNT; t++) {
+      b->uses[t] += g.uses[t];
+      b->needs[t] += g.uses[t] > 0;
+    }
+  }
+}
+
+void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-j threads] [-o output] puzzles\n", program);
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  size_t threads = pool_default_threads();
+  const char *output = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:o:")) != -1) {
+    switch (opt) {
+    case 'j': threads = strtoul(optarg, NULL, 10); break;
+    case 'o': output = optarg; break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  if (optind >= argc) {
+    usage(argv[0]);
+  }
+
+  FILE *out = output ? fopen(output, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "ERROR: could not open file %s: %s\n", output, strerror(errno));
+    exit(1);
+  }
+
+  Job job = { 0 };
+  loader_open(&job.input, argv[optind]);
+
+  if (job.input.rows != SOLVER_SIZE || job.input.cols != SOLVER_SIZE) {
+    fprintf(stderr, "ERROR: only %dx%d puzzles are supported\n", SOLVER_SIZE, SOLVER_SIZE);
+    exit(1);
+  }
+
+  size_t count = job.input.count;
+  job.results = malloc(count * sizeof(Result));
+
+  size_t blocks = (count + BLOCK_PUZZLES - 1) / BLOCK_PUZZLES;
+  Block *block = calloc(blocks, sizeof(Block));
+
+  Pool *pool = pool_create(threads);
+  double start = now_seconds();
+
+  for (size_t k = 0; k < blocks; k++) {
+    block[k].job = &job;
+    block[k].first = k * BLOCK_PUZZLES;
+    block[k].count = count - block[k].first < BLOCK_PUZZLES ? count - block[k].first : BLOCK_PUZZLES;
+    pool_submit(pool, grade_block, &block[k]);
+  }
+  pool_wait(pool);
+
+  double elapsed = now_seconds() - start;
+
+  size_t levels[LEVEL_COUNT] = { 0 };
+  for (size_t i = 0; i < count; i++) {
+    Result *r = &job.results[i];
+    uint8_t cells[SOLVER_CELLS];
+    char puzzle[SOLVER_CELLS];
+
+    // the puzzle is written back in the one line format
+    if (loader_puzzle(&job.input, i, cells)) {
+      for (int k = 0; k < SOLVER_CELLS; k++) {
+	puzzle[k] = '0' + cells[k];
+      }
+    } else {
+      memset(puzzle, '.', SOLVER_CELLS);
+    }
+
+    levels[r->level] += 1;
+    fprintf(out, "%.*s %u %s %s\n", SOLVER_CELLS, puzzle, r->score,
+	    LEVEL_NAMES[r->level], r->hardest < 0 ? "none" : TECHNIQUE_NAMES[r->hardest]);
+  }
+  fflush(out);
+
+  uint64_t uses[TECH_COUNT] = { 0 };
+  size_t needs[TECH_COUNT] = { 0 };
+  for (size_t k = 0; k < blocks; k++) {
+    for (int t = 0; t < TECH_COUNT; t++) {
+      uses[t] += block[k].uses[t];
+      needs[t] += block[k].needs[t];
+    }
+  }
+
+  size_t n = count;
+  fprintf(stderr, "puzzles:   %zu\n", n);
+  fprintf(stderr, "threads:   %zu\n", pool->count);
+  fprintf(stderr, "elapsed:   %.3f s\n", elapsed);
+  fprintf(stderr, "rate:      %.0f puzzles/s (%.1f us per puzzle per thread)\n",
+	  n / elapsed, n ? elapsed * pool->count / n * 1e6 : 0.0);
+
+  fprintf(stderr, "\nlevels\n");
+  for (int l = 0; l < LEVEL_COUNT; l++) {
+    fprintf(stderr, "  %-20s %10zu %6.2f%%\n", LEVEL_NAMES[l], levels[l], n ? 100.0 * levels[l] / n : 0.0);
+  }
+
+  fprintf(stderr, "\ntechniques                 puzzles       uses\n");
+  for (int t = 0; t < TECH_COUNT; t++) {
+    fprintf(stderr, "  %-20s %10zu %10lu\n", TECHNIQUE_NAMES[t], needs[t], (unsigned long) uses[t]);
+  }
+
+  pool_destroy(pool);
+  free(block);
+  free(job.results);
+  loader_close(&job.input);
+  if (output) {
+    fclose(out);
+  }
+
+  return 0;
+}
@@ -0,0 +1,582 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "./include/grader.h"
+
+// The grid is kept as the candidates of each empty cell, as in the
+// bitmask solver (bit d set if digit d is still possible). Every
+// technique looks for a pattern over these masks and either places a
+// digit or removes candidates, and returns how many times it applied.
+
+typedef struct {
+  uint8_t cells[SOLVER_CELLS];
+  uint16_t cand[SOLVER_CELLS];   // 0 for the filled cells
+  int empty;
+
+  // places[u][d] has bit k set if digit d is possible in the k-th cell
+  // of unit u, rebuilt on demand after the candidates change
+  uint16_t places[3 * SOLVER_SIZE][SOLVER_SIZE + 1];
+  int places_stale;
+} State;
+
+typedef int (*TechniqueFn)(State *s);
+
+#define CELL_ROW(i) ((i) / SOLVER_SIZE)
+#define CELL_COL(i) ((i) % SOLVER_SIZE)
+#define CELL_BOX(i) ((CELL_ROW(i) / SOLVER_BOX) * SOLVER_BOX + CELL_COL(i) / SOLVER_BOX)
+
+#define UNITS (3 * SOLVER_SIZE)
+#define ROW_UNIT(r) (r)
+#define COL_UNIT(c) (SOLVER_SIZE + (c))
+#define BOX_UNIT(b) (2 * SOLVER_SIZE + (b))
+
+const char *TECHNIQUE_NAMES[TECH_COUNT] = {
+  "naked single",
+  "hidden single",
+  "naked pair",
+  "hidden pair",
+  "pointing",
+  "box/line reduction",
+  "naked triple",
+  "hidden triple",
+  "x-wing",
+  "xy-wing",
+  "swordfish",
+};
+
+const char *LEVEL_NAMES[LEVEL_COUNT] = { "easy", "medium", "hard", "expert", "invalid" };
+
+// score of each use of a technique
+static const uint32_t TECHNIQUE_WEIGHTS[TECH_COUNT] = { 1, 2, 10, 12, 15, 15, 20, 25, 40, 50, 60 };
+
+// added to the score of the puzzles the techniques can't solve, so that
+// they always rank above the ones they can
+#define UNSOLVED_SCORE 1000
+
+// ----------------------------------------
+
+// i-th cell of unit u, where units 0..8 are the rows, 9..17 the
+// columns and 18..26 the boxes.
+static int unit_cell(int u, int i) {
+  if (u < SOLVER_SIZE) {
+    return u * SOLVER_SIZE + i;
+  } else if (u < 2 * SOLVER_SIZE) {
+    return i * SOLVER_SIZE + (u - SOLVER_SIZE);
+  } else {
+    int b = u - 2 * SOLVER_SIZE;
+    int y = (b / SOLVER_BOX) * SOLVER_BOX + i / SOLVER_BOX;
+    int x = (b % SOLVER_BOX) * SOLVER_BOX + i % SOLVER_BOX;
+    return y * SOLVER_SIZE + x;
+  }
+}
+
+static int sees(int i, int j) {
+  return i != j && (CELL_ROW(i) == CELL_ROW(j) ||
+		    CELL_COL(i) == CELL_COL(j) ||
+		    CELL_BOX(i) == CELL_BOX(j));
+}
+
+static void place(State *s, int i, int digit) {
+  uint16_t keep = ~(1 << digit);
+  int units[3] = { ROW_UNIT(CELL_ROW(i)), COL_UNIT(CELL_COL(i)), BOX_UNIT(CELL_BOX(i)) };
+
+  s->cells[i] = digit;
+  s->cand[i] = 0;
+  s->empty -= 1;
+  s->places_stale = 1;
+
+  for (int u = 0; u < 3; u++) {
+    for (int k = 0; k < SOLVER_SIZE; k++) {
+      s->cand[unit_cell(units[u], k)] &= keep;
+    }
+  }
+}
+
+// Removes the digits in `mask` from cell i, returns 1 if any was there.
+static int eliminate(State *s, int i, uint16_t mask) {
+  if (s->cand[i] & mask) {
+    s->cand[i] &= ~mask;
+    s->places_stale = 1;
+    return 1;
+  }
+  return 0;
+}
+
+// Cells of unit u where digit d is possible, as a mask of unit indices.
+static uint16_t digit_places(State *s, int u, int d) {
+  if (s->places_stale) {
+    memset(s->places, 0, sizeof(s->places));
+    for (int i = 0; i < SOLVER_CELLS; i++) {
+      int y = CELL_ROW(i), x = CELL_COL(i);
+      int slot = (y % SOLVER_BOX) * SOLVER_BOX + x % SOLVER_BOX;
+      for (uint16_t c = s->cand[i]; c; c &= c - 1) {
+	int d = __builtin_ctz(c);
+	s->places[ROW_UNIT(y)][d] |= 1 << x;
+	s->places[COL_UNIT(x)][d] |= 1 << y;
+	s->places[BOX_UNIT(CELL_BOX(i))][d] |= 1 << slot;
+      }
+    }
+    s->places_stale = 0;
+  }
+  return s->places[u][d];
+}
+
+// 0 if some empty cell has no candidates or some digit has no place
+// left in a unit.
+static int consistent(const State *s) {
+  for (int u = 0; u < UNITS; u++) {
+    uint16_t seen = 0;
+    for (int k = 0; k < SOLVER_SIZE; k++) {
+      int i = unit_cell(u, k);
+      if (!s->cells[i] && !s->cand[i]) {
+	return 0;
+      }
+      seen |= s->cells[i] ? 1 << s->cells[i] : s->cand[i];
+    }
+    if (seen != SOLVER_ALL_DIGITS) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Next k-combination of 0..n-1 in lexicographic order, returns 0 after
+// the last one.
+static int next_combo(int *idx, int k, int n) {
+  int i = k - 1;
+  while (i >= 0 && idx[i] == n - k + i) {
+    i--;
+  }
+  if (i < 0) {
+    return 0;
+  }
+  idx[i] += 1;
+  for (int j = i + 1; j < k; j++) {
+    idx[j] = idx[j - 1] + 1;
+  }
+  return 1;
+}
+
+// ----------------------------------------
+// SINGLES
+
+static int naked_single(State *s) {
+  int placed = 0;
+
+  for (int i = 0; i < SOLVER_CELLS; i++) {
+    uint16_t c = s->cand[i];
+    if (c && !(c & (c - 1))) {
+      place(s, i, __builtin_ctz(c));
+      placed += 1;
+    }
+  }
+
+  return placed;
+}
+
+static int hidden_single(State *s) {
+  int placed = 0;
+
+  for (int u = 0; u < UNITS; u++) {
+    uint16_t once = 0, twice = 0;
+
+    for (int k = 0; k < SOLVER_SIZE; k++) {
+      uint16_t c = s->cand[unit_cell(u, k)];
+      twice |= once & c;
+      once |= c;
+    }
+
+    uint16_t hidden = once & ~twice;
+    for (int k = 0; hidden && k < SOLVER_SIZE; k++) {
+      int i = unit_cell(u, k);
+      uint16_t c = s->cand[i] & hidden;
+      if (c) {
+	// two hidden singles in the same cell, left to consistent()
+	int d = __builtin_ctz(c);
+	place(s, i, d);
+	hidden &= ~(1 << d);
+	placed += 1;
+      }
+    }
+  }
+
+  return placed;
+}
+
+// ----------------------------------------
+// SUBSETS
+
+// k cells of a unit whose candidates are only k digits: those digits
+// can't go anywhere else in the unit.
+static int naked_subset(State *s, int k) {
+  for (int u = 0; u < UNITS; u++) {
+    uint16_t cand[SOLVER_SIZE];
+    int slots[SOLVER_SIZE];   // indices in the unit
+    int n = 0;
+
+    for (int j = 0; j < SOLVER_SIZE; j++) {
+      cand[j] = s->cand[unit_cell(u, j)];
+      int count = __builtin_popcount(cand[j]);
+      if (count >= 2 && count <= k) {
+	slots[n++] = j;
+      }
+    }
+
+    if (n < k) {
+      continue;
+    }
+
+    int idx[3] = { 0, 1, 2 };
+    do {
+      uint16_t digits = 0, members = 0;
+      for (int j = 0; j < k; j++) {
+	digits |= cand[slots[idx[j]]];
+	members |= 1 << slots[idx[j]];
+      }
+      if (__builtin_popcount(digits) != k) {
+	continue;
+      }
+
+      int changed = 0;
+      for (int m = 0; m < SOLVER_SIZE; m++) {
+	if (!(members & (1 << m)) && (cand[m] & digits)) {
+	  changed |= eliminate(s, unit_cell(u, m), digits);
+	}
+      }
+      if (changed) {
+	return 1;
+      }
+    } while (next_combo(idx, k, n));
+  }
+
+  return 0;
+}
+
+// k digits that can only go in the same k cells of a unit: those cells
+// can't take any other digit.
+static int hidden_subset(State *s, int k) {
+  for (int u = 0; u < UNITS; u++) {
+    int digits[SOLVER_SIZE];
+    uint16_t places[SOLVER_SIZE + 1];
+    int n = 0;
+
+    for (int d = 1; d <= SOLVER_SIZE; d++) {
+      places[d] = digit_places(s, u, d);
+      int count = __builtin_popcount(places[d]);
+      if (count >= 2 && count <= k) {
+	digits[n++] = d;
+      }
+    }
+
+    if (n < k) {
+      continue;
+    }
+
+    int idx[3] = { 0, 1, 2 };
+    do {
+      uint16_t cells = 0, keep = 0;
+      for (int j = 0; j < k; j++) {
+	cells |= places[digits[idx[j]]];
+	keep |= 1 << digits[idx[j]];
+      }
+      if (__builtin_popcount(cells) != k) {
+	continue;
+      }
+
+      int changed = 0;
+      for (int m = 0; m < SOLVER_SIZE; m++) {
+	if (cells & (1 << m)) {
+	  changed |= eliminate(s, unit_cell(u, m), ~keep);
+	}
+      }
+      if (changed) {
+	return 1;
+      }
+    } while (next_combo(idx, k, n));
+  }
+
+  return 0;
+}
+
+static int naked_pair(State *s)    { return naked_subset(s, 2); }
+static int naked_triple(State *s)  { return naked_subset(s, 3); }
+static int hidden_pair(State *s)   { return hidden_subset(s, 2); }
+static int hidden_triple(State *s) { return hidden_subset(s, 3); }
+
+// ----------------------------------------
+// INTERSECTIONS
+
+// Slots of a unit are indexed 0..8 as in unit_cell(). A row of a box,
+// or the part of a row (column) inside a box, is three consecutive
+// slots, while a column of a box is every third slot.
+#define TRIPLE_SLOTS(k) (0x7 << (3 * (k)))
+#define BOX_COL_SLOTS(k) (0x49 << (k))
+
+// Removes digit d from the given slots of unit u, where it is known to
+// be possible.
+static int eliminate_slots(State *s, int u, uint16_t slots, int d) {
+  for (; slots; slots &= slots - 1) {
+    eliminate(s, unit_cell(u, __builtin_ctz(slots)), 1 << d);
+  }
+  return 1;
+}
+
+// all the places of a digit in a box are on one row or column
+static int pointing(State *s) {
+  for (int b = 0; b < SOLVER_SIZE; b++) {
+    int band = b / SOLVER_BOX, stack = b % SOLVER_BOX;
+
+    for (int d = 1; d <= SOLVER_SIZE; d++) {
+      uint16_t places = digit_places(s, BOX_UNIT(b), d);
+      if (!places) {
+	continue;
+      }
+
+      int k = __builtin_ctz(places);
+      int r = k / SOLVER_BOX, c = k % SOLVER_BOX;
+
+      if (!(places & ~TRIPLE_SLOTS(r))) {
+	int row = ROW_UNIT(band * SOLVER_BOX + r);
+	uint16_t outside = digit_places(s, row, d) & ~TRIPLE_SLOTS(stack);
+	if (outside) {
+	  return eliminate_slots(s, row, outside, d);
+	}
+      }
+
+      if (!(places & ~BOX_COL_SLOTS(c))) {
+	int col = COL_UNIT(stack * SOLVER_BOX + c);
+	uint16_t outside = digit_places(s, col, d) & ~TRIPLE_SLOTS(band);
+	if (outside) {
+	  return eliminate_slots(s, col, outside, d);
+	}
+      }
+    }
+  }
+  return 0;
+}
+
+// all the places of a digit in a row or column are in one box
+static int box_line(State *s) {
+  for (int l = 0; l < SOLVER_SIZE; l++) {
+    for (int d = 1; d <= SOLVER_SIZE; d++) {
+      // l as a row
+      uint16_t places = digit_places(s, ROW_UNIT(l), d);
+      int stack = places ? __builtin_ctz(places) / SOLVER_BOX : 0;
+
+      if (places && !(places & ~TRIPLE_SLOTS(stack))) {
+	int box = BOX_UNIT((l / SOLVER_BOX) * SOLVER_BOX + stack);
+	uint16_t outside = digit_places(s, box, d) & ~TRIPLE_SLOTS(l % SOLVER_BOX);
+	if (outside) {
+	  return eliminate_slots(s, box, outside, d);
+	}
+      }
+
+      // l as a column
+      places = digit_places(s, COL_UNIT(l), d);
+      int band = places ? __builtin_ctz(places) / SOLVER_BOX : 0;
+
+      if (places && !(places & ~TRIPLE_SLOTS(band))) {
+	int box = BOX_UNIT(band * SOLVER_BOX + l / SOLVER_BOX);
+	uint16_t outside = digit_places(s, box, d) & ~BOX_COL_SLOTS(l % SOLVER_BOX);
+	if (outside) {
+	  return eliminate_slots(s, box, outside, d);
+	}
+      }
+    }
+  }
+  return 0;
+}
+
+// ----------------------------------------
+// FISH AND WINGS
+
+// n rows where digit d can only go in the same n columns: d can't go
+// anywhere else in those columns (and the same with rows and columns
+// swapped).
+static int fish(State *s, int n) {
+  for (int d = 1; d <= SOLVER_SIZE; d++) {
+    for (int base = 0; base < 2; base++) {
+      int lines[SOLVER_SIZE];
+      uint16_t places[SOLVER_SIZE];
+      int count = 0;
+
+      for (int l = 0; l < SOLVER_SIZE; l++) {
+	uint16_t p = digit_places(s, base ? COL_UNIT(l) : ROW_UNIT(l), d);
+	int c = __builtin_popcount(p);
+	if (c >= 2 && c <= n) {
+	  lines[count] = l;
+	  places[count] = p;
+	  count += 1;
+	}
+      }
+
+      if (count < n) {
+	continue;
+      }
+
+      int idx[3] = { 0, 1, 2 };
+      do {
+	uint16_t cover = 0, chosen = 0;
+	for (int j = 0; j < n; j++) {
+	  cover |= places[idx[j]];
+	  chosen |= 1 << lines[idx[j]];
+	}
+	if (__builtin_popcount(cover) != n) {
+	  continue;
+	}
+
+	int changed = 0;
+	for (int c = 0; c < SOLVER_SIZE; c++) {
+	  if (!(cover & (1 << c))) {
+	    continue;
+	  }
+	  int cross = base ? ROW_UNIT(c) : COL_UNIT(c);
+	  for (int l = 0; l < SOLVER_SIZE; l++) {
+	    if (!(chosen & (1 << l))) {
+	      changed |= eliminate(s, unit_cell(cross, l), 1 << d);
+	    }
+	  }
+	}
+	if (changed) {
+	  return 1;
+	}
+      } while (next_combo(idx, n, count));
+    }
+  }
+
+  return 0;
+}
+
+static int x_wing(State *s)    { return fish(s, 2); }
+static int swordfish(State *s) { return fish(s, 3); }
+
+// A pivot {x,y} seeing two pincers {x,z} and {y,z}: one of the pincers
+// is z, so z can't go in any cell that sees both of them.
+static int xy_wing(State *s) {
+  int pairs[SOLVER_CELLS];
+  int n = 0;
+
+  for (int i = 0; i < SOLVER_CELLS; i++) {
+    if (__builtin_popcount(s->cand[i]) == 2) {
+      pairs[n++] = i;
+    }
+  }
+
+  for (int p = 0; p < n; p++) {
+    uint16_t pivot = s->cand[pairs[p]];
+
+    for (int a = 0; a < n; a++) {
+      uint16_t ca = s->cand[pairs[a]];
+      if (!sees(pairs[p], pairs[a]) || __builtin_popcount(ca & pivot) != 1) {
+	continue;
+      }
+
+      for (int b = a + 1; b < n; b++) {
+	uint16_t cb = s->cand[pairs[b]];
+	if (!sees(pairs[p], pairs[b]) || cb == ca || __builtin_popcount(cb & pivot) != 1) {
+	  continue;
+	}
+
+	// the pincers share z, which is not in the pivot
+	uint16_t z = ca & cb & ~pivot;
+	if (!z || (ca | cb | pivot) != (pivot | z)) {
+	  continue;
+	}
+
+	int changed = 0;
+	for (int i = 0; i < SOLVER_CELLS; i++) {
+	  if (sees(i, pairs[a]) && sees(i, pairs[b])) {
+	    changed |= eliminate(s, i, z);
+	  }
+	}
+	if (changed) {
+	  return 1;
+	}
+      }
+    }
+  }
+
+  return 0;
+}
+
+// ----------------------------------------
+
+static const TechniqueFn TECHNIQUES[TECH_COUNT] = {
+  naked_single,
+  hidden_single,
+  naked_pair,
+  hidden_pair,
+  pointing,
+  box_line,
+  naked_triple,
+  hidden_triple,
+  x_wing,
+  xy_wing,
+  swordfish,
+};
+
+int grade_puzzle(const uint8_t *cells, Grade *grade) {
+  State s = { 0 };
+
+  memset(grade, 0, sizeof(*grade));
+  grade->hardest = -1;
+
+  for (int i = 0; i < SOLVER_CELLS; i++) {
+    s.cand[i] = SOLVER_ALL_DIGITS;
+  }
+  s.empty = SOLVER_CELLS;
+  s.places_stale = 1;
+
+  int valid = 1;
+  for (int i = 0; valid && i < SOLVER_CELLS; i++) {
+    int digit = cells[i];
+    if (digit) {
+      assert(digit <= SOLVER_SIZE && "invalid digit in grid");
+      valid = (s.cand[i] & (1 << digit)) != 0;
+      place(&s, i, digit);
+    }
+  }
+
+  // techniques only ever place candidates, so a contradiction can
+  // only show up as a cell or a digit without places, checked once at
+  // the end
+  while (valid && s.empty > 0) {
+    int t, applied = 0;
+    for (t = 0; t < TECH_COUNT; t++) {
+      if ((applied = TECHNIQUES[t](&s))) {
+	break;
+      }
+    }
+
+    // stuck, this puzzle needs something harder
+    if (!applied) {
+      break;
+    }
+
+    grade->uses[t] += applied;
+    grade->score += applied * TECHNIQUE_WEIGHTS[t];
+    if (t > grade->hardest) {
+      grade->hardest = t;
+    }
+  }
+
+  valid = valid && consistent(&s);
+  memcpy(grade->cells, s.cells, SOLVER_CELLS);
+
+  if (!valid) {
+    grade->level = LEVEL_INVALID;
+  } else if (s.empty > 0) {
+    grade->level = LEVEL_EXPERT;
+    grade->score += UNSOLVED_SCORE;
+  } else if (grade->hardest <= TECH_HIDDEN_SINGLE) {
+    grade->level = LEVEL_EASY;
+  } else if (grade->hardest <= TECH_HIDDEN_TRIPLE) {
+    grade->level = LEVEL_MEDIUM;
+  } else {
+    grade->level = LEVEL_HARD;
+  }
+
+  return valid && s.empty == 0;
+}
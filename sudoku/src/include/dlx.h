@@ -0,0 +1,46 @@
+#ifndef DLX_H_
+#define DLX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "./solver.h"
+
+// Dancing Links (Knuth's Algorithm X) over the exact-cover matrix of
+// the 9x9 sudoku. The matrix has one row for each (cell, digit) pair
+// and 324 columns: each cell is filled once, and each digit appears
+// once per row, column and box.
+//
+// All nodes live in a single preallocated arena, built once by
+// dlx_create() and restored after every search, so that a Dlx can be
+// reused for any number of puzzles (but by one thread at a time).
+
+#define DLX_COLUMNS (4 * SOLVER_CELLS)
+#define DLX_ROWS (SOLVER_CELLS * SOLVER_SIZE)
+#define DLX_NODES (1 + DLX_COLUMNS + 4 * DLX_ROWS)
+
+typedef struct {
+  uint16_t left[DLX_NODES];
+  uint16_t right[DLX_NODES];
+  uint16_t up[DLX_NODES];
+  uint16_t down[DLX_NODES];
+  uint16_t col[DLX_NODES];   // column header of each node
+  uint16_t row[DLX_NODES];   // matrix row of each node, cell * 9 + digit - 1
+  uint16_t size[DLX_COLUMNS + 1];
+} Dlx;
+
+// Called for every solution found, return non-zero to stop the search.
+typedef int (*DlxCallback)(const uint8_t *solution, void *ctx);
+
+Dlx *dlx_create(void);
+void dlx_destroy(Dlx *d);
+
+// Same as solver_count(), except for a limit of 0, which here means
+// no limit (solver_count() needs a limit of at least 1).
+size_t dlx_count(Dlx *d, const uint8_t *cells, size_t limit, uint8_t *solution, SolverStats *stats);
+
+// Calls `cb` on each solution of `cells`, up to `limit` of them (0 for
+// no limit). Returns the number of solutions visited.
+size_t dlx_enumerate(Dlx *d, const uint8_t *cells, size_t limit, DlxCallback cb, void *ctx, SolverStats *stats);
+
+#endif // DLX_H_
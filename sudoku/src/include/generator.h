@@ -0,0 +1,51 @@
+#ifndef GENERATOR_H_
+#define GENERATOR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "./solver.h"
+
+// Puzzle generator for the 9x9 sudoku.
+//
+// A random full grid is built from a seed, then clues are removed in
+// random order as long as the puzzle keeps a unique solution (and, for
+// the easier difficulties, as long as it stays solvable by singles
+// alone). The same seed and options always give the same puzzle.
+
+typedef enum {
+  DIFFICULTY_ANY = 0,  // any unique puzzle, as few clues as possible
+  DIFFICULTY_EASY,     // solvable with singles only, many clues
+  DIFFICULTY_MEDIUM,   // solvable with singles only, few clues
+  DIFFICULTY_HARD,     // needs guessing
+  DIFFICULTY_COUNT,
+} Difficulty;
+
+// easy puzzles stop removing clues here, whatever the target
+#define EASY_MIN_CLUES 36
+
+typedef struct {
+  Difficulty difficulty;
+  size_t clues;        // stop removing at this many clues, 0 for no target
+} GenOptions;
+
+// xoshiro256**
+typedef struct {
+  uint64_t s[4];
+} Rng;
+
+extern const char *DIFFICULTY_NAMES[DIFFICULTY_COUNT];
+
+void rng_seed(Rng *r, uint64_t seed);
+uint64_t rng_next(Rng *r);
+uint32_t rng_range(Rng *r, uint32_t n);
+
+void generate_grid(Rng *r, uint8_t *grid);
+
+// Writes a puzzle and (if not NULL) its solution, and returns the
+// number of clues of the puzzle. If `reached` is not NULL it gets the
+// difficulty of the puzzle: the one asked for, except for a hard
+// puzzle that could not be found in a few grids, which is medium.
+size_t generate_puzzle(uint64_t seed, const GenOptions *opts, uint8_t *puzzle, uint8_t *solution, Difficulty *reached);
+
+#endif // GENERATOR_H_
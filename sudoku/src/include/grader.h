@@ -0,0 +1,57 @@
+#ifndef GRADER_H_
+#define GRADER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "./solver.h"
+
+// Logical solver for the 9x9 sudoku, rating puzzles by the human
+// techniques they need.
+//
+// At each step the simplest technique that makes progress is applied,
+// and the search starts again from the singles. The hardest technique
+// used and how many times each one was needed give the difficulty of
+// the puzzle. No guessing is ever done: puzzles that need more than
+// these techniques are left partially solved.
+
+typedef enum {
+  TECH_NAKED_SINGLE = 0,
+  TECH_HIDDEN_SINGLE,
+  TECH_NAKED_PAIR,
+  TECH_HIDDEN_PAIR,
+  TECH_POINTING,       // candidates of a box confined to a row or column
+  TECH_BOX_LINE,       // candidates of a row or column confined to a box
+  TECH_NAKED_TRIPLE,
+  TECH_HIDDEN_TRIPLE,
+  TECH_X_WING,
+  TECH_XY_WING,
+  TECH_SWORDFISH,
+  TECH_COUNT,
+} Technique;
+
+typedef enum {
+  LEVEL_EASY = 0,      // singles only
+  LEVEL_MEDIUM,        // subsets and intersections
+  LEVEL_HARD,          // fish and wings
+  LEVEL_EXPERT,        // not solvable with the techniques above
+  LEVEL_INVALID,       // the clues contradict each other
+  LEVEL_COUNT,
+} Level;
+
+typedef struct {
+  uint32_t uses[TECH_COUNT];
+  int hardest;         // hardest technique used, -1 if none
+  uint32_t score;
+  Level level;
+  uint8_t cells[SOLVER_CELLS];  // the grid as far as it could be solved
+} Grade;
+
+extern const char *TECHNIQUE_NAMES[TECH_COUNT];
+extern const char *LEVEL_NAMES[LEVEL_COUNT];
+
+// Grades `cells` (as in solver.h). Returns 1 if the puzzle was solved
+// without guessing.
+int grade_puzzle(const uint8_t *cells, Grade *grade);
+
+#endif // GRADER_H_
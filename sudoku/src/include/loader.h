@@ -0,0 +1,54 @@
+#ifndef LOADER_H_
+#define LOADER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "./solver.h"
+
+// Puzzle files, memory mapped and parsed in place.
+//
+// Three formats are recognized from the first line of the file:
+//
+//   - boards: a rows,cols header followed by one line of comma
+//     separated values per row, with X for the empty cells (see
+//     data/board1.txt). A file can hold several boards of the same
+//     size one after the other.
+//
+//   - puzzles: a rows,cols,count header followed by one puzzle per
+//     line, either as rows * cols comma separated values, or as rows *
+//     cols characters where 0 or . is an empty cell, 1-9 are the
+//     digits and A-Z the values from 10 on.
+//
+//   - lines: no header, one 81-character 9x9 puzzle per line, as
+//     written by sudoku_gen.
+//
+// Opening a file builds the offset of each puzzle, after which a
+// Loader is read-only, so any number of threads can parse puzzles from
+// it at the same time.
+
+typedef enum {
+  LOADER_BOARDS = 0,
+  LOADER_PUZZLES,
+  LOADER_LINES,
+} LoaderFormat;
+
+typedef struct {
+  const char *data;
+  size_t size;
+  LoaderFormat format;
+
+  size_t rows;
+  size_t cols;
+  size_t *offsets;   // where each puzzle starts
+  size_t count;
+} Loader;
+
+void loader_open(Loader *l, const char *path);
+void loader_close(Loader *l);
+
+// Writes the rows * cols values of the i-th puzzle in `cells`, with 0
+// for the empty cells. Returns 0 if the puzzle is malformed.
+int loader_puzzle(const Loader *l, size_t i, uint8_t *cells);
+
+#endif // LOADER_H_
@@ -0,0 +1,25 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "./solver.h"
+#include "./pool.h"
+
+// Solution counting on a thread pool.
+//
+// The search tree is split at a shallow depth into many more subtrees
+// than workers, each of them counted as a task by the bitmask solver.
+// Idle workers steal the remaining subtrees from the busy ones, which
+// evens out the very different sizes of the subtrees. As soon as the
+// tasks have found `limit` solutions between them, a shared flag stops
+// all the searches still running.
+
+// Same semantics as solver_count_box(), except that a limit of 0 means
+// no limit. When the limit stops the search, which solution gets
+// written depends on the timing of the threads.
+size_t parallel_count(Pool *pool, size_t box, const uint8_t *cells, size_t limit,
+		      uint8_t *solution, SolverStats *stats);
+
+#endif // PARALLEL_H_
@@ -0,0 +1,62 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Fixed size thread pool with one task queue per worker.
+//
+// Tasks are pushed round-robin on the queues of the workers. A worker
+// takes tasks from the back of its own queue, and when that is empty
+// it steals from the front of the queues of the other workers.
+
+typedef void (*TaskFn)(void *arg, size_t worker);
+
+typedef struct {
+  TaskFn fn;
+  void *arg;
+} Task;
+
+typedef struct {
+  pthread_mutex_t lock;
+  Task *tasks;          // ring buffer
+  size_t head;
+  size_t count;
+  size_t capacity;
+} TaskQueue;
+
+typedef struct Pool Pool;
+
+typedef struct {
+  Pool *pool;
+  size_t id;
+  pthread_t thread;
+} Worker;
+
+struct Pool {
+  Worker *workers;
+  TaskQueue *queues;
+  size_t count;
+  atomic_size_t next;     // queue of the next round-robin submission
+
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t idle;
+  atomic_size_t queued;   // tasks waiting in the queues
+  atomic_size_t pending;  // tasks submitted and not yet completed
+  int quit;
+};
+
+size_t pool_default_threads(void);
+
+Pool *pool_create(size_t threads);
+void pool_destroy(Pool *p);
+
+void pool_submit(Pool *p, TaskFn fn, void *arg);
+void pool_submit_to(Pool *p, size_t worker, TaskFn fn, void *arg);
+
+// Waits until every submitted task has completed.
+void pool_wait(Pool *p);
+
+#endif // POOL_H_
@@ -0,0 +1,52 @@
+#ifndef PROPAGATE_H_
+#define PROPAGATE_H_
+
+#include <stdint.h>
+
+#include "./solver.h"
+
+// Vectorized naked/hidden singles propagation for the 9x9 sudoku.
+//
+// The candidates of the 81 cells are kept as 16-bit lanes (bit v set
+// if v is still possible), one 16-lane row of the grid per vector. The
+// three boxes of a row go in lanes 0-2, 4-6 and 8-10, so that each box
+// segment sits in its own 64-bit group and can be reduced without
+// crossing 128-bit boundaries. All the other lanes must be 0.
+//
+// The kernel comes in AVX2, SSE4.1 and scalar flavours, and the best
+// one supported by the CPU is picked at runtime.
+
+#define PROP_LANES 16
+#define PROP_LANE(x) (((x) / SOLVER_BOX) * 4 + (x) % SOLVER_BOX)
+
+typedef struct {
+  _Alignas(32) uint16_t rows[SOLVER_SIZE][PROP_LANES];
+} CandGrid;
+
+typedef enum {
+  PROP_SCALAR = 0,
+  PROP_SSE41,
+  PROP_AVX2,
+  PROP_IMPL_COUNT,
+} PropImpl;
+
+// One round of eliminations. Returns 1 if some candidate changed, 0
+// if the grid is at a fixed point and -1 on a contradiction.
+typedef int (*PropRoundFn)(CandGrid *g);
+
+extern const char *PROP_IMPL_NAMES[PROP_IMPL_COUNT];
+
+// Fills g with the candidates of a grid given as in solver.h.
+void prop_load(CandGrid *g, const uint8_t *cells);
+
+int prop_supported(PropImpl impl);
+PropImpl prop_best_impl(void);
+PropRoundFn prop_round_fn(PropImpl impl);
+
+// Runs rounds until a fixed point (returns the number of rounds, at
+// least 1) or a contradiction (returns -1), using the best
+// implementation for this CPU.
+int prop_fixpoint(CandGrid *g);
+int prop_fixpoint_with(PropRoundFn round, CandGrid *g);
+
+#endif // PROPAGATE_H_
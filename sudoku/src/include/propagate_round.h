@@ -0,0 +1,127 @@
+// Template of a propagation round, included by propagate.c once per
+// instruction set. Before including it, define:
+//
+//   V          the vector type holding one row of candidates
+//   PR(name)   decorates a function name with the instruction set
+//
+// and the PR() versions of these primitives:
+//
+//   vload, vstore, vzero, vset1, vor, vand, vandnot (~a & b),
+//   vsingles (0xFFFF where a lane has exactly one bit set),
+//   vzeros   (0xFFFF where a lane is 0),
+//   vany     (1 if any lane is not 0), veq (1 if all lanes are equal),
+//   vswap1   (swaps adjacent lanes),
+//   vswap2   (swaps pairs of lanes inside each 64-bit group),
+//   vswap64  (swaps the 64-bit groups inside each 128-bit half),
+//   vswap128 (swaps the two 128-bit halves)
+
+// Digits seen at least once (o) and at least twice (t).
+static inline void PR(combine)(V *o, V *t, V o2, V t2) {
+  *t = PR(vor)(PR(vor)(*t, t2), PR(vand)(*o, o2));
+  *o = PR(vor)(*o, o2);
+}
+
+// Reduces each box segment (64-bit group) and broadcasts the result
+// to all of its lanes.
+static inline void PR(reduce_group)(V *o, V *t) {
+  PR(combine)(o, t, PR(vswap1)(*o), PR(vswap1)(*t));
+  PR(combine)(o, t, PR(vswap2)(*o), PR(vswap2)(*t));
+}
+
+// Reduces the whole row and broadcasts the result to all of its lanes.
+static inline void PR(reduce_row)(V *o, V *t) {
+  PR(reduce_group)(o, t);
+  PR(combine)(o, t, PR(vswap64)(*o), PR(vswap64)(*t));
+  PR(combine)(o, t, PR(vswap128)(*o), PR(vswap128)(*t));
+}
+
+// Computes once/twice masks of the rows, columns and boxes of r.
+// Column masks are shared by all rows, box masks by the rows of a band.
+static inline void PR(reduce_units)(const V *r, V *row_o, V *row_t, V *col_o, V *col_t, V *box_o, V *box_t) {
+  *col_o = PR(vzero)();
+  *col_t = PR(vzero)();
+
+  for (int band = 0; band < SOLVER_BOX; band++) {
+    V o = PR(vzero)();
+    V t = PR(vzero)();
+
+    for (int k = 0; k < SOLVER_BOX; k++) {
+      int y = band * SOLVER_BOX + k;
+      PR(combine)(&o, &t, r[y], PR(vzero)());
+
+      row_o[y] = r[y];
+      row_t[y] = PR(vzero)();
+      PR(reduce_row)(&row_o[y], &row_t[y]);
+    }
+
+    PR(combine)(col_o, col_t, o, t);
+    PR(reduce_group)(&o, &t);
+    box_o[band] = o;
+    box_t[band] = t;
+  }
+}
+
+static int PR(prop_round)(CandGrid *g) {
+  V r[SOLVER_SIZE], old[SOLVER_SIZE], s[SOLVER_SIZE], single[SOLVER_SIZE];
+  V row_o[SOLVER_SIZE], row_t[SOLVER_SIZE], col_o, col_t;
+  V box_o[SOLVER_BOX], box_t[SOLVER_BOX];
+  V valid = PR(vload)(PROP_VALID_LANES);
+  V all = PR(vload)(PROP_ALL_DIGITS);
+  V bad = PR(vzero)();
+
+  for (int y = 0; y < SOLVER_SIZE; y++) {
+    old[y] = r[y] = PR(vload)(g->rows[y]);
+    single[y] = PR(vsingles)(r[y]);
+    s[y] = PR(vand)(r[y], single[y]);
+  }
+
+  // naked singles: remove the value of every solved cell from its
+  // units, and fail if two solved cells of a unit share a value
+  PR(reduce_units)(s, row_o, row_t, &col_o, &col_t, box_o, box_t);
+  bad = PR(vor)(bad, col_t);
+
+  for (int y = 0; y < SOLVER_SIZE; y++) {
+    V elim = PR(vor)(PR(vor)(row_o[y], col_o), box_o[y / SOLVER_BOX]);
+    bad = PR(vor)(PR(vor)(bad, row_t[y]), box_t[y / SOLVER_BOX]);
+    r[y] = PR(vandnot)(PR(vandnot)(single[y], elim), r[y]);
+
+    // a cell without candidates
+    bad = PR(vor)(bad, PR(vand)(PR(vzeros)(r[y]), valid));
+  }
+
+  if (PR(vany)(bad)) {
+    return -1;
+  }
+
+  // hidden singles: a value with a single place left in a unit goes
+  // there, and every unit must still have a place for every value
+  PR(reduce_units)(r, row_o, row_t, &col_o, &col_t, box_o, box_t);
+  bad = PR(vandnot)(col_o, all);
+
+  for (int y = 0; y < SOLVER_SIZE; y++) {
+    V ro = row_o[y], rt = row_t[y];
+    V bo = box_o[y / SOLVER_BOX], bt = box_t[y / SOLVER_BOX];
+    V hidden = PR(vor)(PR(vor)(PR(vandnot)(rt, ro), PR(vandnot)(col_t, col_o)), PR(vandnot)(bt, bo));
+    V h = PR(vand)(r[y], hidden);
+
+    bad = PR(vor)(bad, PR(vor)(PR(vandnot)(ro, all), PR(vandnot)(bo, all)));
+
+    // two hidden singles competing for the same cell
+    bad = PR(vor)(bad, PR(vandnot)(PR(vor)(PR(vsingles)(h), PR(vzeros)(h)), valid));
+
+    V keep = PR(vzeros)(h);
+    r[y] = PR(vor)(PR(vand)(keep, r[y]), PR(vandnot)(keep, h));
+  }
+
+  if (PR(vany)(bad)) {
+    return -1;
+  }
+
+  int changed = 0;
+  for (int y = 0; y < SOLVER_SIZE; y++) {
+    changed |= !PR(veq)(r[y], old[y]);
+    PR(vstore)(g->rows[y], r[y]);
+  }
+
+  return changed;
+}
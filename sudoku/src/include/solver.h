@@ -0,0 +1,74 @@
+#ifndef SOLVER_H_
+#define SOLVER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Backtracking solver for N^2 x N^2 sudokus, from the classic 9x9 up
+// to 36x36.
+//
+// Grids are passed around as arrays of size * size values, row by row,
+// where 0 is an empty cell and 1..size are the digits (the same
+// numbering used by CellValue). Boards are identified by the side of
+// their boxes, 3 for the classic one.
+
+#define SOLVER_SIZE 9
+#define SOLVER_BOX 3
+#define SOLVER_CELLS ((SOLVER_SIZE) * (SOLVER_SIZE))
+#define SOLVER_ALL_DIGITS 0x3FE  // bits 1..9
+
+#define SOLVER_MAX_BOX 6
+#define SOLVER_MAX_SIZE ((SOLVER_MAX_BOX) * (SOLVER_MAX_BOX))
+#define SOLVER_MAX_CELLS ((SOLVER_MAX_SIZE) * (SOLVER_MAX_SIZE))
+
+typedef enum {
+  SOLVER_PROP_AUTO = 0,  // kernel if the cpu has a vector version of it
+  SOLVER_PROP_LOOP,      // per-cell loops over the unit masks
+  SOLVER_PROP_KERNEL,    // vectorized kernel, see propagate.h
+} SolverPropagation;
+
+typedef struct {
+  uint64_t guesses;     // branches taken during the search
+  uint64_t propagations; // calls to the propagation step
+  uint64_t solutions;
+} SolverStats;
+
+// Writes the solution of `cells` in place. Returns 1 if the grid has
+// a solution, 0 otherwise (in which case `cells` is left untouched).
+int solver_solve(uint8_t *cells, SolverStats *stats);
+
+// Counts the solutions of `cells`, stopping as soon as `limit` of them
+// have been found. A limit of 2 is enough to check uniqueness. If
+// `solution` is not NULL, the first solution found is written there.
+size_t solver_count(const uint8_t *cells, size_t limit, uint8_t *solution, SolverStats *stats);
+
+// Same as solver_count() and solver_solve(), for the board with boxes
+// of side `box` (2 to SOLVER_MAX_BOX).
+size_t solver_count_box(size_t box, const uint8_t *cells, size_t limit, uint8_t *solution, SolverStats *stats);
+int solver_solve_box(size_t box, uint8_t *cells, SolverStats *stats);
+
+// Same as solver_count_box(), but the search also ends as soon as
+// `stop` is set, e.g. by another thread that found enough solutions.
+size_t solver_count_until(size_t box, const uint8_t *cells, size_t limit, uint8_t *solution,
+			  SolverStats *stats, const atomic_int *stop);
+
+// Called by solver_split() on each subproblem: the grid with the
+// digits placed along one path of the search, only valid during the
+// call.
+typedef void (*SolverSplitFn)(const uint8_t *cells, void *ctx);
+
+// Follows the first `depth` branching levels of the search for the
+// solutions of `cells`, and hands each grid reached at that depth (or
+// solved before it) to `fn`. The solutions of the subproblems are
+// disjoint and together are exactly those of `cells`. The guesses and
+// propagations it takes are added to `stats`, if not NULL. Returns the
+// number of subproblems.
+size_t solver_split(size_t box, const uint8_t *cells, int depth, SolverSplitFn fn, void *ctx, SolverStats *stats);
+
+// Selects how naked/hidden singles are propagated by the solver. Meant
+// to be called once at startup, before any solving happens. Boards
+// other than 9x9 always use the loops.
+void solver_set_propagation(SolverPropagation p);
+
+#endif // SOLVER_H_
@@ -0,0 +1,24 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include <stdint.h>
+#include <time.h>
+
+// Clocks of the headless tools. clock_gettime() needs _DEFAULT_SOURCE
+// (or _POSIX_C_SOURCE) to be defined before the first include.
+
+static inline double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// For the times of single puzzles, too short for a double of seconds
+// to keep every nanosecond.
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif // TIMING_H_
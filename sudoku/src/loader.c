@@ -0,0 +1,302 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "./include/loader.h"
+
+typedef uint8_t Bytes16 __attribute__((vector_size(16)));
+
+// The mapping is not NUL terminated, so every parser here is bounded
+// by the end of the file instead of relying on a terminator.
+
+// ----------------------------------------
+
+static const char *next_line(const Loader *l, const char *p) {
+  const char *end = l->data + l->size;
+  const char *nl = memchr(p, '\n', end - p);
+  return nl ? nl + 1 : end;
+}
+
+static const char *parse_size(const char *p, const char *end, size_t *value) {
+  const char *start = p;
+  *value = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    *value = *value * 10 + (*p++ - '0');
+  }
+  return p == start ? NULL : p;
+}
+
+static const char *skip_blanks(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\r')) {
+    p++;
+  }
+  return p;
+}
+
+// Parses a rows,cols or rows,cols,count header. Returns the number of
+// fields, or 0 if the line is not a header.
+static int parse_header(const char *p, const char *end, size_t *rows, size_t *cols, size_t *count) {
+  if (!(p = parse_size(p, end, rows)) || p == end || *p != ',') {
+    return 0;
+  }
+  if (!(p = parse_size(p + 1, end, cols))) {
+    return 0;
+  }
+
+  p = skip_blanks(p, end);
+  if (p < end && *p == ',') {
+    if (!(p = parse_size(p + 1, end, count))) {
+      return 0;
+    }
+    p = skip_blanks(p, end);
+    return (p == end || *p == '\n') ? 3 : 0;
+  }
+
+  return (p == end || *p == '\n') ? 2 : 0;
+}
+
+// Value of a cell written as a single character, -1 if invalid.
+static int char_value(char c) {
+  if (c == '.' || c == '0') {
+    return 0;
+  } else if (c >= '1' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'A' && c <= 'Z') {
+    return c - 'A' + 10;
+  } else if (c >= 'a' && c <= 'z') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// Parses a line of `n` comma separated values, each either a number up
+// to `max` or X/. for an empty cell. Returns the start of the next
+// line, or NULL if the line is malformed.
+static const char *parse_csv(const char *p, const char *end, uint8_t *cells, size_t n, size_t max) {
+  for (size_t k = 0; k < n; k++) {
+    size_t value = 0;
+
+    p = skip_blanks(p, end);
+    if (p < end && (*p == 'X' || *p == '.')) {
+      p++;
+    } else if (!(p = parse_size(p, end, &value)) || value > max) {
+      return NULL;
+    }
+    cells[k] = value;
+
+    p = skip_blanks(p, end);
+    if (k + 1 < n) {
+      if (p == end || *p != ',') {
+	return NULL;
+      }
+      p++;
+    }
+  }
+
+  if (p < end && *p != '\n') {
+    return NULL;
+  }
+  return p < end ? p + 1 : p;
+}
+
+// Parses a line of `n` single character cells (see char_value()), up
+// to `max`. Returns the start of the next line, or NULL if the line is
+// malformed.
+static const char *parse_compact(const char *p, const char *end, uint8_t *cells, size_t n, size_t max) {
+  if ((size_t) (end - p) < n) {
+    return NULL;
+  }
+
+  // fast pass for the common case of digits and dots, 16 characters at
+  // a time, falling back to char_value() if anything else shows up
+  uint8_t limit = max < 9 ? max : 9;
+  Bytes16 slow16 = { 0 };
+  size_t k = 0;
+
+  for (; k + 16 <= n; k += 16) {
+    Bytes16 c, value;
+    memcpy(&c, p + k, 16);
+    value = (c - '0') & ~(Bytes16) (c == '.');
+    slow16 |= (Bytes16) (value > limit);
+    memcpy(cells + k, &value, 16);
+  }
+
+  int slow = 0;
+  for (int j = 0; j < 16; j++) {
+    slow |= slow16[j];
+  }
+  for (; k < n; k++) {
+    uint8_t value = p[k] == '.' ? 0 : (uint8_t) p[k] - '0';
+    slow |= value > limit;
+    cells[k] = value;
+  }
+
+  for (size_t k = 0; slow && k < n; k++) {
+    int value = char_value(p[k]);
+    if (value < 0 || (size_t) value > max) {
+      return NULL;
+    }
+    cells[k] = value;
+  }
+
+  // like parse_csv(), nothing but blanks may follow on the line
+  p = skip_blanks(p + n, end);
+  if (p < end && *p != '\n') {
+    return NULL;
+  }
+  return p < end ? p + 1 : p;
+}
+
+// ----------------------------------------
+
+static void push_offset(Loader *l, size_t *capacity, size_t offset) {
+  if (l->count == *capacity) {
+    *capacity = *capacity ? *capacity * 2 : 1024;
+    l->offsets = realloc(l->offsets, *capacity * sizeof(size_t));
+  }
+  l->offsets[l->count++] = offset;
+}
+
+static void index_puzzles(Loader *l, const char *path) {
+  const char *end = l->data + l->size;
+  const char *p = l->data;
+  size_t capacity = 0;
+  size_t rows, cols, expected = 0;
+
+  switch (l->format) {
+  case LOADER_BOARDS: {
+    while (p < end) {
+      if (*p == '\n' || *p == '\r') {
+	p = next_line(l, p);
+	continue;
+      }
+
+      if (parse_header(p, end, &rows, &cols, &expected) != 2 || rows != l->rows || cols != l->cols) {
+	fprintf(stderr, "ERROR: expected a %zu,%zu header in %s (offset %zu)\n",
+		l->rows, l->cols, path, (size_t) (p - l->data));
+	exit(1);
+      }
+
+      push_offset(l, &capacity, p - l->data);
+      for (size_t y = 0; y <= rows; y++) {
+	p = next_line(l, p);
+      }
+    }
+    break;
+  }
+  case LOADER_PUZZLES: {
+    parse_header(p, end, &rows, &cols, &expected);
+    capacity = expected;
+    l->offsets = malloc((capacity ? capacity : 1) * sizeof(size_t));
+
+    for (p = next_line(l, p); p < end; p = next_line(l, p)) {
+      if (*p != '\n' && *p != '\r') {
+	push_offset(l, &capacity, p - l->data);
+      }
+    }
+
+    if (l->count != expected) {
+      fprintf(stderr, "ERROR: %s declares %zu puzzles but has %zu\n", path, expected, l->count);
+      exit(1);
+    }
+    break;
+  }
+  case LOADER_LINES: {
+    for (; p < end; p = next_line(l, p)) {
+      // blank or short lines are skipped
+      const char *next = next_line(l, p);
+      if (next - p >= SOLVER_CELLS) {
+	push_offset(l, &capacity, p - l->data);
+      }
+    }
+    break;
+  }
+  }
+}
+
+void loader_open(Loader *l, const char *path) {
+  memset(l, 0, sizeof(*l));
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR: could not open file %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    fprintf(stderr, "ERROR: could not stat file %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+
+  l->size = st.st_size;
+  l->data = l->size ? mmap(NULL, l->size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+  close(fd);
+
+  if (l->data == MAP_FAILED) {
+    fprintf(stderr, "ERROR: could not mmap file %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+
+  if (l->size) {
+    madvise((void *) l->data, l->size, MADV_SEQUENTIAL);
+  }
+
+  size_t count;
+  int fields = parse_header(l->data, l->data + l->size, &l->rows, &l->cols, &count);
+
+  if (fields == 0) {
+    l->format = LOADER_LINES;
+    l->rows = l->cols = SOLVER_SIZE;
+  } else {
+    l->format = fields == 2 ? LOADER_BOARDS : LOADER_PUZZLES;
+    if (!l->rows || !l->cols || l->rows > SOLVER_MAX_SIZE || l->cols > SOLVER_MAX_SIZE) {
+      fprintf(stderr, "ERROR: grids must be between 1x1 and %dx%d, %s has %zux%zu\n",
+	      SOLVER_MAX_SIZE, SOLVER_MAX_SIZE, path, l->rows, l->cols);
+      exit(1);
+    }
+  }
+
+  index_puzzles(l, path);
+}
+
+void loader_close(Loader *l) {
+  if (l->size) {
+    munmap((void *) l->data, l->size);
+  }
+  free(l->offsets);
+  memset(l, 0, sizeof(*l));
+}
+
+int loader_puzzle(const Loader *l, size_t i, uint8_t *cells) {
+  const char *p = l->data + l->offsets[i];
+  const char *end = l->data + l->size;
+  size_t n = l->rows * l->cols;
+  size_t max = l->rows > l->cols ? l->rows : l->cols;
+
+  switch (l->format) {
+  case LOADER_BOARDS: {
+    p = next_line(l, p);
+    for (size_t y = 0; p && y < l->rows; y++) {
+      p = parse_csv(p, end, cells + y * l->cols, l->cols, max);
+    }
+    return p != NULL;
+  }
+  case LOADER_PUZZLES: {
+    const char *nl = memchr(p, '\n', end - p);
+    int csv = memchr(p, ',', (nl ? nl : end) - p) != NULL;
+    return (csv ? parse_csv(p, end, cells, n, max) : parse_compact(p, end, cells, n, max)) != NULL;
+  }
+  case LOADER_LINES:
+    return parse_compact(p, end, cells, n, max) != NULL;
+  }
+
+  return 0;
+}
@@ -8,16 +8,17 @@
 #include <string.h>
 #include <assert.h>
 
+#include "./include/solver.h"
+#include "./include/generator.h"
+#include "./include/loader.h"
+
 #define BOARD_PATH "./data/sol1.txt"
 
 #define SCREEN_WIDTH  900
 #define SCREEN_HEIGHT 900
 
-#define BOARD_COLS 9
-#define BOARD_ROWS 9
-
-#define CELL_WIDTH ((SCREEN_WIDTH / BOARD_COLS))
-#define CELL_HEIGHT ((SCREEN_HEIGHT / BOARD_ROWS))
+#define CELL_WIDTH(g) ((SCREEN_WIDTH / (g).cols))
+#define CELL_HEIGHT(g) ((SCREEN_HEIGHT / (g).rows))
 
 #define FIXED_VALUE_COLOR BLACK
 #define DYNAMIC_VALUE_COLOR BLACK
@@ -35,7 +36,9 @@ typedef enum {
   V_7,
   V_8,
   V_9,
-  V_INVALID,  
+  // larger boards go up to V_MAX, values are only named up to 9
+  V_MAX = SOLVER_MAX_SIZE,
+  V_INVALID,
 } CellValue;
 
 typedef enum {
@@ -61,46 +64,75 @@ typedef enum {
   D_LEFT,    
 } Dir;
 
-typedef enum {
-  E_NONE = 0,
-  E_ROW,
-  E_COL,
-  E_SQUARE,
-} ErrorType;
-
+// Constraint state of a single row, column or box, kept up to date
+// on every write to the grid.
 typedef struct {
-  ErrorType type;  
-  size_t index;  
-} Error;
+  uint64_t used;     // bit v is set if value v appears in the unit
+  uint64_t dups;     // bit v is set if value v appears more than once
+  uint8_t count[V_INVALID];
+} Unit;
 
 typedef struct {
   size_t cols;
   size_t rows;
+  size_t box;        // side of a box, 0 if the board has no boxes
   Cell *grid;
+
+  Unit *row_units;
+  Unit *col_units;
+  Unit *box_units;
+  size_t conflicts;  // number of units with at least one duplicate
+  size_t filled;     // number of cells with a value
   
   Pos select;
-  Error error;
+  CellValue typed;   // value being typed in the selected cell
   uint8_t victory;
 } Game;
 
+typedef enum {
+  BG_NONE = 0,
+  BG_SELECTED,
+  BG_ERROR,
+  BG_VICTORY,
+} CellBackground;
+
+typedef struct {
+  RenderTexture2D board;   // what ends up on screen
+  RenderTexture2D lines;   // grid lines over a transparent background
+  RenderTexture2D glyphs;  // a cell-sized glyph per value and cell type
+  uint16_t *looks;         // look of each cell as last drawn on board
+  uint8_t victory;
+} View;
+
 //----------------------------------------------------------------------------------
 
-Game game_init_from_file(const char *path);
+Game game_init_from_file(const char *path, size_t index);
 Game game_init(size_t cols, size_t rows);
 void game_close(Game g);
 Game game_check_and_set_selection(Game g, Pos pos);
 Game game_check_and_set_value(Game g, CellValue value, CellType type);
-Game game_check_and_set_error(Game g);
+Game game_clear_value(Game g);
 Game game_check_and_set_victory(Game g);
+Game game_solve(Game g);
+Game game_set_cell(Game g, Pos pos, Cell c);
+uint64_t game_candidates(Game g, Pos pos);
+
+void unit_add(Game *g, Unit *u, CellValue value);
+void unit_remove(Game *g, Unit *u, CellValue value);
 
-void grid_fill(Game g, CellValue val);
-void grid_rand(Game g, size_t low, size_t high);
+Game grid_fill(Game g, CellValue val);
+Game grid_rand(Game g, uint64_t seed);
 
 void grid_render_lines(Game g);
-void grid_render_values(Game g);
-void game_render(Game g);
+void grid_render_glyphs(Game g);
+
+uint16_t cell_look(Game g, size_t x, size_t y);
+View view_init(Game g);
+View view_update(View v, Game g);
+void view_render(View v);
+void view_close(View v);
 
-Pos coords_to_pos(Vector2 vpos);
+Pos coords_to_pos(Game g, Vector2 vpos);
 CellValue char_to_value(char keyPress);
 Pos next_pos(Game g, Dir dir);
 
@@ -109,6 +141,8 @@ Pos next_pos(Game g, Dir dir);
 #define CELL_IS_DYNAMIC(g, pos) ((g).grid[(pos).y * (g).cols + (pos).x].type == DYNAMIC)
 #define SELECTED_CELL_IS_DYNAMIC(g) CELL_IS_DYNAMIC((g), (g).select)
 #define IS_OVER(g) ((g).victory == 1)
+#define BOX_INDEX(g, x, y) (((y) / (g).box) * ((g).cols / (g).box) + ((x) / (g).box))
+#define ALL_VALUES_MASK(g) (((2ULL << (g).cols) - 1) & ~1ULL)
 
 //----------------------------------------------------------------------------------
 
@@ -117,16 +151,40 @@ Game game_init(size_t cols, size_t rows) {
   g.cols = cols;
   g.rows = rows;
   g.grid = calloc(cols * rows, sizeof(Cell));
+
+  // boxes are only defined for square boards whose side is itself a
+  // square, from 4x4 up to 36x36
+  for (size_t b = 2; b <= SOLVER_MAX_BOX; b++) {
+    if (cols == rows && cols == b * b) {
+      g.box = b;
+    }
+  }
+  g.row_units = calloc(rows, sizeof(Unit));
+  g.col_units = calloc(cols, sizeof(Unit));
+  g.box_units = g.box ? calloc((rows / g.box) * (cols / g.box), sizeof(Unit)) : NULL;
+
   g.select = (Pos){-1, -1};
-  g.error = (Error){ E_NONE, 0 };  
   return g;
 }
 
-void game_close(Game g) { free(g.grid); }
+void game_close(Game g) {
+  free(g.grid);
+  free(g.row_units);
+  free(g.col_units);
+  free(g.box_units);
+}
 
 Game game_check_and_set_selection(Game g, Pos pos) {
+  // clicks past the last cell of the board
+  if (pos.x >= g.cols || pos.y >= g.rows) {
+    return g;
+  }
+
   // only select to dynamic cells
   if (CELL_IS_DYNAMIC(g, pos)) {
+    if (pos.x != g.select.x || pos.y != g.select.y) {
+      g.typed = V_NONE;
+    }
     g.select = pos;    
   }
 
@@ -135,184 +193,194 @@ Game game_check_and_set_selection(Game g, Pos pos) {
 
 Game game_check_and_set_value(Game g, CellValue value, CellType type) {
   if (HAS_SELECTED_CELL(g) && SELECTED_CELL_IS_DYNAMIC(g) && (value != V_INVALID)) {
-    g.grid[g.select.y * g.cols + g.select.x] = (Cell){ value, type };
+    // on boards larger than 9x9, digits typed in a row on the same
+    // cell make up a single value
+    if (g.typed * 10 + value <= g.cols) {
+      value = g.typed * 10 + value;
+    }
+    g.typed = value;
+    g = game_set_cell(g, g.select, (Cell){ value, type });
   }
   return g;
 }
 
-Game game_check_and_set_error(Game g) {
-  g.error = (Error) { E_NONE, 0 };
- 
-  // each row, colum and square must contain 9 distinct digits, from 1 through 9.
-  
-  // check rows
-  for(int y = 0; y < g.rows; y++) {
-    size_t seen[10] = { 0 };
-    for(int x = 0; x < g.cols; x++) {
-      Cell c = g.grid[y * g.cols + x];
-      if (HAS_VALUE(c)) {
-	seen[c.value] += 1;
-	if (seen[c.value] > 1) {
-	  g.error = (Error) { E_ROW, y };
-	}
-      }
+// Clears the selected cell whatever was typed before, as on boards
+// larger than 9x9 a 0 after a 1 writes 10.
+Game game_clear_value(Game g) {
+  g.typed = V_NONE;
+  return game_check_and_set_value(g, V_NONE, DYNAMIC);
+}
+
+// each row, colum and square must contain distinct digits, from 1
+// through the side of the board. Instead of scanning the whole grid,
+// we keep for each unit how many times each value appears, and we
+// track how many units contain a duplicate.
+void unit_add(Game *g, Unit *u, CellValue value) {
+  u->count[value] += 1;
+  u->used |= 1ULL << value;
+
+  if (u->count[value] == 2) {
+    if (!u->dups) {
+      g->conflicts += 1;
     }
+    u->dups |= 1ULL << value;
   }
+}
 
-  // check cols
-  for(int x = 0; x < g.cols; x++) {
-    size_t seen[10] = { 0 };
-    for(int y = 0; y < g.rows; y++) {
-      Cell c = g.grid[y * g.cols + x];
-      if (HAS_VALUE(c)) {
-	seen[c.value] += 1;
-	if (seen[c.value] > 1) {
-	  g.error = (Error) { E_COL, x };
-	}
-      }
+void unit_remove(Game *g, Unit *u, CellValue value) {
+  u->count[value] -= 1;
+
+  if (u->count[value] == 0) {
+    u->used &= ~(1ULL << value);
+  } else if (u->count[value] == 1) {
+    u->dups &= ~(1ULL << value);
+    if (!u->dups) {
+      g->conflicts -= 1;
     }
   }
+}
 
-  // TODO: check squares only if we have a special type of square grid
-  // NOTE: for now we have hard-coded a value of 3
-  if (BOARD_COLS == BOARD_ROWS) {
-    for (int i = 0; i < 9; i++) {
-      size_t seen[10] = { 0 };
-
-      size_t start_y = floorf(i / 3) * 3;
-      size_t start_x = (i % 3) * 3;                
-
-      // printf("(%d, %d)\n", start_x, start_y);
-      for (size_t y = start_y; y < start_y + 3; y++) {
-	for (size_t x = start_x; x < start_x + 3; x++) {
-	  Cell c = g.grid[y * g.cols + x];
-	  if (HAS_VALUE(c)) {
-	    seen[c.value] += 1;
-	    if (seen[c.value] > 1) {
-	      g.error = (Error) { E_SQUARE, i };
-	    }
-	  }
-	}
-      }      
-    }    
+// Every write to the grid goes through here, so that the units are
+// always consistent with it.
+Game game_set_cell(Game g, Pos pos, Cell c) {
+  Cell *old = &g.grid[pos.y * g.cols + pos.x];
+
+  if (HAS_VALUE(*old)) {
+    unit_remove(&g, &g.row_units[pos.y], old->value);
+    unit_remove(&g, &g.col_units[pos.x], old->value);
+    if (g.box) {
+      unit_remove(&g, &g.box_units[BOX_INDEX(g, pos.x, pos.y)], old->value);
+    }
+    g.filled -= 1;
   }
-    
+
+  if (HAS_VALUE(c)) {
+    unit_add(&g, &g.row_units[pos.y], c.value);
+    unit_add(&g, &g.col_units[pos.x], c.value);
+    if (g.box) {
+      unit_add(&g, &g.box_units[BOX_INDEX(g, pos.x, pos.y)], c.value);
+    }
+    g.filled += 1;
+  }
+
+  *old = c;
   return g;
-};
-  
+}
+
+// Values that can still be written in pos without creating a conflict.
+uint64_t game_candidates(Game g, Pos pos) {
+  uint64_t used = g.row_units[pos.y].used | g.col_units[pos.x].used;
+  if (g.box) {
+    used |= g.box_units[BOX_INDEX(g, pos.x, pos.y)].used;
+  }
+  return ALL_VALUES_MASK(g) & ~used;
+}
+
 Game game_check_and_set_victory(Game g) {
-  if (g.error.type != E_NONE) {
-    g.victory = 0;
-  } else {
-    g.victory = 1;
-    for (int y = 0; y < g.rows; y++) {
-      for (int x = 0; x < g.cols; x++) {
-	if (g.grid[y * g.cols + x].value == V_NONE) {
-	  g.victory = 0;
-	}
+  g.victory = g.conflicts == 0 && g.filled == g.rows * g.cols;
+  return g;
+};
+
+// Fills every dynamic cell with the solution of the puzzle given by
+// the fixed cells, overwriting whatever the player wrote.
+Game game_solve(Game g) {
+  uint8_t cells[SOLVER_MAX_CELLS] = { 0 };
+
+  if (!g.box) {
+    fprintf(stderr, "ERROR: solver only supports grids with boxes\n");
+    return g;
+  }
+
+  for (size_t i = 0; i < g.rows * g.cols; i++) {
+    if (g.grid[i].type == FIXED) {
+      cells[i] = g.grid[i].value;
+    }
+  }
+
+  if (!solver_solve_box(g.box, cells, NULL)) {
+    fprintf(stderr, "ERROR: puzzle has no solution\n");
+    return g;
+  }
+
+  for (size_t y = 0; y < g.rows; y++) {
+    for (size_t x = 0; x < g.cols; x++) {
+      if (CELL_IS_DYNAMIC(g, ((Pos){ x, y }))) {
+	g = game_set_cell(g, (Pos){ x, y }, (Cell){ cells[y * g.cols + x], DYNAMIC });
       }
     }
   }
-  
+
   return g;
-};
+}
 
-void grid_fill(Game g, CellValue val) {
+Game grid_fill(Game g, CellValue val) {
   for (size_t y = 0; y < g.rows; y++) {
     for (size_t x = 0; x < g.cols; x++) {
-      g.grid[y * g.cols + x] = (Cell){ V_NONE, DYNAMIC };
+      g = game_set_cell(g, (Pos){ x, y }, (Cell){ val, DYNAMIC });
     }
   }
+  return g;
 }
 
-// TODO: implement this properly
-// void grid_rand(Game g, size_t low, size_t high) {
-//   for (size_t y = 0; y < g.rows; y++) {
-//     for (size_t x = 0; x < g.cols; x++) {
-//       g.grid[y * g.cols + x] = low + (rand() % (high - low));      
-//     }
-//   }
-// }
+// Replaces the board with a freshly generated puzzle.
+Game grid_rand(Game g, uint64_t seed) {
+  uint8_t puzzle[SOLVER_CELLS];
+  GenOptions opts = { .difficulty = DIFFICULTY_MEDIUM };
 
-Game game_init_from_file(const char *path) {
-  FILE *f = fopen(path,"r");
-
-  if (f == NULL) {
-    fprintf(stderr, "ERROR: could not open file %s: %s\n", path, strerror(errno));
-    exit(1);
+  if (g.cols != SOLVER_SIZE || g.rows != SOLVER_SIZE) {
+    fprintf(stderr, "ERROR: generator only supports %dx%d grids\n", SOLVER_SIZE, SOLVER_SIZE);
+    return g;
   }
 
-  char *line;
-  size_t len = 0;
-  size_t read;
-  
-  read = getline(&line, &len, f);
+  generate_puzzle(seed, &opts, puzzle, NULL, NULL);
 
-  if (read == -1) {
-    fprintf(stderr, "ERROR: could not read line %d from %s: %s\n", 0, path, strerror(errno));
-    exit(1);
+  for (size_t y = 0; y < g.rows; y++) {
+    for (size_t x = 0; x < g.cols; x++) {
+      CellValue v = puzzle[y * g.cols + x];
+      g = game_set_cell(g, (Pos){ x, y }, (Cell){ v, v == V_NONE ? DYNAMIC : FIXED });
+    }
   }
-    
-  char *rows_str = strtok(line, ",");
-  char *cols_str = strtok(NULL, ",");
-  char *null_str = strtok(NULL, ",");
+  g.select = (Pos){-1, -1};
 
-  if (!rows_str || !cols_str || null_str) {
-    fprintf(stderr, "ERROR: grid file not properly formatted %s\n", path);
-    exit(1);      
-  }
+  return g;
+}
 
-  // NOTE: should more checks be needed here?
-  int rows, cols;  
-  rows = atoi(rows_str);
-  cols = atoi(cols_str);
+// Loads the index-th puzzle of a file, see loader.h for the formats.
+Game game_init_from_file(const char *path, size_t index) {
+  Loader l;
+  loader_open(&l, path);
 
-  if (!rows) {
-    fprintf(stderr, "ERROR: could not atoi rows value (%s)\n", rows_str);
-    exit(1);      
+  if (index >= l.count) {
+    fprintf(stderr, "ERROR: could not load puzzle %zu, %s has %zu\n", index, path, l.count);
+    exit(1);
   }
 
-  if (!cols) {
-    fprintf(stderr, "ERROR: could not atoi cols value (%s)\n", cols_str);
-    exit(1);      
-  }    
-
-  Game g = game_init(cols, rows);
-  
-  // NOTE: probably more checks needed here
-  for (size_t y = 0; y < g.rows; y++) {
-    read = getline(&line, &len, f);
+  uint8_t cells[SOLVER_MAX_CELLS];
+  if (!loader_puzzle(&l, index, cells)) {
+    fprintf(stderr, "ERROR: puzzle %zu of %s not properly formatted\n", index, path);
+    exit(1);
+  }
 
-    if (read == -1) {
-      fprintf(stderr, "ERROR: could not read line %d from %s: %s\n", y+1, path, strerror(errno));
-      exit(1);
-    }
+  Game g = game_init(l.cols, l.rows);
 
+  for (size_t y = 0; y < g.rows; y++) {
     for (size_t x = 0; x < g.cols; x++) {
-      char *value_str = strtok(x == 0 ? line : NULL, ",");
-      CellValue val;
-      if (*value_str == 'X') {
-	g.grid[y * g.cols + x] = (Cell){ V_NONE, DYNAMIC };
-      } else if ((val = char_to_value(*value_str)) != V_INVALID) {
-	g.grid[y * g.cols + x] = (Cell){ val, FIXED };
-      } else {
-	fprintf(stderr, "ERROR: Invalid value found (%c) when reading file %s \n", *value_str, path);
-	exit(1);
-      }
+      CellValue v = cells[y * g.cols + x];
+      g = game_set_cell(g, (Pos){ x, y }, (Cell){ v, v == V_NONE ? DYNAMIC : FIXED });
     }
   }
-  
-  fclose(f);
+
+  loader_close(&l);
 
   return g;
 }
 
 //----------------------------------------------------------------------------------
 
-Pos coords_to_pos(Vector2 vpos) {
+Pos coords_to_pos(Game g, Vector2 vpos) {
   Pos pos = { 0 };
-  pos.x = floorf(vpos.x / CELL_WIDTH);
-  pos.y = floorf(vpos.y / CELL_HEIGHT);
+  pos.x = floorf(vpos.x / CELL_WIDTH(g));
+  pos.y = floorf(vpos.y / CELL_HEIGHT(g));
   return pos;
 }
 
@@ -371,6 +439,32 @@ Pos next_pos(Game g, Dir dir) {
 
 //----------------------------------------------------------------------------------
 
+// The board is drawn once into a render texture and then only the
+// cells whose look changed are drawn again, so that an idle frame is a
+// single texture copy. Grid lines and digits are also rendered once,
+// in their own textures, and copied over each redrawn cell.
+
+#define LOOK(value, type, bg) ((value) | (type) << 6 | (bg) << 7)
+#define LOOK_VALUE(look) ((look) & 0x3f)
+#define LOOK_TYPE(look) (((look) >> 6) & 1)
+#define LOOK_BG(look) ((look) >> 7)
+// no cell has this look, so a cell marked with it is drawn again
+#define LOOK_STALE 0xffff
+
+static const Color BACKGROUND_COLORS[] = {
+  [BG_NONE]     = RAYWHITE,
+  [BG_SELECTED] = LIGHTGRAY,
+  [BG_ERROR]    = RED,
+  [BG_VICTORY]  = GREEN,
+};
+
+// Render textures are stored upside down, this copies the w*h region
+// of rt at (x, y) to pos the right way up.
+void draw_region(RenderTexture2D rt, size_t x, size_t y, size_t w, size_t h, Vector2 pos) {
+  Rectangle src = { x, (float)rt.texture.height - y - h, w, -(float)h };
+  DrawTextureRec(rt.texture, src, pos, WHITE);
+}
+
 void grid_render_lines(Game g) {
 
   size_t thick_bold = 5;
@@ -378,106 +472,155 @@ void grid_render_lines(Game g) {
 
   // horizontal lines (moving through rows)
   for (size_t y = 1; y < g.rows; y++) {
-    Vector2 startPos = { 0, y*CELL_HEIGHT };
-    Vector2 endPos = { SCREEN_WIDTH, y*CELL_HEIGHT };
-    size_t thickness = y % 3 == 0 ? thick_bold : thick_light;
+    Vector2 startPos = { 0, y*CELL_HEIGHT(g) };
+    Vector2 endPos = { SCREEN_WIDTH, y*CELL_HEIGHT(g) };
+    size_t thickness = g.box && y % g.box == 0 ? thick_bold : thick_light;
     DrawLineEx(startPos, endPos, thickness, BLACK);
   }
 
   // vertical lines (moving through cols)  
   for (size_t x = 1; x < g.cols; x++) {
-    Vector2 startPos = { x*CELL_WIDTH, 0 };
-    Vector2 endPos = { x*CELL_WIDTH, SCREEN_HEIGHT };
-    size_t thickness = x % 3 == 0 ? thick_bold : thick_light;    
+    Vector2 startPos = { x*CELL_WIDTH(g), 0 };
+    Vector2 endPos = { x*CELL_WIDTH(g), SCREEN_HEIGHT };
+    size_t thickness = g.box && x % g.box == 0 ? thick_bold : thick_light;    
     DrawLineEx(startPos, endPos, thickness, BLACK);
   }
 }
 
-void grid_render_values(Game g) {
-  for (size_t y = 0; y < g.rows; y++) {
-    for (size_t x = 0; x < g.cols; x++) {
-      CellValue val = g.grid[y * g.cols + x].value;
-      CellType type = g.grid[y * g.cols + x].type;
-      if (val != V_NONE) {
-	char text[80];
-	sprintf(text, "%u", val);
-	size_t posX = floorf(x * CELL_WIDTH + 0.35f*CELL_WIDTH);
-	size_t posY = floorf(y * CELL_HEIGHT + 0.30f*CELL_HEIGHT);
-
-	DrawText(text, posX, posY, 50, type == FIXED ? FIXED_VALUE_COLOR : DYNAMIC_VALUE_COLOR);
-      }
+// Value v of type t goes at column v - 1 and row t of the atlas.
+void grid_render_glyphs(Game g) {
+  size_t font_size = CELL_HEIGHT(g) / 2;
+
+  for (CellType type = FIXED; type <= DYNAMIC; type++) {
+    for (size_t val = 1; val <= g.cols; val++) {
+      char text[8];
+      snprintf(text, sizeof(text), "%zu", val);
+      size_t posX = (val - 1) * CELL_WIDTH(g) + (CELL_WIDTH(g) - MeasureText(text, font_size)) / 2;
+      size_t posY = type * CELL_HEIGHT(g) + (CELL_HEIGHT(g) - font_size) / 2;
+
+      DrawText(text, posX, posY, font_size, type == FIXED ? FIXED_VALUE_COLOR : DYNAMIC_VALUE_COLOR);
     }
   }
 }
 
-void grid_render_error(Game g) {
-  size_t posX, posY;  
-  switch(g.error.type)  {
-  case E_NONE:
-    break;
-    
-  case E_ROW:
-    posX = 0;
-    posY = g.error.index * CELL_HEIGHT;
-    DrawRectangle(posX, posY, BOARD_COLS*CELL_WIDTH, CELL_HEIGHT, RED);
-    break;
+uint16_t cell_look(Game g, size_t x, size_t y) {
+  Cell c = g.grid[y * g.cols + x];
+  CellBackground bg = BG_NONE;
 
-  case E_COL:
-    posX = g.error.index * CELL_WIDTH;
-    posY = 0;
-    DrawRectangle(posX, posY, CELL_WIDTH, BOARD_ROWS*CELL_HEIGHT, RED);
-    break;
+  if (IS_OVER(g)) {
+    bg = BG_VICTORY;
+  } else if (g.row_units[y].dups || g.col_units[x].dups ||
+	     (g.box && g.box_units[BOX_INDEX(g, x, y)].dups)) {
+    bg = BG_ERROR;
+  } else if (g.select.x == x && g.select.y == y) {
+    bg = BG_SELECTED;
+  }
 
-  case E_SQUARE:
-    posX = (g.error.index % 3) * 3 * CELL_WIDTH;
-    posY = floorf(g.error.index / 3) * 3 * CELL_HEIGHT;    
-    DrawRectangle(posX, posY, CELL_WIDTH*3, CELL_HEIGHT*3, RED);
-    break;
+  return LOOK(HAS_VALUE(c) ? c.value : V_NONE, c.type, bg);
+}
 
-  default:
-    assert(0 && "Unreachable\n");
-    break;
+void view_render_cell(View v, Game g, size_t x, size_t y, uint16_t look) {
+  Vector2 pos = { x * CELL_WIDTH(g), y * CELL_HEIGHT(g) };
+
+  DrawRectangle(pos.x, pos.y, CELL_WIDTH(g), CELL_HEIGHT(g), BACKGROUND_COLORS[LOOK_BG(look)]);
+  draw_region(v.lines, pos.x, pos.y, CELL_WIDTH(g), CELL_HEIGHT(g), pos);
+
+  if (LOOK_VALUE(look) != V_NONE) {
+    draw_region(v.glyphs, (LOOK_VALUE(look) - 1) * CELL_WIDTH(g), LOOK_TYPE(look) * CELL_HEIGHT(g),
+		CELL_WIDTH(g), CELL_HEIGHT(g), pos);
   }
-  
 }
 
-void game_render(Game g) {
-  if (IS_OVER(g)) {
-    DrawRectangle(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, GREEN);    
-  } else if (HAS_SELECTED_CELL(g)) {
-    size_t posX = g.select.x * CELL_WIDTH;
-    size_t posY = g.select.y * CELL_HEIGHT;
-    DrawRectangle(posX, posY, CELL_WIDTH, CELL_HEIGHT, LIGHTGRAY);      
+// Brings the board texture up to date with g. Called only after some
+// input, since nothing else changes the board.
+View view_update(View v, Game g) {
+  BeginTextureMode(v.board);
+
+  // the victory background also covers what is left of the screen
+  // past the last row and column, so the board is drawn from scratch
+  if (v.victory != g.victory) {
+    v.victory = g.victory;
+    ClearBackground(v.victory ? GREEN : RAYWHITE);
+    draw_region(v.lines, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, (Vector2){ 0, 0 });
+    for (size_t i = 0; i < g.rows * g.cols; i++) {
+      v.looks[i] = LOOK_STALE;
+    }
   }
 
-  grid_render_error(g);
+  for (size_t y = 0; y < g.rows; y++) {
+    for (size_t x = 0; x < g.cols; x++) {
+      uint16_t look = cell_look(g, x, y);
+      if (look != v.looks[y * g.cols + x]) {
+	view_render_cell(v, g, x, y, look);
+	v.looks[y * g.cols + x] = look;
+      }
+    }
+  }
+
+  EndTextureMode();
+  return v;
+}
+
+View view_init(Game g) {
+  View v = { 0 };
+
+  v.lines = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
+  BeginTextureMode(v.lines);
+  ClearBackground(BLANK);
   grid_render_lines(g);
-  grid_render_values(g);
+  EndTextureMode();
+
+  v.glyphs = LoadRenderTexture(SCREEN_WIDTH, 2 * CELL_HEIGHT(g));
+  BeginTextureMode(v.glyphs);
+  ClearBackground(BLANK);
+  grid_render_glyphs(g);
+  EndTextureMode();
+
+  v.board = LoadRenderTexture(SCREEN_WIDTH, SCREEN_HEIGHT);
+  v.looks = malloc(g.rows * g.cols * sizeof(uint16_t));
+
+  // force a full redraw
+  v.victory = !g.victory;
+  return view_update(v, g);
+}
+
+void view_close(View v) {
+  UnloadRenderTexture(v.board);
+  UnloadRenderTexture(v.lines);
+  UnloadRenderTexture(v.glyphs);
+  free(v.looks);
+}
+
+void view_render(View v) {
+  draw_region(v.board, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, (Vector2){ 0, 0 });
 }
 
 //----------------------------------------------------------------------------------
 
-int main(void)
+int main(int argc, char **argv)
 {
   InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "sudoku");
   SetTargetFPS(60);
+
+  // the board only changes on input, so there is no point in drawing
+  // frames while waiting for it
+  EnableEventWaiting();
   
-  // Game g = game_init(BOARD_COLS, BOARD_ROWS);
-  // srand(time(NULL));  
-  // grid_rand(g, 0, 9);
-  
-  Game g = game_init_from_file(BOARD_PATH);
+  Game g = game_init_from_file(argc > 1 ? argv[1] : BOARD_PATH, argc > 2 ? strtoul(argv[2], NULL, 10) : 0);
+  View v = view_init(g);
   
   while (!WindowShouldClose())
     {
       // Manage state
       //----------------------------------------------------------------------------------
+      int input = 0;
 
       // select a cell with mouse
       if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
 	Vector2 mousePos = GetMousePosition();
-	Pos pos = coords_to_pos(mousePos);
+	Pos pos = coords_to_pos(g, mousePos);
 	g = game_check_and_set_selection(g, pos);
+	input = 1;
       }
 
       // update selected cell with keyboard
@@ -494,27 +637,53 @@ int main(void)
 	  d = D_LEFT;
 	}
 	
-	Pos newPos = next_pos(g, d);
-	g = game_check_and_set_selection(g, newPos);
+	if (d != D_NONE) {
+	  Pos newPos = next_pos(g, d);
+	  g = game_check_and_set_selection(g, newPos);
+	  input = 1;
+	}
       }
 
       // Write a number
       char keyPress = GetCharPressed();
-      CellValue val = char_to_value(keyPress);
-      game_check_and_set_value(g, val, DYNAMIC);
+      if (keyPress) {
+	CellValue val = char_to_value(keyPress);
+	g = game_check_and_set_value(g, val, DYNAMIC);
+	input = 1;
+      }
+
+      // Clear the selected cell
+      if (IsKeyPressed(KEY_BACKSPACE) || IsKeyPressed(KEY_DELETE)) {
+	g = game_clear_value(g);
+	input = 1;
+      }
+
+      // Solve the puzzle
+      if (IsKeyPressed(KEY_S)) {
+	g = game_solve(g);
+	input = 1;
+      }
+
+      // Start a new random puzzle
+      if (IsKeyPressed(KEY_N)) {
+	g = grid_rand(g, time(NULL));
+	input = 1;
+      }
 
-      // update internal state
-      g = game_check_and_set_error(g);
-      g = game_check_and_set_victory(g);
+      // update internal state, only when something could have changed
+      if (input) {
+	g = game_check_and_set_victory(g);
+	v = view_update(v, g);
+      }
       
       // Render
       //----------------------------------------------------------------------------------      
       BeginDrawing();
-      ClearBackground(RAYWHITE);
-      game_render(g);
+      view_render(v);
       EndDrawing();
     }
 
+  view_close(v);
   game_close(g);  
   CloseWindow();
 
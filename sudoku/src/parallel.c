@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./include/parallel.h"
+
+// subtrees per worker, more of them balance better but cost more to
+// set up
+#define TASKS_PER_THREAD 16
+
+// past this depth the tree is not split any further
+#define MAX_SPLIT_DEPTH 12
+
+typedef struct {
+  size_t cells;         // values per grid
+  uint8_t *grids;       // subproblems, one after the other
+  size_t count;
+  size_t capacity;
+} Subproblems;
+
+typedef struct {
+  size_t box;
+  size_t limit;
+  Subproblems subs;
+
+  atomic_size_t total;
+  atomic_int stop;
+
+  size_t *found;        // solutions of each subproblem
+  uint8_t *solutions;   // first solution of each subproblem
+  SolverStats *stats;   // per worker
+} Job;
+
+typedef struct {
+  Job *job;
+  size_t index;
+} Subtree;
+
+// ----------------------------------------
+
+static void collect(const uint8_t *cells, void *ctx) {
+  Subproblems *subs = ctx;
+
+  if (subs->count == subs->capacity) {
+    subs->capacity = subs->capacity ? subs->capacity * 2 : 64;
+    subs->grids = realloc(subs->grids, subs->capacity * subs->cells);
+  }
+  memcpy(subs->grids + subs->count * subs->cells, cells, subs->cells);
+  subs->count += 1;
+}
+
+// Splits one level deeper each time, until there are enough subtrees
+// or the tree doesn't branch anymore. The work of every attempt goes
+// to `stats`.
+static void split(Job *job, const uint8_t *cells, size_t target, SolverStats *stats) {
+  size_t previous = 0;
+
+  for (int depth = 1; depth <= MAX_SPLIT_DEPTH; depth++) {
+    job->subs.count = 0;
+    solver_split(job->box, cells, depth, collect, &job->subs, stats);
+
+    if (job->subs.count >= target || job->subs.count == previous) {
+      break;
+    }
+    previous = job->subs.count;
+  }
+}
+
+static void count_subtree(void *arg, size_t worker) {
+  Subtree *t = arg;
+  Job *job = t->job;
+  size_t cells = job->subs.cells;
+
+  if (atomic_load(&job->stop)) {
+    return;
+  }
+
+  size_t found = solver_count_until(job->box, job->subs.grids + t->index * cells, job->limit,
+				    job->solutions + t->index * cells, &job->stats[worker], &job->stop);
+  job->found[t->index] = found;
+
+  if (found && atomic_fetch_add(&job->total, found) + found >= job->limit) {
+    atomic_store(&job->stop, 1);
+  }
+}
+
+// ----------------------------------------
+
+size_t parallel_count(Pool *pool, size_t box, const uint8_t *cells, size_t limit,
+		      uint8_t *solution, SolverStats *stats) {
+  Job job = { 0 };
+  job.box = box;
+  job.limit = limit ? limit : SIZE_MAX;
+  job.subs.cells = box * box * box * box;
+  atomic_init(&job.total, 0);
+  atomic_init(&job.stop, 0);
+
+  split(&job, cells, pool->count * TASKS_PER_THREAD, stats);
+
+  size_t n = job.subs.count;
+  Subtree *tasks = malloc(n * sizeof(Subtree));
+  job.found = calloc(n, sizeof(size_t));
+  job.solutions = malloc(n * job.subs.cells);
+  job.stats = calloc(pool->count, sizeof(SolverStats));
+
+  for (size_t i = 0; i < n; i++) {
+    tasks[i] = (Subtree){ &job, i };
+    pool_submit(pool, count_subtree, &tasks[i]);
+  }
+  pool_wait(pool);
+
+  // subproblems are in search order, so without a limit this is the
+  // same solution the sequential search would find first
+  for (size_t i = 0; solution && i < n; i++) {
+    if (job.found[i]) {
+      memcpy(solution, job.solutions + i * job.subs.cells, job.subs.cells);
+      break;
+    }
+  }
+
+  for (size_t w = 0; stats && w < pool->count; w++) {
+    stats->guesses += job.stats[w].guesses;
+    stats->propagations += job.stats[w].propagations;
+    stats->solutions += job.stats[w].solutions;
+  }
+
+  size_t total = atomic_load(&job.total);
+
+  free(tasks);
+  free(job.found);
+  free(job.solutions);
+  free(job.stats);
+  free(job.subs.grids);
+
+  return total < job.limit ? total : job.limit;
+}
@@ -0,0 +1,190 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./include/pool.h"
+
+#define QUEUE_INITIAL_CAPACITY 64
+
+// ----------------------------------------
+
+static void queue_push_back(TaskQueue *q, Task t) {
+  pthread_mutex_lock(&q->lock);
+
+  if (q->count == q->capacity) {
+    size_t capacity = q->capacity ? q->capacity * 2 : QUEUE_INITIAL_CAPACITY;
+    Task *tasks = malloc(capacity * sizeof(Task));
+    if (!tasks) {
+      fprintf(stderr, "ERROR: could not grow task queue\n");
+      exit(1);
+    }
+
+    for (size_t i = 0; i < q->count; i++) {
+      tasks[i] = q->tasks[(q->head + i) % q->capacity];
+    }
+    free(q->tasks);
+    q->tasks = tasks;
+    q->head = 0;
+    q->capacity = capacity;
+  }
+
+  q->tasks[(q->head + q->count) % q->capacity] = t;
+  q->count += 1;
+
+  pthread_mutex_unlock(&q->lock);
+}
+
+static int queue_pop_back(TaskQueue *q, Task *t) {
+  int ok = 0;
+  pthread_mutex_lock(&q->lock);
+  if (q->count) {
+    q->count -= 1;
+    *t = q->tasks[(q->head + q->count) % q->capacity];
+    ok = 1;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return ok;
+}
+
+static int queue_pop_front(TaskQueue *q, Task *t) {
+  int ok = 0;
+  pthread_mutex_lock(&q->lock);
+  if (q->count) {
+    *t = q->tasks[q->head];
+    q->head = (q->head + 1) % q->capacity;
+    q->count -= 1;
+    ok = 1;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return ok;
+}
+
+// ----------------------------------------
+
+static int take_task(Pool *p, size_t id, Task *t) {
+  if (queue_pop_back(&p->queues[id], t)) {
+    return 1;
+  }
+
+  for (size_t i = 1; i < p->count; i++) {
+    if (queue_pop_front(&p->queues[(id + i) % p->count], t)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static void *worker_loop(void *arg) {
+  Worker *w = arg;
+  Pool *p = w->pool;
+  Task t;
+
+  for (;;) {
+    if (take_task(p, w->id, &t)) {
+      atomic_fetch_sub(&p->queued, 1);
+      t.fn(t.arg, w->id);
+
+      if (atomic_fetch_sub(&p->pending, 1) == 1) {
+	pthread_mutex_lock(&p->lock);
+	pthread_cond_broadcast(&p->idle);
+	pthread_mutex_unlock(&p->lock);
+      }
+      continue;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    while (!atomic_load(&p->queued) && !p->quit) {
+      pthread_cond_wait(&p->work, &p->lock);
+    }
+    int quit = p->quit && !atomic_load(&p->queued);
+    pthread_mutex_unlock(&p->lock);
+
+    if (quit) {
+      return NULL;
+    }
+  }
+}
+
+// ----------------------------------------
+
+size_t pool_default_threads(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? n : 1;
+}
+
+Pool *pool_create(size_t threads) {
+  Pool *p = calloc(1, sizeof(Pool));
+  p->count = threads ? threads : 1;
+  p->workers = calloc(p->count, sizeof(Worker));
+  p->queues = calloc(p->count, sizeof(TaskQueue));
+
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->work, NULL);
+  pthread_cond_init(&p->idle, NULL);
+
+  for (size_t i = 0; i < p->count; i++) {
+    pthread_mutex_init(&p->queues[i].lock, NULL);
+  }
+
+  for (size_t i = 0; i < p->count; i++) {
+    p->workers[i] = (Worker){ p, i, 0 };
+    if (pthread_create(&p->workers[i].thread, NULL, worker_loop, &p->workers[i]) != 0) {
+      fprintf(stderr, "ERROR: could not create worker thread %zu\n", i);
+      exit(1);
+    }
+  }
+
+  return p;
+}
+
+void pool_destroy(Pool *p) {
+  pthread_mutex_lock(&p->lock);
+  p->quit = 1;
+  pthread_cond_broadcast(&p->work);
+  pthread_mutex_unlock(&p->lock);
+
+  for (size_t i = 0; i < p->count; i++) {
+    pthread_join(p->workers[i].thread, NULL);
+  }
+
+  for (size_t i = 0; i < p->count; i++) {
+    pthread_mutex_destroy(&p->queues[i].lock);
+    free(p->queues[i].tasks);
+  }
+
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->work);
+  pthread_cond_destroy(&p->idle);
+
+  free(p->queues);
+  free(p->workers);
+  free(p);
+}
+
+void pool_submit_to(Pool *p, size_t worker, TaskFn fn, void *arg) {
+  // counted before the push, so that the counters never go below the
+  // number of tasks actually in the queues
+  atomic_fetch_add(&p->pending, 1);
+  atomic_fetch_add(&p->queued, 1);
+  queue_push_back(&p->queues[worker % p->count], (Task){ fn, arg });
+
+  pthread_mutex_lock(&p->lock);
+  pthread_cond_signal(&p->work);
+  pthread_mutex_unlock(&p->lock);
+}
+
+void pool_submit(Pool *p, TaskFn fn, void *arg) {
+  pool_submit_to(p, atomic_fetch_add(&p->next, 1), fn, arg);
+}
+
+void pool_wait(Pool *p) {
+  pthread_mutex_lock(&p->lock);
+  while (atomic_load(&p->pending)) {
+    pthread_cond_wait(&p->idle, &p->lock);
+  }
+  pthread_mutex_unlock(&p->lock);
+}
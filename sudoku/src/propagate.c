@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PROP_X86 1
+#endif
+
+#include "./include/propagate.h"
+
+const char *PROP_IMPL_NAMES[PROP_IMPL_COUNT] = { "scalar", "sse4.1", "avx2" };
+
+#define VALID_ROW(v) { v, v, v, 0, v, v, v, 0, v, v, v, 0, 0, 0, 0, 0 }
+
+static _Alignas(32) const uint16_t PROP_VALID_LANES[PROP_LANES] = VALID_ROW(0xFFFF);
+static _Alignas(32) const uint16_t PROP_ALL_DIGITS[PROP_LANES] = VALID_ROW(SOLVER_ALL_DIGITS);
+
+// ----------------------------------------
+// SCALAR
+
+typedef struct {
+  uint16_t l[PROP_LANES];
+} Lanes;
+
+#define V Lanes
+#define PR(name) name##_scalar
+#define LANEWISE(expr) Lanes r; for (int i = 0; i < PROP_LANES; i++) { r.l[i] = (expr); } return r
+
+static inline Lanes vload_scalar(const uint16_t *p) { Lanes r; memcpy(r.l, p, sizeof(r.l)); return r; }
+static inline void vstore_scalar(uint16_t *p, Lanes v) { memcpy(p, v.l, sizeof(v.l)); }
+static inline Lanes vzero_scalar(void) { Lanes r = { { 0 } }; return r; }
+static inline Lanes vor_scalar(Lanes a, Lanes b) { LANEWISE(a.l[i] | b.l[i]); }
+static inline Lanes vand_scalar(Lanes a, Lanes b) { LANEWISE(a.l[i] & b.l[i]); }
+static inline Lanes vandnot_scalar(Lanes a, Lanes b) { LANEWISE(~a.l[i] & b.l[i]); }
+static inline Lanes vsingles_scalar(Lanes a) { LANEWISE((a.l[i] && !(a.l[i] & (a.l[i] - 1))) ? 0xFFFF : 0); }
+static inline Lanes vzeros_scalar(Lanes a) { LANEWISE(a.l[i] ? 0 : 0xFFFF); }
+static inline Lanes vswap1_scalar(Lanes a) { LANEWISE(a.l[i ^ 1]); }
+static inline Lanes vswap2_scalar(Lanes a) { LANEWISE(a.l[i ^ 2]); }
+static inline Lanes vswap64_scalar(Lanes a) { LANEWISE(a.l[i ^ 4]); }
+static inline Lanes vswap128_scalar(Lanes a) { LANEWISE(a.l[i ^ 8]); }
+
+static inline int vany_scalar(Lanes a) {
+  uint16_t acc = 0;
+  for (int i = 0; i < PROP_LANES; i++) {
+    acc |= a.l[i];
+  }
+  return acc != 0;
+}
+
+static inline int veq_scalar(Lanes a, Lanes b) {
+  return memcmp(a.l, b.l, sizeof(a.l)) == 0;
+}
+
+#include "./include/propagate_round.h"
+
+#undef V
+#undef PR
+
+// ----------------------------------------
+// SSE4.1
+
+#ifdef PROP_X86
+
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+
+// a row takes two registers, lanes 0-7 and lanes 8-15
+typedef struct {
+  __m128i lo;
+  __m128i hi;
+} Sse;
+
+#define V Sse
+#define PR(name) name##_sse41
+#define HALVES(f) Sse r = { f(a.lo), f(a.hi) }; return r
+#define HALVES2(f) Sse r = { f(a.lo, b.lo), f(a.hi, b.hi) }; return r
+
+static inline __m128i singles128(__m128i a) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i low = _mm_and_si128(a, _mm_sub_epi16(a, _mm_set1_epi16(1)));
+  return _mm_andnot_si128(_mm_cmpeq_epi16(a, zero), _mm_cmpeq_epi16(low, zero));
+}
+static inline __m128i zeros128(__m128i a) { return _mm_cmpeq_epi16(a, _mm_setzero_si128()); }
+static inline __m128i swap1_128(__m128i a) {
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+}
+static inline __m128i swap2_128(__m128i a) {
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(a, _MM_SHUFFLE(1, 0, 3, 2)), _MM_SHUFFLE(1, 0, 3, 2));
+}
+static inline __m128i swap64_128(__m128i a) { return _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)); }
+
+static inline Sse vload_sse41(const uint16_t *p) {
+  Sse r = { _mm_load_si128((const __m128i *) p), _mm_load_si128((const __m128i *) (p + 8)) };
+  return r;
+}
+static inline void vstore_sse41(uint16_t *p, Sse v) {
+  _mm_store_si128((__m128i *) p, v.lo);
+  _mm_store_si128((__m128i *) (p + 8), v.hi);
+}
+static inline Sse vzero_sse41(void) { Sse r = { _mm_setzero_si128(), _mm_setzero_si128() }; return r; }
+static inline Sse vor_sse41(Sse a, Sse b) { HALVES2(_mm_or_si128); }
+static inline Sse vand_sse41(Sse a, Sse b) { HALVES2(_mm_and_si128); }
+static inline Sse vandnot_sse41(Sse a, Sse b) { HALVES2(_mm_andnot_si128); }
+static inline Sse vsingles_sse41(Sse a) { HALVES(singles128); }
+static inline Sse vzeros_sse41(Sse a) { HALVES(zeros128); }
+static inline Sse vswap1_sse41(Sse a) { HALVES(swap1_128); }
+static inline Sse vswap2_sse41(Sse a) { HALVES(swap2_128); }
+static inline Sse vswap64_sse41(Sse a) { HALVES(swap64_128); }
+static inline Sse vswap128_sse41(Sse a) { Sse r = { a.hi, a.lo }; return r; }
+
+static inline int vany_sse41(Sse a) {
+  __m128i x = _mm_or_si128(a.lo, a.hi);
+  return !_mm_testz_si128(x, x);
+}
+
+static inline int veq_sse41(Sse a, Sse b) {
+  __m128i x = _mm_or_si128(_mm_xor_si128(a.lo, b.lo), _mm_xor_si128(a.hi, b.hi));
+  return _mm_testz_si128(x, x);
+}
+
+#include "./include/propagate_round.h"
+
+#undef V
+#undef PR
+
+#pragma GCC pop_options
+
+// ----------------------------------------
+// AVX2
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+#define V __m256i
+#define PR(name) name##_avx2
+
+static inline __m256i vload_avx2(const uint16_t *p) { return _mm256_load_si256((const __m256i *) p); }
+static inline void vstore_avx2(uint16_t *p, __m256i v) { _mm256_store_si256((__m256i *) p, v); }
+static inline __m256i vzero_avx2(void) { return _mm256_setzero_si256(); }
+static inline __m256i vor_avx2(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+static inline __m256i vand_avx2(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+static inline __m256i vandnot_avx2(__m256i a, __m256i b) { return _mm256_andnot_si256(a, b); }
+
+static inline __m256i vsingles_avx2(__m256i a) {
+  __m256i zero = _mm256_setzero_si256();
+  __m256i low = _mm256_and_si256(a, _mm256_sub_epi16(a, _mm256_set1_epi16(1)));
+  return _mm256_andnot_si256(_mm256_cmpeq_epi16(a, zero), _mm256_cmpeq_epi16(low, zero));
+}
+
+static inline __m256i vzeros_avx2(__m256i a) { return _mm256_cmpeq_epi16(a, _mm256_setzero_si256()); }
+
+static inline __m256i vswap1_avx2(__m256i a) {
+  return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(a, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline __m256i vswap2_avx2(__m256i a) {
+  return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(a, _MM_SHUFFLE(1, 0, 3, 2)), _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+static inline __m256i vswap64_avx2(__m256i a) { return _mm256_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)); }
+static inline __m256i vswap128_avx2(__m256i a) { return _mm256_permute2x128_si256(a, a, 0x01); }
+static inline int vany_avx2(__m256i a) { return !_mm256_testz_si256(a, a); }
+
+static inline int veq_avx2(__m256i a, __m256i b) {
+  __m256i x = _mm256_xor_si256(a, b);
+  return _mm256_testz_si256(x, x);
+}
+
+#include "./include/propagate_round.h"
+
+#undef V
+#undef PR
+
+#pragma GCC pop_options
+
+#endif // PROP_X86
+
+// ----------------------------------------
+
+void prop_load(CandGrid *g, const uint8_t *cells) {
+  uint16_t rows[SOLVER_SIZE] = { 0 }, cols[SOLVER_SIZE] = { 0 }, boxes[SOLVER_SIZE] = { 0 };
+
+  memset(g, 0, sizeof(*g));
+
+  for (int i = 0; i < SOLVER_CELLS; i++) {
+    int y = i / SOLVER_SIZE, x = i % SOLVER_SIZE;
+    int b = (y / SOLVER_BOX) * SOLVER_BOX + x / SOLVER_BOX;
+    rows[y] |= 1 << cells[i];
+    cols[x] |= 1 << cells[i];
+    boxes[b] |= 1 << cells[i];
+  }
+
+  for (int i = 0; i < SOLVER_CELLS; i++) {
+    int y = i / SOLVER_SIZE, x = i % SOLVER_SIZE;
+    int b = (y / SOLVER_BOX) * SOLVER_BOX + x / SOLVER_BOX;
+    uint16_t c = cells[i] ? 1 << cells[i] : SOLVER_ALL_DIGITS & ~(rows[y] | cols[x] | boxes[b]);
+    g->rows[y][PROP_LANE(x)] = c;
+  }
+}
+
+// ----------------------------------------
+// DISPATCH
+
+int prop_supported(PropImpl impl) {
+  switch(impl) {
+  case PROP_SCALAR: return 1;
+#ifdef PROP_X86
+  case PROP_SSE41: return __builtin_cpu_supports("sse4.1");
+  case PROP_AVX2:  return __builtin_cpu_supports("avx2");
+#endif
+  default:         return 0;
+  }
+}
+
+PropImpl prop_best_impl(void) {
+  for (int impl = PROP_IMPL_COUNT - 1; impl > PROP_SCALAR; impl--) {
+    if (prop_supported(impl)) {
+      return impl;
+    }
+  }
+  return PROP_SCALAR;
+}
+
+PropRoundFn prop_round_fn(PropImpl impl) {
+  switch(impl) {
+#ifdef PROP_X86
+  case PROP_SSE41: return prop_round_sse41;
+  case PROP_AVX2:  return prop_round_avx2;
+#endif
+  default:         return prop_round_scalar;
+  }
+}
+
+int prop_fixpoint_with(PropRoundFn round, CandGrid *g) {
+  int rounds = 0;
+  int res;
+
+  do {
+    res = round(g);
+    rounds += 1;
+  } while (res == 1);
+
+  return res < 0 ? -1 : rounds;
+}
+
+int prop_fixpoint(CandGrid *g) {
+  // resolved on first use, every thread computes the same value
+  static _Atomic(PropRoundFn) best = NULL;
+  PropRoundFn round = atomic_load_explicit(&best, memory_order_relaxed);
+
+  if (!round) {
+    round = prop_round_fn(prop_best_impl());
+    atomic_store_explicit(&best, round, memory_order_relaxed);
+  }
+
+  return prop_fixpoint_with(round, g);
+}
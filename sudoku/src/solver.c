@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+
+#include "./include/solver.h"
+#include "./include/propagate.h"
+
+// The state of the search is given by three bitmasks per unit with the
+// digits already placed in each row, column and box. The candidates of
+// an empty cell are whatever is not used by any of its three units.
+//
+// Placements are pushed on a trail, so that backtracking only has to
+// clear the cells placed after the branching point (and their bits in
+// the masks), instead of copying the whole grid at each level.
+//
+// The geometry of the board is only known at runtime, so the unit of
+// each cell and the cells of each unit are tabulated once per search.
+
+typedef struct {
+  int box;
+  int size;
+  int count;          // number of cells
+  uint64_t all;       // bits 1..size
+
+  uint64_t rows[SOLVER_MAX_SIZE];
+  uint64_t cols[SOLVER_MAX_SIZE];
+  uint64_t boxes[SOLVER_MAX_SIZE];
+  uint8_t cells[SOLVER_MAX_CELLS];
+
+  uint8_t row_of[SOLVER_MAX_CELLS];
+  uint8_t col_of[SOLVER_MAX_CELLS];
+  uint8_t box_of[SOLVER_MAX_CELLS];
+  // units 0..size-1 are the rows, then the columns and the boxes
+  uint16_t units[3 * SOLVER_MAX_SIZE][SOLVER_MAX_SIZE];
+
+  uint16_t trail[SOLVER_MAX_CELLS];
+  size_t trail_len;
+
+  int use_kernel;
+  size_t limit;
+  size_t found;
+  uint8_t *solution;
+  SolverStats *stats;
+  const atomic_int *stop;   // set by someone else to end the search
+
+  // when splitting, subproblems are handed to split_fn at this depth
+  int split_depth;
+  SolverSplitFn split_fn;
+  void *split_ctx;
+} Solver;
+
+static SolverPropagation PROPAGATION = SOLVER_PROP_AUTO;
+
+// ----------------------------------------
+
+static void solver_init(Solver *s, int box) {
+  s->box = box;
+  s->size = box * box;
+  s->count = s->size * s->size;
+  s->all = ((2ULL << s->size) - 1) & ~1ULL;
+
+  memset(s->rows, 0, sizeof(s->rows));
+  memset(s->cols, 0, sizeof(s->cols));
+  memset(s->boxes, 0, sizeof(s->boxes));
+  memset(s->cells, 0, s->count);
+
+  for (int i = 0; i < s->count; i++) {
+    int y = i / s->size, x = i % s->size;
+    int b = (y / box) * box + x / box;
+
+    s->row_of[i] = y;
+    s->col_of[i] = x;
+    s->box_of[i] = b;
+    s->units[y][x] = i;
+    s->units[s->size + x][y] = i;
+    s->units[2 * s->size + b][(y % box) * box + x % box] = i;
+  }
+
+  s->trail_len = 0;
+  s->found = 0;
+}
+
+static uint64_t candidates(const Solver *s, int i) {
+  return s->all & ~(s->rows[s->row_of[i]] |
+		    s->cols[s->col_of[i]] |
+		    s->boxes[s->box_of[i]]);
+}
+
+static void place(Solver *s, int i, int digit) {
+  uint64_t bit = 1ULL << digit;
+  s->cells[i] = digit;
+  s->rows[s->row_of[i]] |= bit;
+  s->cols[s->col_of[i]] |= bit;
+  s->boxes[s->box_of[i]] |= bit;
+  s->trail[s->trail_len++] = i;
+}
+
+// Every placement sets bits that were clear, so they can be cleared
+// again in reverse order.
+static void undo(Solver *s, size_t trail_len) {
+  while (s->trail_len > trail_len) {
+    int i = s->trail[--s->trail_len];
+    uint64_t bit = 1ULL << s->cells[i];
+    s->rows[s->row_of[i]] &= ~bit;
+    s->cols[s->col_of[i]] &= ~bit;
+    s->boxes[s->box_of[i]] &= ~bit;
+    s->cells[i] = 0;
+  }
+}
+
+// Places naked singles (cells with a single candidate) and hidden
+// singles (digits with a single place in a unit) until nothing
+// changes. Returns 0 on a contradiction. Otherwise `branch` is set to
+// the empty cell with the fewest candidates, or to -1 if the grid is
+// full.
+static int propagate(Solver *s, int *branch) {
+  int changed = 1;
+
+  s->stats->propagations += 1;
+
+  while (changed) {
+    changed = 0;
+
+    // naked singles, and the best cell to branch on
+    int best = -1;
+    int best_count = s->size + 1;
+
+    for (int i = 0; i < s->count; i++) {
+      if (s->cells[i]) {
+	continue;
+      }
+
+      uint64_t c = candidates(s, i);
+      int count = __builtin_popcountll(c);
+
+      if (count == 0) {
+	return 0;
+      } else if (count == 1) {
+	place(s, i, __builtin_ctzll(c));
+	changed = 1;
+      } else if (count < best_count) {
+	best = i;
+	best_count = count;
+      }
+    }
+
+    if (changed) {
+      continue;
+    }
+
+    // hidden singles
+    for (int u = 0; u < 3 * s->size; u++) {
+      const uint16_t *unit = s->units[u];
+      uint64_t once = 0, twice = 0, used = 0;
+
+      for (int k = 0; k < s->size; k++) {
+	int i = unit[k];
+	if (s->cells[i]) {
+	  used |= 1ULL << s->cells[i];
+	} else {
+	  uint64_t c = candidates(s, i);
+	  twice |= once & c;
+	  once |= c;
+	}
+      }
+
+      // some digit has no place left in this unit
+      if ((used | once) != s->all) {
+	return 0;
+      }
+
+      uint64_t hidden = once & ~twice;
+      for (int k = 0; hidden && k < s->size; k++) {
+	int i = unit[k];
+	uint64_t c = s->cells[i] ? 0 : candidates(s, i) & hidden;
+	if (c) {
+	  // a cell can't take two hidden singles of the same unit
+	  if (c & (c - 1)) {
+	    return 0;
+	  }
+	  place(s, i, __builtin_ctzll(c));
+	  hidden &= ~c;
+	  changed = 1;
+	}
+      }
+    }
+
+    if (!changed) {
+      *branch = best;
+    }
+  }
+
+  return 1;
+}
+
+// Same as propagate(), but the eliminations are done by the vector
+// kernel on a copy of the candidates, and the singles it finds are
+// then placed in one go. Only for 9x9 boards.
+static int propagate_kernel(Solver *s, int *branch) {
+  CandGrid g = { 0 };
+
+  s->stats->propagations += 1;
+
+  for (int i = 0; i < SOLVER_CELLS; i++) {
+    g.rows[s->row_of[i]][PROP_LANE(s->col_of[i])] = s->cells[i] ? 1 << s->cells[i] : candidates(s, i);
+  }
+
+  if (prop_fixpoint(&g) < 0) {
+    return 0;
+  }
+
+  int best = -1;
+  int best_count = SOLVER_SIZE + 1;
+
+  for (int i = 0; i < SOLVER_CELLS; i++) {
+    if (s->cells[i]) {
+      continue;
+    }
+
+    uint16_t c = g.rows[s->row_of[i]][PROP_LANE(s->col_of[i])];
+    int count = __builtin_popcount(c);
+
+    if (count == 1) {
+      place(s, i, __builtin_ctz(c));
+    } else if (count < best_count) {
+      best = i;
+      best_count = count;
+    }
+  }
+
+  *branch = best;
+  return 1;
+}
+
+static void search(Solver *s, int depth) {
+  int cell;
+
+  if (s->stop && atomic_load_explicit(s->stop, memory_order_relaxed)) {
+    return;
+  }
+
+  int ok = s->use_kernel ? propagate_kernel(s, &cell) : propagate(s, &cell);
+
+  if (!ok) {
+    return;
+  }
+
+  if (s->split_fn && (cell == -1 || depth == s->split_depth)) {
+    s->split_fn(s->cells, s->split_ctx);
+    s->found += 1;
+    return;
+  }
+
+  if (cell == -1) {
+    if (s->found == 0 && s->solution) {
+      memcpy(s->solution, s->cells, s->count);
+    }
+    s->found += 1;
+    s->stats->solutions += 1;
+    return;
+  }
+
+  size_t saved_len = s->trail_len;
+  uint64_t c = candidates(s, cell);
+
+  while (c) {
+    int digit = __builtin_ctzll(c);
+    c &= c - 1;
+
+    s->stats->guesses += 1;
+    place(s, cell, digit);
+    search(s, depth + 1);
+
+    if (s->found >= s->limit || (s->stop && atomic_load_explicit(s->stop, memory_order_relaxed))) {
+      return;
+    }
+    undo(s, saved_len);
+  }
+}
+
+// ----------------------------------------
+
+void solver_set_propagation(SolverPropagation p) {
+  PROPAGATION = p;
+}
+
+// Sets up `s` for `box` and loads the clues. Returns 0 if the clues
+// already contain a conflict.
+static int solver_load(Solver *s, size_t box, const uint8_t *cells, SolverStats *stats) {
+  assert(box >= 2 && box <= SOLVER_MAX_BOX && "unsupported board size");
+  solver_init(s, box);
+
+  // the scalar kernel is slower than the plain loops
+  s->use_kernel = box == SOLVER_BOX && (PROPAGATION == SOLVER_PROP_KERNEL ||
+					(PROPAGATION == SOLVER_PROP_AUTO && prop_best_impl() != PROP_SCALAR));
+  s->stats = stats;
+  s->stop = NULL;
+  s->split_fn = NULL;
+
+  for (int i = 0; i < s->count; i++) {
+    int digit = cells[i];
+    if (!digit) {
+      continue;
+    }
+
+    assert(digit <= s->size && "invalid digit in grid");
+    if (!(candidates(s, i) & (1ULL << digit))) {
+      return 0;
+    }
+    place(s, i, digit);
+  }
+
+  return 1;
+}
+
+size_t solver_count_until(size_t box, const uint8_t *cells, size_t limit, uint8_t *solution,
+			  SolverStats *stats, const atomic_int *stop) {
+  SolverStats unused = { 0 };
+  Solver s;
+
+  if (!solver_load(&s, box, cells, stats ? stats : &unused)) {
+    return 0;
+  }
+
+  s.limit = limit;
+  s.solution = solution;
+  s.stop = stop;
+
+  search(&s, 0);
+  return s.found;
+}
+
+size_t solver_count_box(size_t box, const uint8_t *cells, size_t limit, uint8_t *solution, SolverStats *stats) {
+  return solver_count_until(box, cells, limit, solution, stats, NULL);
+}
+
+size_t solver_split(size_t box, const uint8_t *cells, int depth, SolverSplitFn fn, void *ctx, SolverStats *stats) {
+  SolverStats unused = { 0 };
+  Solver s;
+
+  if (!solver_load(&s, box, cells, stats ? stats : &unused)) {
+    return 0;
+  }
+
+  s.limit = SIZE_MAX;
+  s.solution = NULL;
+  s.split_depth = depth;
+  s.split_fn = fn;
+  s.split_ctx = ctx;
+
+  search(&s, 0);
+  return s.found;
+}
+
+int solver_solve_box(size_t box, uint8_t *cells, SolverStats *stats) {
+  uint8_t solution[SOLVER_MAX_CELLS];
+
+  if (!solver_count_box(box, cells, 1, solution, stats)) {
+    return 0;
+  }
+
+  memcpy(cells, solution, box * box * box * box);
+  return 1;
+}
+
+size_t solver_count(const uint8_t *cells, size_t limit, uint8_t *solution, SolverStats *stats) {
+  return solver_count_box(SOLVER_BOX, cells, limit, solution, stats);
+}
+
+int solver_solve(uint8_t *cells, SolverStats *stats) {
+  return solver_solve_box(SOLVER_BOX, cells, stats);
+}
@@ -2,12 +2,23 @@
 // Made for youtube video: https://youtu.be/1FdujwZ1r8A
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <ncurses.h>
 #include <assert.h>
 #include <stdbool.h>
 
+// m,n,k game: a BOARD_WIDTH x BOARD_HEIGHT board unless given, where
+// the first to get k in a row (horizontally, vertically or
+// diagonally) wins, up to MAX_BOARD_SIDE per side (gomoku is 15 15 5)
 #define BOARD_WIDTH 3
 #define BOARD_HEIGHT 3
+#define BOARD_K 3
+
+#define MAX_BOARD_SIDE 19
+#define MAX_CELLS (MAX_BOARD_SIDE * MAX_BOARD_SIDE)
+#define BOARD_WORDS ((MAX_CELLS + 63) / 64)
 
 #define START_Y_BOARD 0
 #define START_X_BOARD 0
@@ -17,80 +28,132 @@
 
 #define PLAYER_ICON(x) ((x) == PLAYER_O) ? "O" : "X"
 
-int BOARD[BOARD_HEIGHT][BOARD_WIDTH];
+// the 4 directions of a line: right, down, down right, up right
+#define DIRECTIONS 4
+
+static const int DX[DIRECTIONS] = { 1, 0, 1, 1 };
+static const int DY[DIRECTIONS] = { 0, 1, 1, -1 };
+
+// The stones of each player are a bitboard, bit y * width + x.
+//
+// Victory is checked in constant time, whatever k is: for each player
+// and direction, the two ends of every run of stones in a row hold its
+// length (run[..][0] at the end towards the direction, run[..][1] at
+// the other one). A new stone joins the runs that end right next to
+// it, and only the two ends of the joined run are updated. Cells
+// inside a run keep old lengths, which are never read again.
+typedef struct {
+  int width;
+  int height;
+  int k;
+  int cells;
+  uint64_t stones[2][BOARD_WORDS];
+  uint8_t run[2][DIRECTIONS][MAX_CELLS][2];
+  int last_run;  // longest run through the last stone put
+} Board;
+
+Board BOARD;
 
 // ---------------------------------------
 
 // Game logic functions
 
-void check_pos(int y, int x) {
-  assert(x >= 0 && x < BOARD_WIDTH && y >= 0 && y < BOARD_HEIGHT && "invalid position");
+void check_pos(Board *board, int y, int x) {
+  assert(x >= 0 && x < board->width && y >= 0 && y < board->height && "invalid position");
 }
 
-void board_init(int board[BOARD_HEIGHT][BOARD_WIDTH]) {
-  for (int y = 0; y < BOARD_HEIGHT; y++) {
-    for (int x = 0; x < BOARD_WIDTH; x++) {
-      BOARD[y][x] = -1;
-    } 
+bool board_init(Board *board, int width, int height, int k) {
+  if (width < 1 || height < 1 || width > MAX_BOARD_SIDE || height > MAX_BOARD_SIDE ||
+      k < 1 || (k > width && k > height)) {
+    return false;
   }
-}
 
-char *board_get_value(int board[BOARD_HEIGHT][BOARD_WIDTH], int y, int x) {
-  check_pos(y, x);
-  return board[y][x] == -1 ? " " : PLAYER_ICON(board[y][x]);
+  memset(board, 0, sizeof(*board));
+  board->width = width;
+  board->height = height;
+  board->k = k;
+  board->cells = width * height;
+  return true;
 }
 
-bool board_update(int board[BOARD_HEIGHT][BOARD_WIDTH], int y, int x, int player) {
-  check_pos(y, x);
-
-  bool valid_update = true;
-  if (board[y][x] != -1) {
-    valid_update = false;
-  } else {
-    board[y][x] = player;
+// -1 if the cell is empty
+int board_get_player(Board *board, int y, int x) {
+  check_pos(board, y, x);
+  int c = y * board->width + x;
+  for (int p = 0; p < 2; p++) {
+    if ((board->stones[p][c >> 6] >> (c & 63)) & 1) {
+      return p;
+    }
   }
-  return valid_update;
+  return -1;
 }
 
-bool board_check_victory(int board[BOARD_HEIGHT][BOARD_WIDTH], int last_y, int last_x) {
-  int val = board[last_y][last_x];
+char *board_get_value(Board *board, int y, int x) {
+  int player = board_get_player(board, y, x);
+  return player == -1 ? " " : PLAYER_ICON(player);
+}
 
-  int y = 0;
-  int x = 0;
+// Length of the run of stones of player ending right next to (y, x),
+// towards direction d (step 1) or away from it (step -1).
+int board_run_next_to(Board *board, int y, int x, int d, int step, int player) {
+  int ny = y + step * DY[d];
+  int nx = x + step * DX[d];
 
-  // check column
-  for (y = 0; (y < BOARD_HEIGHT) && (board[y][last_x] == val); y++) {}
-  if (y == BOARD_HEIGHT) { return true; }
+  if (nx < 0 || nx >= board->width || ny < 0 || ny >= board->height ||
+      board_get_player(board, ny, nx) != player) {
+    return 0;
+  }
+  return board->run[player][d][ny * board->width + nx][step == 1 ? 1 : 0];
+}
 
-  // check row
-  for (x = 0; (x < BOARD_WIDTH) && (board[last_y][x] == val); x++) {}
-  if (x == BOARD_WIDTH) { return true; }  
+bool board_update(Board *board, int y, int x, int player) {
+  check_pos(board, y, x);
 
-  // check diagonals
-  if (BOARD_WIDTH == BOARD_HEIGHT) {
-    for(x = 0, y = 0; (x < BOARD_WIDTH) && (y < BOARD_HEIGHT) && (board[y][x] == val); x++, y++) {};
-    if ((x == BOARD_WIDTH) && (y == BOARD_HEIGHT)) { return true; }
+  if (board_get_player(board, y, x) != -1) {
+    return false;
+  }
 
-    for(x = BOARD_WIDTH - 1, y = 0; (x > -1) && (y < BOARD_HEIGHT) && (board[y][x] == val); x--, y++) {};
-    if ((x == -1) && (y == BOARD_HEIGHT)) { return true; }
+  // the runs next to the new stone become one, whose ends are the far
+  // ends of the two
+  board->last_run = 0;
+  for (int d = 0; d < DIRECTIONS; d++) {
+    int before = board_run_next_to(board, y, x, d, -1, player);
+    int after = board_run_next_to(board, y, x, d, 1, player);
+    int length = before + 1 + after;
+
+    int first = (y - before * DY[d]) * board->width + (x - before * DX[d]);
+    int last = (y + after * DY[d]) * board->width + (x + after * DX[d]);
+    board->run[player][d][first][1] = length;
+    board->run[player][d][last][0] = length;
+
+    if (length > board->last_run) {
+      board->last_run = length;
+    }
   }
-  
-  return false;
+
+  int c = y * board->width + x;
+  board->stones[player][c >> 6] |= 1ULL << (c & 63);
+  return true;
+}
+
+// Whether the last stone put by board_update() made k in a row.
+bool board_check_victory(Board *board) {
+  return board->last_run >= board->k;
 }
 
 // ---------------------------------------
 
 // Game rendering functions
 
-int allow_event(int event_y, int event_x, int start_y, int start_x) {
+int allow_event(Board *board, int event_y, int event_x, int start_y, int start_x) {
 
   // x is out of bounds
-  if (event_x < start_x + 2 || event_x > start_x + 2 + 2 * BOARD_WIDTH) {
+  if (event_x < start_x + 2 || event_x > start_x + 2 + 2 * board->width) {
     return false;
   }
 
   // y is out of bounds
-  if (event_y < start_y + 2 || event_y > start_y + 2 + BOARD_HEIGHT - 1) {
+  if (event_y < start_y + 2 || event_y > start_y + 2 + board->height - 1) {
     return false;
   }  
 
@@ -106,16 +169,16 @@ int shift_coord(int coord, int start_coord, bool horiz_mode) {
   return horiz_mode ? (coord - start_coord) / 2 : coord - start_coord;
 }
 
-void board_write_to_screen(int board[BOARD_HEIGHT][BOARD_WIDTH], int start_y, int start_x) {
-  mvprintw(start_y, start_x, "Board Status: ");
+void board_write_to_screen(Board *board, int start_y, int start_x) {
+  mvprintw(start_y, start_x, "Board Status: %d in a row wins", board->k);
 
   int col = start_y + 2;
   int row = start_x + 2;
-  for (int y = 0; y < BOARD_HEIGHT; y++, col++) {
+  for (int y = 0; y < board->height; y++, col++) {
     move(col, row);  
-    for (int x = 0; x < BOARD_WIDTH; x++) {
+    for (int x = 0; x < board->width; x++) {
       char *board_value = board_get_value(board, y, x);
-      char *separator = x == BOARD_WIDTH - 1 ? "|" : "\0";
+      char *separator = x == board->width - 1 ? "|" : "\0";
       printw("|%s%s", board_value, separator);
     }
   }
@@ -128,7 +191,27 @@ void player_write_to_screen(int player, int start_y, int start_x, int board_heig
 
 // ---------------------------------------
 
-int main() {
+int main(int argc, char **argv) {
+  int width = BOARD_WIDTH;
+  int height = BOARD_HEIGHT;
+  int k = BOARD_K;
+
+  if (argc == 4) {
+    width = atoi(argv[1]);
+    height = atoi(argv[2]);
+    k = atoi(argv[3]);
+  } else if (argc != 1) {
+    printf("Usage: %s [width height k]\n", argv[0]);
+    exit(1);
+  }
+
+  // init my stuff
+  if (!board_init(&BOARD, width, height, k)) {
+    printf("Error: cannot play %d in a row on a %dx%d board (at most %dx%d)\n",
+	   k, width, height, MAX_BOARD_SIDE, MAX_BOARD_SIDE);
+    exit(1);
+  }
+
   // init ncurses stuff
   initscr();
   cbreak();
@@ -137,9 +220,6 @@ int main() {
   keypad(stdscr, TRUE);
   mousemask(ALL_MOUSE_EVENTS, NULL);
 
-  // init my stuff
-  board_init(BOARD);
-
   // main game loop
   int current_player = PLAYER_X;
   int count = 0;
@@ -150,8 +230,8 @@ int main() {
   while(!quit) {
 
     // render stuff
-    board_write_to_screen(BOARD, START_Y_BOARD, START_X_BOARD);
-    player_write_to_screen(current_player, START_Y_BOARD, START_X_BOARD, BOARD_HEIGHT, BOARD_WIDTH);
+    board_write_to_screen(&BOARD, START_Y_BOARD, START_X_BOARD);
+    player_write_to_screen(current_player, START_Y_BOARD, START_X_BOARD, BOARD.height, BOARD.width);
     refresh();
 
     // handle mouse events
@@ -162,7 +242,7 @@ int main() {
 	int x = shift_coord(event.x, START_X_BOARD + 2, true);
 	int y = shift_coord(event.y, START_Y_BOARD + 2, false);
 	
-	if (!allow_event(event.y, event.x, START_Y_BOARD, START_X_BOARD)) {
+	if (!allow_event(&BOARD, event.y, event.x, START_Y_BOARD, START_X_BOARD)) {
 	  // mvprintw(15, 15, "Invalid event!");
 	  // mvprintw(16, 16, "(%d, %d) -> (%d, %d)", event.y, event.x, y, x);
 	  continue;
@@ -172,16 +252,16 @@ int main() {
 	// mvprintw(15, 15, "Valid event!");
 	// mvprintw(16, 16, "(%d, %d) -> (%d, %d)", event.y, event.x, y, x);
 
-	bool valid_move = board_update(BOARD, y, x, current_player);
+	bool valid_move = board_update(&BOARD, y, x, current_player);
 	if(!valid_move) { continue; }
 
-	victory = board_check_victory(BOARD, y, x);
-	tie = !victory && count == BOARD_WIDTH * BOARD_HEIGHT - 1;
+	victory = board_check_victory(&BOARD);
+	tie = !victory && count == BOARD.cells - 1;
 
 	if (victory) {
-	  mvprintw(START_Y_BOARD + BOARD_HEIGHT + 2 + 5, START_X_BOARD + 4, "Player: %s has won!\n", PLAYER_ICON(current_player));
+	  mvprintw(START_Y_BOARD + BOARD.height + 2 + 5, START_X_BOARD + 4, "Player: %s has won!\n", PLAYER_ICON(current_player));
 	} else if (tie) {
-	  mvprintw(START_Y_BOARD + BOARD_HEIGHT + 2 + 5, START_X_BOARD + 4, "Game is tied, gg wp!\n");
+	  mvprintw(START_Y_BOARD + BOARD.height + 2 + 5, START_X_BOARD + 4, "Game is tied, gg wp!\n");
 	}	
 	
 	// update for next iteration
@@ -192,7 +272,7 @@ int main() {
     }
   }
 
-  board_write_to_screen(BOARD, START_Y_BOARD, START_X_BOARD);
+  board_write_to_screen(&BOARD, START_Y_BOARD, START_X_BOARD);
   refresh();
   getch();
   